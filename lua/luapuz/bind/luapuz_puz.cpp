@@ -80,6 +80,46 @@ static int puz_GetDirection(lua_State * L)
     lua_pushnumber(L, returns);
     return 1;
 }
+#include "puz/Scan.hpp"
+// [lua table] Scan(const std::string & filename)
+static int puz_Scan(lua_State * L)
+{
+    const char * filename = luaL_checkstring(L, 1);
+    try {
+        puz::ScanInfo info = puz::Scan(filename);
+        lua_newtable(L);
+        luapuz_pushstring_t(L, info.title);
+        lua_setfield(L, -2, "title");
+        luapuz_pushstring_t(L, info.author);
+        lua_setfield(L, -2, "author");
+        lua_pushnumber(L, info.width);
+        lua_setfield(L, -2, "width");
+        lua_pushnumber(L, info.height);
+        lua_setfield(L, -2, "height");
+        lua_pushnumber(L, info.type);
+        lua_setfield(L, -2, "type");
+        lua_pushnumber(L, info.flag);
+        lua_setfield(L, -2, "flag");
+        lua_pushnumber(L, info.time);
+        lua_setfield(L, -2, "time");
+        lua_pushboolean(L, info.isTimerRunning);
+        lua_setfield(L, -2, "is_timer_running");
+        lua_pushnumber(L, info.white);
+        lua_setfield(L, -2, "white");
+        lua_pushnumber(L, info.filled);
+        lua_setfield(L, -2, "filled");
+        lua_pushnumber(L, info.blank);
+        lua_setfield(L, -2, "blank");
+        lua_pushnumber(L, info.marked);
+        lua_setfield(L, -2, "marked");
+        return 1;
+    }
+    catch (...) {
+        luapuz_handleExceptions(L);
+    }
+    lua_error(L); // We should have returned by now
+    return 0;
+}
 static const luaL_reg puzlib[] = {
     {"ConstrainDirection", puz_ConstrainDirection},
     {"InvertDirection", puz_InvertDirection},
@@ -88,6 +128,7 @@ static const luaL_reg puzlib[] = {
     {"IsVertical", puz_IsVertical},
     {"AreInLine", puz_AreInLine},
     {"GetDirection", puz_GetDirection},
+    {"Scan", puz_Scan},
     {NULL, NULL}
 };
 
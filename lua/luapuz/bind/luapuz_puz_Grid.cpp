@@ -403,6 +403,73 @@ static int Grid_CheckSquare(lua_State * L)
     lua_pushboolean(L, returns);
     return 1;
 }
+// { white = n, black = n, ... } GetStats()
+static int Grid_GetStats(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    const puz::SolveStats & stats = grid->GetStats();
+    lua_newtable(L);
+    lua_pushnumber(L, stats.white);
+    lua_setfield(L, -2, "white");
+    lua_pushnumber(L, stats.black);
+    lua_setfield(L, -2, "black");
+    lua_pushnumber(L, stats.blank);
+    lua_setfield(L, -2, "blank");
+    lua_pushnumber(L, stats.blankCorrect);
+    lua_setfield(L, -2, "blank_correct");
+    lua_pushnumber(L, stats.correct);
+    lua_setfield(L, -2, "correct");
+    lua_pushnumber(L, stats.incorrect);
+    lua_setfield(L, -2, "incorrect");
+    lua_pushnumber(L, stats.strictIncorrect);
+    lua_setfield(L, -2, "strict_incorrect");
+    lua_pushnumber(L, stats.revealed);
+    lua_setfield(L, -2, "revealed");
+    lua_pushnumber(L, stats.checked);
+    lua_setfield(L, -2, "checked");
+    return 1;
+}
+// void TrackChanges(bool doit = true)
+static int Grid_TrackChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    int argCount = lua_gettop(L);
+    bool doit = (argCount >= 2 ? luapuz_checkboolean(L, 2) : true);
+    grid->TrackChanges(doit);
+    return 0;
+}
+// bool IsTrackingChanges()
+static int Grid_IsTrackingChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    bool returns = grid->IsTrackingChanges();
+    lua_pushboolean(L, returns);
+    return 1;
+}
+// bool HasChanges()
+static int Grid_HasChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    bool returns = grid->HasChanges();
+    lua_pushboolean(L, returns);
+    return 1;
+}
+// { puz::Square*, ... } GetChanges()
+static int Grid_GetChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    std::vector<puz::Square*> returns;
+    grid->GetChanges(&returns);
+    luapuz_pushSquareVector(L, &returns);
+    return 1;
+}
+// void ClearChanges()
+static int Grid_ClearChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    grid->ClearChanges();
+    return 0;
+}
 // Helper for FindSquare
 struct luapuz_FindSquare_Struct
 {
@@ -504,6 +571,12 @@ static const luaL_reg Gridlib[] = {
     {"SetCksum", Grid_SetCksum},
     {"CheckGrid", Grid_CheckGrid},
     {"CheckSquare", Grid_CheckSquare},
+    {"GetStats", Grid_GetStats},
+    {"TrackChanges", Grid_TrackChanges},
+    {"IsTrackingChanges", Grid_IsTrackingChanges},
+    {"HasChanges", Grid_HasChanges},
+    {"GetChanges", Grid_GetChanges},
+    {"ClearChanges", Grid_ClearChanges},
     {"FindSquare", Grid_FindSquare},
     {NULL, NULL}
 };
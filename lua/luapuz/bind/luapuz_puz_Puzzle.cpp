@@ -109,6 +109,8 @@ int Puzzle_Puzzle_try(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Load_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call the constructor
             returns = new puz::Puzzle(filename, &desc);
@@ -158,6 +160,8 @@ int Puzzle_Load_try(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Load_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call Load()
             puzzle->Load(filename, &desc);
@@ -200,6 +204,8 @@ int Puzzle_Save(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Save_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call Save()
             puzzle->Save(filename, &desc);
@@ -216,6 +222,37 @@ int Puzzle_Save(lua_State * L)
     lua_error(L); // We should have returned by now
     return 0;
 }
+// void LoadBuffer(const std::string & data)
+// void LoadBuffer(const std::string & data, const FileHandlerDesc * desc)
+// In lua the handler is given by its extension: puz:LoadBuffer(data, "jpz")
+int Puzzle_LoadBuffer(lua_State * L)
+{
+    puz::Puzzle * puzzle = luapuz_checkPuzzle(L, 1);
+    size_t length;
+    const char * data = luaL_checklstring(L, 2, &length);
+    try {
+        int argCount = lua_gettop(L) - 1;
+        if (argCount >= 2)
+        {
+            const char * ext = luaL_checkstring(L, 3);
+            const puz::Puzzle::FileHandlerDesc * desc
+                = puz::Puzzle::FindLoadHandler(ext);
+            if (! desc)
+                throw puz::MissingHandler();
+            puzzle->LoadBuffer(data, length, desc);
+        }
+        else
+        {
+            puzzle->LoadBuffer(data, length);
+        }
+        return 0;
+    }
+    catch (...) {
+        luapuz_handleExceptions(L);
+    }
+    lua_error(L); // We should have returned by now
+    return 0;
+}
 // void LoadIpuzString(const char * data)
 static int Puzzle_LoadIpuzString(lua_State * L)
 {
@@ -567,9 +604,17 @@ static int Puzzle_GenerateWords(lua_State * L)
         lua_error(L);
     return code;
 }
+// void InvalidateWordIndex()
+static int Puzzle_InvalidateWordIndex(lua_State * L)
+{
+    puz::Puzzle * puzzle = luapuz_checkPuzzle(L, 1);
+    puzzle->InvalidateWordIndex();
+    return 0;
+}
 static const luaL_reg Puzzlelib[] = {
     {"Load", Puzzle_Load},
     {"Save", Puzzle_Save},
+    {"LoadBuffer", Puzzle_LoadBuffer},
     {"LoadIpuzString", Puzzle_LoadIpuzString},
     {"CanLoad", Puzzle_CanLoad},
     {"CanSave", Puzzle_CanSave},
@@ -604,6 +649,7 @@ static const luaL_reg Puzzlelib[] = {
     {"NumberGrid", Puzzle_NumberGrid},
     {"UsesNumberAlgorithm", Puzzle_UsesNumberAlgorithm},
     {"GenerateWords", Puzzle_GenerateWords},
+    {"InvalidateWordIndex", Puzzle_InvalidateWordIndex},
     {NULL, NULL}
 };
 
@@ -183,6 +183,7 @@ func{"AreInLine",          returns="bool",
 func{"GetDirection",       returns="unsigned short",
                                 arg("Square &", "first"),
                                 arg("Square &", "second")}
+func{"Scan", override=overrides.Scan}
 
 
 class()
@@ -250,6 +251,14 @@ class{"Grid", header="puz/Grid.hpp"}
                         arg("Square &", "square"),
                         arg("bool", "checkBlank", "false"),
                         arg("bool", "strictRebus", "false")}
+    func{"GetStats", override=overrides.Grid_GetStats}
+
+    -- Change tracking
+    func{"TrackChanges", arg("bool", "doit", "true")}
+    func{"IsTrackingChanges", returns="bool"}
+    func{"HasChanges", returns="bool"}
+    func{"GetChanges", returns="vector<puz::Square*>", override=overrides.Grid_GetChanges}
+    func{"ClearChanges"}
 
     -- Find functions
     func{"FindSquare", override=overrides.Grid_FindSquare,
@@ -269,6 +278,7 @@ class{"Puzzle", header="puz/Puzzle.hpp", cppheader="luapuz_puz_Puzzle_helpers.hp
     func{"Load", override=overrides.Puzzle_Load}
     func{"Save", override=overrides.Puzzle_Save}
 
+    func{"LoadBuffer", override=overrides.Puzzle_LoadBuffer}
     func{"LoadIpuzString", arg("const char *", "data")}
 
     func{"CanLoad", static=true, returns="bool", arg("const char *", "filename")}
@@ -311,5 +321,6 @@ class{"Puzzle", header="puz/Puzzle.hpp", cppheader="luapuz_puz_Puzzle_helpers.hp
     func{"NumberGrid"}
     func{"UsesNumberAlgorithm", returns="bool"}
     func{"GenerateWords", throws=true}
+    func{"InvalidateWordIndex"}
 
 bind.run()
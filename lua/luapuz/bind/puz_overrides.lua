@@ -26,6 +26,8 @@ int Puzzle_Puzzle_try(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Load_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call the constructor
             returns = new puz::Puzzle(filename, &desc);
@@ -79,6 +81,8 @@ int Puzzle_Load_try(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Load_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call Load()
             puzzle->Load(filename, &desc);
@@ -124,6 +128,8 @@ int Puzzle_Save(lua_State * L)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Save_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             // Call Save()
             puzzle->Save(filename, &desc);
@@ -142,6 +148,87 @@ int Puzzle_Save(lua_State * L)
 }
 ]],
 
+Puzzle_LoadBuffer = [[
+// void LoadBuffer(const std::string & data)
+// void LoadBuffer(const std::string & data, const FileHandlerDesc * desc)
+// In lua the handler is given by its extension: puz:LoadBuffer(data, "jpz")
+int Puzzle_LoadBuffer(lua_State * L)
+{
+    puz::Puzzle * puzzle = luapuz_checkPuzzle(L, 1);
+    size_t length;
+    const char * data = luaL_checklstring(L, 2, &length);
+    try {
+        int argCount = lua_gettop(L) - 1;
+        if (argCount >= 2)
+        {
+            const char * ext = luaL_checkstring(L, 3);
+            const puz::Puzzle::FileHandlerDesc * desc
+                = puz::Puzzle::FindLoadHandler(ext);
+            if (! desc)
+                throw puz::MissingHandler();
+            puzzle->LoadBuffer(data, length, desc);
+        }
+        else
+        {
+            puzzle->LoadBuffer(data, length);
+        }
+        return 0;
+    }
+    catch (...) {
+        luapuz_handleExceptions(L);
+    }
+    lua_error(L); // We should have returned by now
+    return 0;
+}
+]],
+
+-- ===================================================================
+-- Scan
+-- ===================================================================
+
+Scan = [[
+#include "puz/Scan.hpp"
+// [lua table] Scan(const std::string & filename)
+static int puz_Scan(lua_State * L)
+{
+    const char * filename = luaL_checkstring(L, 1);
+    try {
+        puz::ScanInfo info = puz::Scan(filename);
+        lua_newtable(L);
+        luapuz_pushstring_t(L, info.title);
+        lua_setfield(L, -2, "title");
+        luapuz_pushstring_t(L, info.author);
+        lua_setfield(L, -2, "author");
+        lua_pushnumber(L, info.width);
+        lua_setfield(L, -2, "width");
+        lua_pushnumber(L, info.height);
+        lua_setfield(L, -2, "height");
+        lua_pushnumber(L, info.type);
+        lua_setfield(L, -2, "type");
+        lua_pushnumber(L, info.flag);
+        lua_setfield(L, -2, "flag");
+        lua_pushnumber(L, info.time);
+        lua_setfield(L, -2, "time");
+        lua_pushboolean(L, info.isTimerRunning);
+        lua_setfield(L, -2, "is_timer_running");
+        lua_pushnumber(L, info.white);
+        lua_setfield(L, -2, "white");
+        lua_pushnumber(L, info.filled);
+        lua_setfield(L, -2, "filled");
+        lua_pushnumber(L, info.blank);
+        lua_setfield(L, -2, "blank");
+        lua_pushnumber(L, info.marked);
+        lua_setfield(L, -2, "marked");
+        return 1;
+    }
+    catch (...) {
+        luapuz_handleExceptions(L);
+    }
+    lua_error(L); // We should have returned by now
+    return 0;
+}
+]],
+
 -- ===================================================================
 -- Typedef puz::Puzzle::metamap_t
 -- ===================================================================
@@ -333,6 +420,47 @@ static int Grid_CheckWord(lua_State * L)
 ]],
 
 
+Grid_GetStats = [[
+// { white = n, black = n, ... } GetStats()
+static int Grid_GetStats(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    const puz::SolveStats & stats = grid->GetStats();
+    lua_newtable(L);
+    lua_pushnumber(L, stats.white);
+    lua_setfield(L, -2, "white");
+    lua_pushnumber(L, stats.black);
+    lua_setfield(L, -2, "black");
+    lua_pushnumber(L, stats.blank);
+    lua_setfield(L, -2, "blank");
+    lua_pushnumber(L, stats.blankCorrect);
+    lua_setfield(L, -2, "blank_correct");
+    lua_pushnumber(L, stats.correct);
+    lua_setfield(L, -2, "correct");
+    lua_pushnumber(L, stats.incorrect);
+    lua_setfield(L, -2, "incorrect");
+    lua_pushnumber(L, stats.strictIncorrect);
+    lua_setfield(L, -2, "strict_incorrect");
+    lua_pushnumber(L, stats.revealed);
+    lua_setfield(L, -2, "revealed");
+    lua_pushnumber(L, stats.checked);
+    lua_setfield(L, -2, "checked");
+    return 1;
+}
+]],
+
+Grid_GetChanges = [[
+// { puz::Square*, ... } GetChanges()
+static int Grid_GetChanges(lua_State * L)
+{
+    puz::Grid * grid = luapuz_checkGrid(L, 1);
+    std::vector<puz::Square*> returns;
+    grid->GetChanges(&returns);
+    luapuz_pushSquareVector(L, &returns);
+    return 1;
+}
+]],
+
 Grid_FindSquare = [[
 // Helper for FindSquare
 struct luapuz_FindSquare_Struct
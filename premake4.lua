@@ -68,9 +68,13 @@ solution "XWord"
     -- ------------------------------------------------------------------------
 
     configuration {}
+        cppdialect "C++11"
 
     include "src" -- the XWord premake file
     include "puz" -- the puzzle library
+    include "puzconv" -- command-line batch converter
+    include "puzbench" -- puz library benchmarks
+    include "puztest" -- puz library tests
     include "yajl"
     include "yaml"
     if not _OPTIONS["disable-lua"] then
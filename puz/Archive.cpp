@@ -0,0 +1,637 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "Archive.hpp"
+#include "Puzzle.hpp"
+#include "utils/bufferreader.hpp"
+#include "utils/bufferwriter.hpp"
+#include <cstring>
+
+namespace puz {
+
+// Header (32 bytes)
+//     magic           8
+//     version         2
+//     entry size      2
+//     block entries   2   Entries in each index block
+//     (reserved)      2
+//     slot count      4   Index entries in use, including removed puzzles
+//     first block     4
+//     last block      4
+//     end             4   Anything after this was left by a failed write
+//
+// Index block
+//     next block      4   0 for the last block
+//     (reserved)      4
+//     entries
+//
+// Entry (128 bytes)
+//     source         32   UTF-8, padded with NULs
+//     date            4   yyyymmdd
+//     offset          4   0 if the puzzle was removed
+//     length          4
+//     format          8   File extension, padded with NULs
+//     width, height, type, flag       2 each
+//     white, filled, blank, marked    2 each
+//     time            4
+//     flags           2
+//     (reserved)      2
+//     title          52   UTF-8, padded with NULs
+
+static const char ARCHIVE_MAGIC[8] = { 'X', 'W', 'A', 'R', 'C', 'H', 'V', '\x1a' };
+static const unsigned short ARCHIVE_VERSION = 1;
+static const size_t HEADER_SIZE = 32;
+static const size_t ENTRY_SIZE = 128;
+static const size_t BLOCK_ENTRIES = 64;
+static const size_t BLOCK_HEADER_SIZE = 8;
+static const size_t BLOCK_SIZE = BLOCK_HEADER_SIZE + BLOCK_ENTRIES * ENTRY_SIZE;
+static const size_t SOURCE_SIZE = 32;
+static const size_t FORMAT_SIZE = 8;
+static const size_t TITLE_SIZE = 52;
+// Offsets are 32 bits, but fseek takes a long
+static const size_t MAX_ARCHIVE_SIZE = 0x7fffffff;
+
+// Entry flags
+static const unsigned short ENTRY_TIMER_RUNNING = 0x0001;
+
+
+//------------------------------------------------------------------------------
+// Reading and writing entries
+//------------------------------------------------------------------------------
+
+// Read a string padded with NULs
+static std::string ReadFixed(buffer_reader & f, size_t size)
+{
+    const byte_span span = f.Read(size);
+    if (span.empty())
+        return std::string();
+    const char * end = static_cast<const char *>(
+        std::memchr(span.data(), '\0', span.size()));
+    return std::string(span.data(), end ? end : span.end());
+}
+
+static void WriteFixed(buffer_writer & out, const std::string & str, size_t size)
+{
+    out.Write(str);
+    out.Skip(size - str.size());
+}
+
+// Cut a UTF-8 string to at most size bytes, without splitting a character
+static std::string TruncateUtf8(const std::string & str, size_t size)
+{
+    if (str.size() <= size)
+        return str;
+    while (size > 0 && (static_cast<unsigned char>(str[size]) & 0xc0) == 0x80)
+        --size;
+    return str.substr(0, size);
+}
+
+static unsigned short Clamp16(int num)
+{
+    if (num < 0)
+        return 0;
+    return num > 0xffff ? 0xffff : static_cast<unsigned short>(num);
+}
+
+static void WriteArchiveHeader(buffer_writer & out, unsigned int slotCount,
+                               size_t firstBlock, size_t lastBlock, size_t end)
+{
+    out.Write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    out.Write(ARCHIVE_VERSION);
+    out.Write(static_cast<unsigned short>(ENTRY_SIZE));
+    out.Write(static_cast<unsigned short>(BLOCK_ENTRIES));
+    out.Skip(2);
+    out.WriteLong(slotCount);
+    out.WriteLong(firstBlock);
+    out.WriteLong(lastBlock);
+    out.WriteLong(end);
+}
+
+// Return false if the puzzle was removed
+static bool ReadArchiveEntry(buffer_reader & f, ArchiveEntry & entry)
+{
+    entry.source = ReadFixed(f, SOURCE_SIZE);
+    entry.date = f.ReadLong();
+    entry.offset = f.ReadLong();
+    entry.length = f.ReadLong();
+    entry.format = ReadFixed(f, FORMAT_SIZE);
+    ScanInfo & info = entry.info;
+    info.width = f.ReadShort();
+    info.height = f.ReadShort();
+    info.type = f.ReadShort();
+    info.flag = f.ReadShort();
+    info.white = f.ReadShort();
+    info.filled = f.ReadShort();
+    info.blank = f.ReadShort();
+    info.marked = f.ReadShort();
+    info.time = f.ReadLong();
+    const unsigned short flags = f.ReadShort();
+    info.isTimerRunning = (flags & ENTRY_TIMER_RUNNING) != 0;
+    f.Skip(2);
+    info.title = decode_utf8(ReadFixed(f, TITLE_SIZE));
+    return entry.offset != 0;
+}
+
+static void WriteArchiveEntry(buffer_writer & out, const ArchiveEntry & entry,
+                              bool removed)
+{
+    WriteFixed(out, entry.source, SOURCE_SIZE);
+    out.WriteLong(entry.date);
+    out.WriteLong(removed ? 0 : entry.offset);
+    out.WriteLong(entry.length);
+    WriteFixed(out, entry.format, FORMAT_SIZE);
+    const ScanInfo & info = entry.info;
+    out.Write(Clamp16(info.width));
+    out.Write(Clamp16(info.height));
+    out.Write(info.type);
+    out.Write(info.flag);
+    out.Write(Clamp16(info.white));
+    out.Write(Clamp16(info.filled));
+    out.Write(Clamp16(info.blank));
+    out.Write(Clamp16(info.marked));
+    out.WriteLong(info.time < 0 ? 0 : info.time);
+    out.Write(static_cast<unsigned short>(
+        info.isTimerRunning ? ENTRY_TIMER_RUNNING : 0));
+    out.Skip(2);
+    WriteFixed(out, TruncateUtf8(encode_utf8(info.title), TITLE_SIZE),
+               TITLE_SIZE);
+}
+
+
+//------------------------------------------------------------------------------
+// Archive
+//------------------------------------------------------------------------------
+
+Archive::Archive()
+    : m_isOpen(false),
+      m_file(NULL),
+      m_data(NULL),
+      m_size(0),
+      m_slotCount(0),
+      m_end(0),
+      m_unused(0)
+{
+}
+
+Archive::~Archive()
+{
+    Close();
+}
+
+void
+Archive::Open(const std::string & filename, bool create)
+{
+    Close();
+    if (create)
+    {
+        // Append mode creates the file without truncating an existing one
+        FILE * file = fopen(filename.c_str(), "ab");
+        if (! file)
+            throw FileError(filename);
+        bool ok = true;
+        if (fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+        {
+            buffer_writer header(HEADER_SIZE);
+            WriteArchiveHeader(header, 0, 0, 0, HEADER_SIZE);
+            ok = fwrite(header.data(), 1, header.size(), file) == header.size();
+        }
+        if (fclose(file) != 0 || ! ok)
+            throw FileError(filename);
+    }
+    if (! m_map.Open(filename))
+        throw FileError(filename);
+    m_filename = filename;
+    m_data = m_map.data();
+    m_size = m_map.size();
+    m_isOpen = true;
+    try {
+        ReadIndex();
+    }
+    catch (...) {
+        Close();
+        throw;
+    }
+}
+
+void
+Archive::OpenBuffer(const char * data, size_t length)
+{
+    Close();
+    m_data = data;
+    m_size = length;
+    m_isOpen = true;
+    try {
+        ReadIndex();
+    }
+    catch (...) {
+        Close();
+        throw;
+    }
+}
+
+void
+Archive::Close()
+{
+    if (m_file)
+        fclose(m_file);
+    m_file = NULL;
+    m_map.Close();
+    m_isOpen = false;
+    m_filename.clear();
+    m_data = NULL;
+    m_size = 0;
+    m_entries.clear();
+    m_index.clear();
+    m_replaced.clear();
+    m_blocks.clear();
+    m_slotCount = 0;
+    m_end = 0;
+    m_unused = 0;
+}
+
+void
+Archive::ReadIndex()
+{
+    buffer_reader f(m_data, m_size);
+    const byte_span magic = f.Read(sizeof(ARCHIVE_MAGIC));
+    if (f.Fail() ||
+        std::memcmp(magic.data(), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+    {
+        throw FileTypeError("xwa");
+    }
+    const unsigned short version = f.ReadShort();
+    const unsigned short entrySize = f.ReadShort();
+    const unsigned short blockEntries = f.ReadShort();
+    f.Skip(2);
+    m_slotCount = f.ReadLong();
+    size_t block = f.ReadLong();
+    f.Skip(4); // Last block
+    m_end = f.ReadLong();
+    if (f.Fail())
+        throw LoadError("Archive is truncated");
+    if (version != ARCHIVE_VERSION || entrySize != ENTRY_SIZE ||
+        blockEntries != BLOCK_ENTRIES)
+    {
+        throw LoadError("Unsupported archive version");
+    }
+    if (m_end < HEADER_SIZE || m_end > m_size)
+        throw LoadError("Archive is truncated");
+    // Each block takes up space, so this also stops loops in the index
+    const size_t maxBlocks = (m_end - HEADER_SIZE) / BLOCK_SIZE;
+    if (m_slotCount > maxBlocks * BLOCK_ENTRIES)
+        throw LoadError("Archive index is damaged");
+
+    size_t used = HEADER_SIZE;
+    for (unsigned int slot = 0; slot < m_slotCount; ++slot)
+    {
+        const size_t i = slot % BLOCK_ENTRIES;
+        if (i == 0)
+        {
+            if (! m_blocks.empty())
+                block = buffer_reader(m_data + m_blocks.back(), 4).ReadLong();
+            if (block < HEADER_SIZE || block > m_end - BLOCK_SIZE)
+                throw LoadError("Archive index is damaged");
+            m_blocks.push_back(block);
+            used += BLOCK_SIZE;
+        }
+        buffer_reader entryReader(
+            m_data + m_blocks.back() + BLOCK_HEADER_SIZE + i * ENTRY_SIZE,
+            ENTRY_SIZE);
+        ArchiveEntry entry;
+        if (! ReadArchiveEntry(entryReader, entry))
+            continue;
+        if (entry.offset < HEADER_SIZE || entry.offset > m_end ||
+            entry.length > m_end - entry.offset)
+        {
+            throw LoadError("Archive index is damaged");
+        }
+        entry.slot = slot;
+        const key_t key(entry.source, entry.date);
+        const index_t::iterator it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            // Append stopped before removing the entry it replaced: the
+            // later slot wins.
+            used -= m_entries[it->second].length;
+            m_replaced.push_back(m_entries[it->second]);
+            m_entries.erase(m_entries.begin() + it->second);
+            BuildIndex();
+        }
+        used += entry.length;
+        m_index[key] = m_entries.size();
+        m_entries.push_back(entry);
+    }
+    if (used > m_end)
+        throw LoadError("Archive index is damaged");
+    m_unused = m_end - used;
+}
+
+void
+Archive::BuildIndex()
+{
+    m_index.clear();
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        m_index[key_t(m_entries[i].source, m_entries[i].date)] = i;
+}
+
+const ArchiveEntry *
+Archive::Find(const std::string & source, unsigned int date) const
+{
+    index_t::const_iterator it = m_index.find(key_t(source, date));
+    if (it == m_index.end())
+        return NULL;
+    return &m_entries[it->second];
+}
+
+const ArchiveEntry *
+Archive::GetLatest() const
+{
+    const ArchiveEntry * latest = NULL;
+    for (size_t i = 0; i < m_entries.size(); ++i)
+        if (! latest || m_entries[i].date >= latest->date)
+            latest = &m_entries[i];
+    return latest;
+}
+
+// Map the archive again after it has been changed
+void
+Archive::OpenForReading()
+{
+    if (m_data)
+        return;
+    if (! m_isOpen)
+        throw Exception("Archive is not open");
+    if (m_file)
+    {
+        const bool ok = fclose(m_file) == 0;
+        m_file = NULL;
+        if (! ok)
+            throw FileError(m_filename);
+    }
+    if (! m_map.Open(m_filename))
+        throw FileError(m_filename);
+    m_data = m_map.data();
+    m_size = m_map.size();
+}
+
+void
+Archive::OpenForWriting()
+{
+    if (! m_isOpen)
+        throw Exception("Archive is not open");
+    if (IsReadOnly())
+        throw Exception("Archive is read-only");
+    if (m_file)
+        return;
+    // Windows won't let us write to a file that is mapped
+    m_map.Close();
+    m_data = NULL;
+    m_size = 0;
+    m_file = fopen(m_filename.c_str(), "r+b");
+    if (! m_file)
+        throw FileError(m_filename);
+}
+
+void
+Archive::WriteAt(size_t offset, const char * data, size_t length)
+{
+    if (fseek(m_file, static_cast<long>(offset), SEEK_SET) != 0 ||
+        fwrite(data, 1, length, m_file) != length)
+    {
+        throw FileError(m_filename);
+    }
+}
+
+void
+Archive::WriteHeader()
+{
+    buffer_writer header(HEADER_SIZE);
+    WriteArchiveHeader(header, m_slotCount,
+                       m_blocks.empty() ? 0 : m_blocks.front(),
+                       m_blocks.empty() ? 0 : m_blocks.back(),
+                       m_end);
+    WriteAt(0, header.data(), header.size());
+}
+
+void
+Archive::WriteEntry(const ArchiveEntry & entry, bool removed)
+{
+    buffer_writer out(ENTRY_SIZE);
+    WriteArchiveEntry(out, entry, removed);
+    WriteAt(m_blocks[entry.slot / BLOCK_ENTRIES] + BLOCK_HEADER_SIZE
+                + (entry.slot % BLOCK_ENTRIES) * ENTRY_SIZE,
+            out.data(), out.size());
+}
+
+void
+Archive::WriteReplaced()
+{
+    for (size_t i = 0; i < m_replaced.size(); ++i)
+        WriteEntry(m_replaced[i], true);
+    m_replaced.clear();
+}
+
+const char *
+Archive::GetData(const ArchiveEntry & entry)
+{
+    OpenForReading();
+    if (entry.offset > m_size || entry.length > m_size - entry.offset)
+        throw LoadError("Archive is truncated");
+    return m_data + entry.offset;
+}
+
+void
+Archive::Load(Puzzle * puz, const ArchiveEntry & entry)
+{
+    const char * data = GetData(entry);
+    puz->LoadBuffer(data, entry.length,
+                    Puzzle::FindLoadHandler(entry.format));
+}
+
+void
+Archive::Append(const std::string & source, unsigned int date,
+                const std::string & format,
+                const char * data, size_t length)
+{
+    Append(source, date, format, data, length, Scan(data, length));
+}
+
+// The puzzle and its index entry are written past the end of the archive
+// and the slot count, and the header is written after them.  If anything
+// fails before then, the archive is left as it was, and the unused space is
+// overwritten the next time a puzzle is added.  A replaced puzzle's entry
+// is marked as removed after the header is written; if that doesn't
+// happen, ReadIndex uses the later entry.  Writes are flushed but not
+// synced, so this doesn't protect against losing power.
+void
+Archive::Append(const std::string & source, unsigned int date,
+                const std::string & format,
+                const char * data, size_t length,
+                const ScanInfo & info)
+{
+    if (source.empty() || source.size() > SOURCE_SIZE)
+        throw InvalidString("Archive sources must be 1 to 32 bytes");
+    ArchiveEntry entry;
+    entry.source = source;
+    entry.date = date;
+    entry.format = format;
+    if (entry.format.empty())
+    {
+        const Puzzle::FileHandlerDesc * desc =
+            Puzzle::DetectHandler(data, length);
+        if (! desc)
+            throw MissingHandler();
+        entry.format = desc->ext;
+    }
+    if (entry.format.size() > FORMAT_SIZE || entry.format == "xwa")
+        throw MissingHandler();
+    entry.info = info;
+    entry.info.author.clear();
+    entry.length = length;
+
+    OpenForWriting();
+    const index_t::iterator it = m_index.find(key_t(source, date));
+    const bool needsBlock = m_slotCount % BLOCK_ENTRIES == 0;
+    size_t end = m_end;
+    if (end > MAX_ARCHIVE_SIZE - BLOCK_SIZE ||
+        length > MAX_ARCHIVE_SIZE - BLOCK_SIZE - end)
+        throw Exception("Archive is full");
+    try {
+        if (needsBlock)
+        {
+            const std::vector<char> zeros(BLOCK_SIZE);
+            WriteAt(end, &zeros[0], zeros.size());
+            if (! m_blocks.empty())
+            {
+                buffer_writer next(4);
+                next.WriteLong(end);
+                WriteAt(m_blocks.back(), next.data(), next.size());
+            }
+            m_blocks.push_back(end);
+            end += BLOCK_SIZE;
+        }
+        entry.offset = end;
+        WriteAt(end, data, length);
+        entry.slot = m_slotCount;
+        WriteEntry(entry);
+        ++m_slotCount;
+        m_end = end + length;
+        WriteHeader();
+        if (it != m_index.end())
+        {
+            const ArchiveEntry & old = m_entries[it->second];
+            WriteEntry(old, true);
+            m_unused += old.length;
+        }
+        WriteReplaced();
+        if (fflush(m_file) != 0)
+            throw FileError(m_filename);
+    }
+    catch (...) {
+        // Our idea of the archive may not match the file any more
+        Close();
+        throw;
+    }
+    if (it != m_index.end())
+    {
+        m_entries.erase(m_entries.begin() + it->second);
+        m_entries.push_back(entry);
+        BuildIndex();
+    }
+    else
+    {
+        m_index[key_t(source, date)] = m_entries.size();
+        m_entries.push_back(entry);
+    }
+}
+
+bool
+Archive::Remove(const std::string & source, unsigned int date)
+{
+    const index_t::iterator it = m_index.find(key_t(source, date));
+    if (it == m_index.end())
+        return false;
+    OpenForWriting();
+    const size_t i = it->second;
+    try {
+        WriteEntry(m_entries[i], true);
+        WriteReplaced();
+        if (fflush(m_file) != 0)
+            throw FileError(m_filename);
+    }
+    catch (...) {
+        Close();
+        throw;
+    }
+    m_unused += m_entries[i].length;
+    m_entries.erase(m_entries.begin() + i);
+    BuildIndex();
+    return true;
+}
+
+void
+Archive::Compact()
+{
+    if (IsReadOnly())
+        throw Exception("Archive is read-only");
+    OpenForReading();
+
+    // The index comes first, so it can be read in one go, followed by the
+    // puzzles in the same order.
+    const size_t count = m_entries.size();
+    const size_t blockCount = (count + BLOCK_ENTRIES - 1) / BLOCK_ENTRIES;
+    const size_t first = HEADER_SIZE;
+    size_t end = first + blockCount * BLOCK_SIZE;
+    entry_list entries(m_entries);
+    for (size_t i = 0; i < count; ++i)
+    {
+        entries[i].slot = i;
+        entries[i].offset = end;
+        end += entries[i].length;
+    }
+
+    buffer_writer out(end);
+    WriteArchiveHeader(out, count,
+                       blockCount == 0 ? 0 : first,
+                       blockCount == 0 ? 0 : first + (blockCount - 1) * BLOCK_SIZE,
+                       end);
+    for (size_t block = 0; block < blockCount; ++block)
+    {
+        const bool isLast = block + 1 == blockCount;
+        out.WriteLong(isLast ? 0 : first + (block + 1) * BLOCK_SIZE);
+        out.Skip(BLOCK_HEADER_SIZE - 4);
+        for (size_t i = block * BLOCK_ENTRIES; i < (block + 1) * BLOCK_ENTRIES; ++i)
+        {
+            if (i < count)
+                WriteArchiveEntry(out, entries[i], false);
+            else
+                out.Skip(ENTRY_SIZE);
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+        out.Write(m_data + m_entries[i].offset, m_entries[i].length);
+
+    const std::string filename = m_filename;
+    Close();
+    const bool ok = WriteWholeFile(filename, out.data(), out.size());
+    Open(filename);
+    if (! ok)
+        throw FileError(filename);
+}
+
+} // namespace puz
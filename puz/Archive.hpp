@@ -0,0 +1,153 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_ARCHIVE_H
+#define PUZ_ARCHIVE_H
+
+#include "Scan.hpp"
+#include "utils/filemap.hpp"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace puz {
+
+class Puzzle;
+
+// A puzzle stored in an archive.
+struct PUZ_API ArchiveEntry
+{
+    ArchiveEntry() : date(0), offset(0), length(0), slot(0) {}
+
+    std::string source;  // UTF-8, at most 32 bytes
+    unsigned int date;   // yyyymmdd
+    std::string format;  // Extension of the puzzle's file format
+    ScanInfo info;       // Size, title, and progress (author is not stored)
+    size_t offset;       // Position of the puzzle file in the archive
+    size_t length;
+    unsigned int slot;   // Position in the index
+};
+
+// Many puzzle files stored in one file, indexed by source and date.
+//
+// The archive starts with a header, followed by index blocks and the
+// puzzle files themselves.  Index blocks have a fixed number of
+// fixed-size entries, so the whole index can be read without touching any
+// puzzles, and each entry has a summary of its puzzle (see ScanInfo).
+// Puzzles are stored as-is, in their original format, and are read
+// straight out of the mapped archive.
+//
+// New puzzles are appended to the end of the file, and so are replacements
+// for existing puzzles.  Replacing or removing a puzzle leaves its old data
+// in place until the archive is compacted.
+// All numbers are little-endian.  Offsets are 32 bits, but they are passed
+// to fseek as a long, so an archive can't be larger than 2GB.
+class PUZ_API Archive
+{
+public:
+    typedef std::vector<ArchiveEntry> entry_list;
+
+    Archive();
+    ~Archive();
+
+    // Open an archive file.  If create is true and the file doesn't exist,
+    // it is created.  Throws FileError, FileTypeError, or LoadError.
+    void Open(const std::string & filename, bool create = false);
+    // Open a read-only archive that has already been loaded into memory.
+    // The data must outlive the archive.
+    void OpenBuffer(const char * data, size_t length);
+    void Close();
+
+    bool IsOpen() const { return m_isOpen; }
+    bool IsReadOnly() const { return m_filename.empty(); }
+    const std::string & GetFilename() const { return m_filename; }
+
+    // All puzzles in the archive, in the order they were added.  Replacing
+    // a puzzle moves it to the end.
+    const entry_list & GetEntries() const { return m_entries; }
+    // Return NULL if the archive doesn't have this puzzle.
+    const ArchiveEntry * Find(const std::string & source,
+                              unsigned int date) const;
+    // The puzzle with the latest date, or NULL if the archive is empty.
+    const ArchiveEntry * GetLatest() const;
+
+    // A puzzle's file.  The data is valid until the archive is changed.
+    const char * GetData(const ArchiveEntry & entry);
+    void Load(Puzzle * puz, const ArchiveEntry & entry);
+
+    // Add a puzzle file, replacing any puzzle with the same source and
+    // date.  If format is empty, it is detected from the data.  info is
+    // stored in the index; if it isn't given, the puzzle is scanned.
+    void Append(const std::string & source, unsigned int date,
+                const std::string & format,
+                const char * data, size_t length);
+    void Append(const std::string & source, unsigned int date,
+                const std::string & format,
+                const char * data, size_t length,
+                const ScanInfo & info);
+    // Return false if the archive doesn't have this puzzle.
+    bool Remove(const std::string & source, unsigned int date);
+
+    // Size of the archive, and the part of it that is taken up by replaced
+    // and removed puzzles.
+    size_t GetSize() const { return m_end; }
+    size_t GetUnusedSize() const { return m_unused; }
+    // Rewrite the archive without replaced and removed puzzles.
+    // The new archive is built in memory, then written over the old one.
+    void Compact();
+
+private:
+    // Not copyable
+    Archive(const Archive &);
+    Archive & operator=(const Archive &);
+
+    typedef std::pair<std::string, unsigned int> key_t;
+    typedef std::map<key_t, size_t> index_t;
+
+    void ReadIndex();
+    void BuildIndex();
+    void OpenForReading();
+    void OpenForWriting();
+    void WriteAt(size_t offset, const char * data, size_t length);
+    void WriteHeader();
+    void WriteEntry(const ArchiveEntry & entry, bool removed = false);
+    void WriteReplaced();
+
+    bool m_isOpen;
+    std::string m_filename; // Empty if the archive is read-only
+    file_map m_map;
+    FILE * m_file;  // Open while the archive is being changed
+    const char * m_data; // NULL while the archive is being changed
+    size_t m_size;
+
+    entry_list m_entries;
+    index_t m_index; // Key -> position in m_entries
+    // Entries that were replaced but never marked as removed, because an
+    // Append was interrupted.  They are marked on the next change.
+    entry_list m_replaced;
+    std::vector<size_t> m_blocks; // Offsets of the index blocks
+    unsigned int m_slotCount;     // Used index entries, including removed
+    size_t m_end;                 // End of the data written so far
+    size_t m_unused;
+};
+
+} // namespace puz
+
+#endif // PUZ_ARCHIVE_H
@@ -49,20 +49,8 @@ static void GetClueList(const Puzzle & puz, std::vector<std::string> * clues, st
            down_it == puz.GetClueList(puzT("Down")).end());
 }
 
-Checksummer::Checksummer(const Puzzle & puz, unsigned short version)
-    : m_version  (version)
+std::string GetPuzNotes(const Puzzle & puz, std::string(*encode_text)(const string_t&))
 {
-    std::string(*encode_text)(const string_t&);
-    if (version >= 20)
-        encode_text = encode_utf8;
-    else
-        encode_text = encode_puz;
-
-    m_title = GetPuzText(puz.GetTitle(), encode_text);
-    m_author = GetPuzText(puz.GetAuthor(), encode_text);
-    m_copyright = GetPuzText(puz.GetCopyright(), encode_text);
-
-    // Notes
     // Since puz doesn't support metadata, we store all notes-like fields in the single supported
     // notes field, in the format:
     // [Header, in title case]:[trailing space]
@@ -71,18 +59,35 @@ Checksummer::Checksummer(const Puzzle & puz, unsigned short version)
     // omitted.
     // The colon and trailing space improve rendering in regular Across Lite, which doesn't
     // render newlines.
+    std::string notes;
     const std::vector<std::pair<puz::string_t, puz::string_t> >& all_notes = puz.GetAllNotes();
     std::vector<std::pair<puz::string_t, puz::string_t> >::const_iterator it;
     for (it = all_notes.begin(); it != all_notes.end(); ++it)
     {
         if (it != all_notes.begin()) {
-            m_notes.append(" \n\n");
+            notes.append(" \n\n");
         }
         if (all_notes.size() > 1) {
-            m_notes.append(GetPuzText(TitleCase(it->first), encode_text) + ": \n");
+            notes.append(GetPuzText(TitleCase(it->first), encode_text) + ": \n");
         }
-        m_notes.append(GetPuzText(it->second, encode_text));
+        notes.append(GetPuzText(it->second, encode_text));
     }
+    return notes;
+}
+
+Checksummer::Checksummer(const Puzzle & puz, unsigned short version)
+    : m_version  (version)
+{
+    std::string(*encode_text)(const string_t&);
+    if (version >= 20)
+        encode_text = encode_utf8;
+    else
+        encode_text = encode_puz;
+
+    m_title = GetPuzText(puz.GetTitle(), encode_text);
+    m_author = GetPuzText(puz.GetAuthor(), encode_text);
+    m_copyright = GetPuzText(puz.GetCopyright(), encode_text);
+    m_notes = GetPuzNotes(puz, encode_text);
 
     // Solution and Text
     m_solution.reserve(puz.GetGrid().GetWidth() * puz.GetGrid().GetHeight());
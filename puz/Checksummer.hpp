@@ -126,6 +126,10 @@ private:
     unsigned short m_version;
 };
 
+// Return the notes field of a .puz file.  Puz only has one notes field, so
+// all notes-like fields are combined.
+std::string GetPuzNotes(const Puzzle & puz, std::string(*encode_text)(const string_t&));
+
 } // namespace puz
 
 #endif // PUZ_CHECK_SUMMER_H
@@ -29,12 +29,14 @@ void Clue::SetNumber(const string_t & _number)
 {
     number = _number;
     m_int = ToInt(number);
+    m_version.Bump();
 }
 
 void Clue::SetNumber(int _number)
 {
     m_int = _number;
     number = ToString(_number);
+    m_version.Bump();
 }
 
 void Clue::SetText(const string_t & _text, const bool _is_html)
@@ -49,71 +51,138 @@ void Clue::SetText(const string_t & _text, const bool _is_html)
 // ClueList
 // ---------------------------------------------------------------------------
 
-const Clue * ClueList::Find(int number) const
+unsigned long ClueList::NextVersion()
 {
-    const_iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (it->GetInt() == number)
-            break;
-    if (it == end())
+    static unsigned long s_version = 0;
+    return ++s_version;
+}
+
+unsigned long ClueList::GetVersion() const
+{
+    if (! m_version)
+        m_version = std::make_shared<unsigned long>(NextVersion());
+    const Clue * data = empty() ? NULL : &front();
+    if (data != m_versionData || size() != m_versionSize)
+    {
+        // Clues were added, removed, or reallocated
+        for (const_iterator it = begin(); it != end(); ++it)
+            it->m_version.m_counter = m_version;
+        m_versionData = data;
+        m_versionSize = size();
+        *m_version = NextVersion();
+    }
+    return *m_version;
+}
+
+void ClueList::InvalidateIndex() const
+{
+    m_isIndexed = false;
+    if (m_version)
+        *m_version = NextVersion();
+}
+
+// Rebuild the index if the clues have changed
+void ClueList::UpdateIndex() const
+{
+    const unsigned long version = GetVersion();
+    if (m_isIndexed && version == m_indexVersion)
+        return;
+    m_numberIndex.clear();
+    m_intIndex.clear();
+    m_wordIndex.clear();
+    for (size_t i = 0; i < size(); ++i)
+    {
+        // insert() keeps the first clue with a given key
+        const Clue & clue = at(i);
+        m_numberIndex.insert(std::make_pair(clue.number, i));
+        m_intIndex.insert(std::make_pair(clue.GetInt(), i));
+        m_wordIndex.insert(std::make_pair(&clue.word, i));
+    }
+    m_indexVersion = version;
+    m_isIndexed = true;
+}
+
+// Take the index along with the clues when moving a ClueList.  UpdateIndex
+// checks that it still matches the clues.
+void ClueList::TakeIndex(ClueList & other)
+{
+    m_numberIndex.swap(other.m_numberIndex);
+    m_intIndex.swap(other.m_intIndex);
+    m_wordIndex.swap(other.m_wordIndex);
+    m_indexVersion = other.m_indexVersion;
+    m_isIndexed = other.m_isIndexed;
+    other.m_isIndexed = false;
+    // The clues still point at other's counter
+    m_version = std::move(other.m_version);
+    m_versionData = other.m_versionData;
+    m_versionSize = other.m_versionSize;
+    other.m_version.reset();
+    other.m_versionData = NULL;
+    other.m_versionSize = 0;
+}
+
+static bool IsMatch(const Clue & clue, const string_t & number)
+{
+    return clue.number == number;
+}
+
+static bool IsMatch(const Clue & clue, int number)
+{
+    return clue.GetInt() == number;
+}
+
+static bool IsMatch(const Clue & clue, const Word * word)
+{
+    return &clue.word == word;
+}
+
+template <typename MAP, typename KEY>
+const Clue * ClueList::Lookup(MAP & index, const KEY & key) const
+{
+    UpdateIndex();
+    typename MAP::const_iterator it = index.find(key);
+    if (it == index.end())
         return NULL;
-    return &*it;
+    if (IsMatch(at(it->second), key))
+        return &at(it->second);
+    // Clue::number was changed directly; rebuild and try again.
+    InvalidateIndex();
+    UpdateIndex();
+    it = index.find(key);
+    if (it == index.end())
+        return NULL;
+    return &at(it->second);
+}
+
+const Clue * ClueList::Find(int number) const
+{
+    return Lookup(m_intIndex, number);
 }
 
 Clue * ClueList::Find(int number)
 {
-    iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (it->GetInt() == number)
-            break;
-    if (it == end())
-        return NULL;
-    return &*it;
+    return const_cast<Clue *>(const_cast<const ClueList *>(this)->Find(number));
 }
 
 const Clue * ClueList::Find(const string_t & number) const
 {
-    const_iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (it->number == number)
-            break;
-    if (it == end())
-        return NULL;
-    return &*it;
+    return Lookup(m_numberIndex, number);
 }
 
 Clue * ClueList::Find(const string_t & number)
 {
-    iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (it->number == number)
-            break;
-    if (it == end())
-        return NULL;
-    return &*it;
+    return const_cast<Clue *>(const_cast<const ClueList *>(this)->Find(number));
 }
 
 
 const Clue * ClueList::Find(const puz::Word * word) const
 {
-    const_iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (&it->word == word)
-            break;
-    if (it == end())
-        return NULL;
-    return &*it;
+    return Lookup(m_wordIndex, word);
 }
 
 Clue * ClueList::Find(const puz::Word * word)
 {
-    iterator it;
-    for (it = begin(); it != end(); ++it)
-        if (&it->word == word)
-            break;
-    if (it == end())
-        return NULL;
-    return &*it;
+    return const_cast<Clue *>(const_cast<const ClueList *>(this)->Find(word));
 }
 
 
@@ -194,20 +263,36 @@ ClueList & Clues::operator[](const string_t & direction)
     return it->second;
 }
 
-std::vector<std::pair<string_t, ClueList> >::iterator Clues::find(const string_t& direction) {
-    std::vector<std::pair<string_t, ClueList> >::iterator it = begin();
-    while (it != end() && it->first != direction) {
-        it++;
+// Return the position of direction, or size() if it isn't found.
+size_t Clues::FindIndex(const string_t & direction) const
+{
+    const value_type * data = empty() ? NULL : &front();
+    if (! m_isIndexed || data != m_indexData || size() != m_indexSize)
+    {
+        m_index.clear();
+        for (size_t i = 0; i < size(); ++i)
+            m_index.insert(std::make_pair(at(i).first, i));
+        m_indexData = data;
+        m_indexSize = size();
+        m_isIndexed = true;
     }
-    return it;
+    std::unordered_map<string_t, size_t>::const_iterator it;
+    it = m_index.find(direction);
+    if (it == m_index.end())
+        return size();
+    if (it->second < size() && at(it->second).first == direction)
+        return it->second;
+    // The clue lists were reordered in place
+    m_isIndexed = false;
+    return FindIndex(direction);
+}
+
+std::vector<std::pair<string_t, ClueList> >::iterator Clues::find(const string_t& direction) {
+    return begin() + FindIndex(direction);
 }
 
 std::vector<std::pair<string_t, ClueList> >::const_iterator Clues::find(const string_t& direction) const {
-    std::vector<std::pair<string_t, ClueList> >::const_iterator it = begin();
-    while (it != end() && it->first != direction) {
-        it++;
-    }
-    return it;
+    return begin() + FindIndex(direction);
 }
 
 } // namespace puz
@@ -21,7 +21,9 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <memory>
+#include <utility>
 #include "puzstring.hpp"
 #include "Word.hpp"
 #include <cassert>
@@ -48,7 +50,7 @@ public:
                   const string_t & text_,
                   Word word_,
                   const bool is_html_ = false)
-        : word(word_)
+        : word(std::move(word_))
     {
         SetNumber(num_);
         SetText(text_, is_html_);
@@ -64,7 +66,7 @@ public:
                   const string_t & text_,
                   Word word_,
                   const bool is_html_ = false)
-        : word(word_)
+        : word(std::move(word_))
     {
         SetNumber(num_);
         SetText(text_, is_html_);
@@ -73,7 +75,8 @@ public:
     void SetText(const string_t & text_, const bool is_html_ = false);
     void SetNumber(const string_t & num_);
     void SetNumber(int num_);
-    void SetWord(const Word & word_) { word = word_; }
+    void SetWord(const Word & word_) { word = word_; m_version.Bump(); }
+    void SetWord(Word && word_) { word = std::move(word_); m_version.Bump(); }
 
     const string_t & GetText() const { return text; }
     const string_t & GetNumber() const { return number; }
@@ -90,12 +93,29 @@ public:
         return GetInt() < other.GetInt();
     }
 
+    // Setting these directly (or changing the word returned by GetWord)
+    // isn't seen by the ClueList and Puzzle indexes: call
+    // ClueList::InvalidateIndex or Puzzle::InvalidateWordIndex afterwards.
     string_t number;
     string_t text;
     Word word;
 
 protected:
     int m_int;
+
+    // The change counter of the ClueList that holds this clue.  SetNumber,
+    // SetWord, and assigning to the clue bump the counter.
+    class Version
+    {
+    public:
+        Version() {}
+        Version(const Version & other) : m_counter(other.m_counter) {}
+        Version & operator=(const Version &) { Bump(); return *this; }
+        inline void Bump();
+
+        mutable std::shared_ptr<unsigned long> m_counter;
+    };
+    Version m_version;
 };
 
 
@@ -103,7 +123,41 @@ class PUZ_API ClueList : public std::vector<Clue>
 {
 public:
     // Basic constructor
-    explicit ClueList(const string_t & title = puzT("")) : m_title(title) {}
+    explicit ClueList(const string_t & title = puzT(""))
+        : m_title(title), m_versionData(NULL), m_versionSize(0),
+          m_isIndexed(false)
+    {}
+
+    // The lookup index is not copied
+    ClueList(const ClueList & other)
+        : std::vector<Clue>(other), m_title(other.m_title),
+          m_versionData(NULL), m_versionSize(0), m_isIndexed(false)
+    {}
+
+    ClueList & operator=(const ClueList & other)
+    {
+        std::vector<Clue>::operator=(other);
+        m_title = other.m_title;
+        InvalidateIndex();
+        return *this;
+    }
+
+    // Moving keeps the clues in place, so the index is still valid
+    ClueList(ClueList && other)
+        : std::vector<Clue>(std::move(other)),
+          m_title(std::move(other.m_title)),
+          m_versionData(NULL), m_versionSize(0), m_isIndexed(false)
+    {
+        TakeIndex(other);
+    }
+
+    ClueList & operator=(ClueList && other)
+    {
+        std::vector<Clue>::operator=(std::move(other));
+        m_title = std::move(other.m_title);
+        TakeIndex(other);
+        return *this;
+    }
 
     const string_t & GetTitle() const { return m_title; }
     void SetTitle(const string_t & title) { m_title = title; }
@@ -124,16 +178,80 @@ public:
     const Clue * Find(const puz::Word * word) const;
     Clue * Find(const puz::Word * word);
 
+    // Find by number and by word use a hashed index, rebuilt when the
+    // version changes (see GetVersion).  Call InvalidateIndex after setting
+    // Clue::number or Clue::word directly.
+    void InvalidateIndex() const;
+
+    // A stamp that changes whenever clues are added, removed, moved,
+    // assigned, renumbered, or given a new word (see Clue::SetWord), and is
+    // never reused by another ClueList.  Indexes built from the clues keep
+    // the stamp to know when to rebuild.
+    unsigned long GetVersion() const;
+    static unsigned long NextVersion();
+
 protected:
-    string_t m_title;;
+    string_t m_title;
+
+    // Change counter, shared with the clues.  The clues are pointed at the
+    // counter again whenever they are reallocated or resized.
+    mutable std::shared_ptr<unsigned long> m_version;
+    mutable const Clue * m_versionData;
+    mutable size_t m_versionSize;
+
+    // Index: position of the first clue with a given number or word.
+    mutable std::unordered_map<string_t, size_t> m_numberIndex;
+    mutable std::unordered_map<int, size_t> m_intIndex;
+    mutable std::unordered_map<const Word *, size_t> m_wordIndex;
+    // The version that the index was built from
+    mutable unsigned long m_indexVersion;
+    mutable bool m_isIndexed;
+
+    void UpdateIndex() const;
+    void TakeIndex(ClueList & other);
+    template <typename MAP, typename KEY>
+    const Clue * Lookup(MAP & index, const KEY & key) const;
 };
 
+inline void Clue::Version::Bump()
+{
+    if (m_counter)
+        *m_counter = ClueList::NextVersion();
+}
+
 
 // This class holds all of the clues
 class PUZ_API Clues : public std::vector<std::pair<string_t, ClueList> >
 {
 public:
-    Clues() {}
+    Clues() : m_isIndexed(false) {}
+
+    // The lookup index is not copied
+    Clues(const Clues & other)
+        : std::vector<std::pair<string_t, ClueList> >(other), m_isIndexed(false)
+    {}
+
+    Clues & operator=(const Clues & other)
+    {
+        std::vector<std::pair<string_t, ClueList> >::operator=(other);
+        m_isIndexed = false;
+        return *this;
+    }
+
+    Clues(Clues && other)
+        : std::vector<std::pair<string_t, ClueList> >(std::move(other)),
+          m_isIndexed(false)
+    {
+        other.m_isIndexed = false;
+    }
+
+    Clues & operator=(Clues && other)
+    {
+        std::vector<std::pair<string_t, ClueList> >::operator=(std::move(other));
+        m_isIndexed = false;
+        other.m_isIndexed = false;
+        return *this;
+    }
 
     const ClueList & GetAcross() const { return GetClueList(puzT("Across")); }
           ClueList & GetAcross()       { return GetClueList(puzT("Across")); }
@@ -149,6 +267,11 @@ public:
     ClueList & operator[](const string_t & direction);
 
     ClueList & SetClueList(const string_t & direction, const ClueList & cluelist)
+    {
+        return SetClueList(direction, ClueList(cluelist));
+    }
+
+    ClueList & SetClueList(const string_t & direction, ClueList && cluelist)
     {
         // Normalize different capitalizations of "Across" and "Down", since these have special meaning.
         // We still retain the original direction in the title field.
@@ -160,7 +283,7 @@ public:
         else
             canonical_direction = direction;
 
-        operator[](canonical_direction) = cluelist;
+        operator[](canonical_direction) = std::move(cluelist);
         ClueList & ret = operator[](canonical_direction);
         if (ret.GetTitle().empty())
             ret.SetTitle(direction);
@@ -169,6 +292,16 @@ public:
 
     std::vector<std::pair<string_t, ClueList> >::iterator find(const string_t& direction);
     std::vector<std::pair<string_t, ClueList> >::const_iterator find(const string_t& direction) const;
+
+protected:
+    // Index: position of each direction.  This is rebuilt if the clue lists
+    // are added, removed, or reordered.
+    mutable std::unordered_map<string_t, size_t> m_index;
+    mutable const value_type * m_indexData;
+    mutable size_t m_indexSize;
+    mutable bool m_isIndexed;
+
+    size_t FindIndex(const string_t & direction) const;
 };
 
 } // namespace puz
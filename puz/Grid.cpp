@@ -22,12 +22,12 @@
 // Primary function is to hold a 2d array of Squares
 //
 // Diagram of our organization of the grid (as in a python list)
-// This is organized into a vector, m_vector.
-// Access is obtained internally as m_vector[row][col], but externally as
-//   Grid.at(col, row), i.e. Grid.at(x, y)
-// This organization is important to remember for all functions, but 
-//   especially for SetSize(width, height), which must first change the
-//   height (cols), then loop through each line (rows) and resize each one
+// The squares are stored row by row in a single vector, m_squares, so that
+// walking the grid (Next(ACROSS)) walks memory in order.
+// Access is obtained internally as m_squares[row * width + col], but
+//   externally as Grid.At(col, row), i.e. Grid.At(x, y)
+// This organization is important to remember for SetSize(width, height),
+//   which must move every square that remains in the grid to its new index.
 //
 // [ [ELGAR.ABCTV.NOW],
 //   [FOLIO.DELHI.OUR],
@@ -50,14 +50,24 @@
 #include "Grid.hpp"
 #include "iterator.hpp"
 #include "Scrambler.hpp"
+#include "GridNumbering.hpp"
 
 #include <map>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define PUZ_USE_SSE2 1
+#   include <emmintrin.h>
+#else
+#   define PUZ_USE_SSE2 0
+#endif
 
 namespace puz {
 
 
 Grid::Grid(size_t width, size_t height)
-    : m_width(0),
+    : m_data(new GridData),
+      m_width(0),
       m_height(0),
       m_type(TYPE_NORMAL),
       m_flag(FLAG_NORMAL),
@@ -74,7 +84,8 @@ Grid::Grid(size_t width, size_t height)
 // This copy constructor needs to adjust all of the Square pointers to refer
 // to the new Squares
 Grid::Grid(const Grid & other)
-    : m_vector(other.m_vector),
+    : m_squares(other.m_squares),
+      m_data(other.m_data ? new GridData(*other.m_data) : new GridData),
       m_width(other.m_width),
       m_height(other.m_height),
       m_type(other.m_type),
@@ -90,30 +101,76 @@ Grid::Grid(const Grid & other)
 }
 
 
+// Moving a grid takes its squares and data without copying them.  The
+// squares don't move in memory, so their pointers are still valid.
+// The moved-from grid is empty and has no data until it is assigned to,
+// resized, or cleared.
+Grid::Grid(Grid && other)
+    : m_squares(std::move(other.m_squares)),
+      m_data(std::move(other.m_data)),
+      m_width(other.m_width),
+      m_height(other.m_height),
+      m_type(other.m_type),
+      m_flag(other.m_flag),
+      m_key(other.m_key),
+      m_cksum(other.m_cksum),
+      m_first(other.m_first),
+      m_last(other.m_last)
+{
+    other.m_squares.clear();
+    other.m_width = 0;
+    other.m_height = 0;
+    other.m_first = NULL;
+    other.m_last = NULL;
+}
+
+
 Grid::~Grid()
 {
 }
 
 
+Grid &
+Grid::operator=(Grid other)
+{
+    swap(other);
+    return *this;
+}
+
+
 void
-Grid::SetSize(size_t width, size_t height)
+Grid::swap(Grid & other)
 {
-    m_vector.resize(height);
+    m_squares.swap(other.m_squares);
+    m_data.swap(other.m_data);
+    std::swap(m_width, other.m_width);
+    std::swap(m_height, other.m_height);
+    std::swap(m_first, other.m_first);
+    std::swap(m_last, other.m_last);
+    std::swap(m_type, other.m_type);
+    std::swap(m_flag, other.m_flag);
+    std::swap(m_key, other.m_key);
+    std::swap(m_cksum, other.m_cksum);
+}
 
-    // If the width changes, resize all of the nested vectors
-    if (width != m_width)
-    {
-        Grid_t::iterator it;
-        for (it = m_vector.begin(); it != m_vector.end(); ++it)
-            it->resize(width, GridSquare(Square()));
-    }
-    // Otherwise, if the height has increased, resize all of the new vectors
-    else if (height > m_height)
+
+void
+Grid::SetSize(size_t width, size_t height)
+{
+    if (! m_data) // Moved from
+        m_data.reset(new GridData);
+    if (width != m_width || height != m_height)
     {
-        // resize the remaining rows
-        Grid_t::iterator it;
-        for (it = m_vector.begin() + m_height; it != m_vector.end(); ++it)
-            it->resize(width, GridSquare(Square()));
+        // Copy the squares that are still in the grid to their new location.
+        Grid_t squares(width * height);
+        for (Grid_t::iterator it = squares.begin(); it != squares.end(); ++it)
+            it->m_square.m_data = m_data.get();
+        const size_t cols = std::min(width, m_width);
+        const size_t rows = std::min(height, m_height);
+        for (size_t row = 0; row < rows; ++row)
+            for (size_t col = 0; col < cols; ++col)
+                squares[row * width + col] = m_squares[row * m_width + col];
+        m_squares.swap(squares);
     }
 
     m_height = height;
@@ -128,7 +185,21 @@ Grid::SetupIteration()
     // Fill in Square members:
     //   - Row and Col
     //   - Next
+    //   - Grid data, and count the solve statistics
     //-------------------------------------------------------------------
+    m_data->stats = SolveStats();
+    // Squares may have moved, so start change tracking over with every
+    // square marked as changed.
+    m_data->width = m_width;
+    m_data->journal.clear();
+    m_data->dirty.assign(m_data->trackChanges ? m_squares.size() : 0, true);
+    m_data->dirtyCount = m_data->dirty.size();
+    const size_t size = m_squares.size();
+    m_data->text.resize(size);
+    m_data->solution.resize(size);
+    m_data->plainText.resize(size);
+    m_data->plainSolution.resize(size);
+    m_data->blank.resize(size);
     for (size_t row = 0; row < GetHeight(); ++row)
     {
         for (size_t col = 0; col < GetWidth(); ++col)
@@ -136,6 +207,9 @@ Grid::SetupIteration()
             Square & square = At(col, row);
             square.m_col = col;
             square.m_row = row;
+            square.m_data = m_data.get();
+            m_data->stats.Add(square.GetStatus());
+            m_data->UpdateSquare(square);
 
             // Special cases for width or height == 1
             if (GetHeight() == 1 && GetWidth() == 1)
@@ -256,18 +330,270 @@ Grid::SetupIteration()
     }
 }
 
-void Grid::NumberGrid()
+void
+SolveStats::Add(unsigned int status, int count)
+{
+    if (status & WHITE)            white += count;
+    if (status & BLACK)            black += count;
+    if (status & BLANK)            blank += count;
+    if (status & BLANK_CORRECT)    blankCorrect += count;
+    if (status & CORRECT)          correct += count;
+    if (status & INCORRECT)        incorrect += count;
+    if (status & STRICT_INCORRECT) strictIncorrect += count;
+    if (status & REVEALED)         revealed += count;
+    if (status & CHECKED)          checked += count;
+}
+
+unsigned int
+GridData::AddRebus(const string_t & str)
+{
+    std::map<string_t, unsigned int>::iterator it = rebusIndex.find(str);
+    if (it != rebusIndex.end())
+        return it->second;
+    unsigned int index = rebus.size();
+    rebus.push_back(str);
+    rebusIndex[str] = index;
+    return index;
+}
+
+int
+GridData::GetIndex(const Square & square) const
+{
+    // Squares that are being copied into a resized grid have no position yet
+    if (square.m_col < 0 || square.m_row < 0)
+        return -1;
+    return square.m_row * width + square.m_col;
+}
+
+//------------------------------------------------------------------------------
+// Checking
+//------------------------------------------------------------------------------
+
+void
+GridData::UpdateSquare(const Square & square)
+{
+    const int index = GetIndex(square);
+    if (index < 0 || static_cast<size_t>(index) >= text.size())
+        return;
+    text[index] = square.m_text.GetValue();
+    solution[index] = square.m_solution.GetValue();
+    if (square.HasTextRebus() && square.HasSolutionRebus())
+    {
+        plainText[index] = square.m_text.GetValue();
+        plainSolution[index] = square.m_solution.GetValue();
+    }
+    else
+    {
+        plainText[index] = static_cast<unsigned char>(square.GetPlainText());
+        plainSolution[index] = static_cast<unsigned char>(square.GetPlainSolution());
+    }
+    blank[index] = square.IsBlank() && ! square.IsSolutionBlank();
+}
+
+// This is Square::Check for squares begin through end - 1, comparing the
+// packed arrays.  With SSE2, 16 squares at a time.
+static void CheckRange(const GridData & data, size_t begin, size_t end,
+                       bool checkBlank, bool strictRebus,
+                       unsigned char * incorrect)
+{
+    const unsigned int * text = strictRebus ? &data.text[0]
+                                            : &data.plainText[0];
+    const unsigned int * solution = strictRebus ? &data.solution[0]
+                                                : &data.plainSolution[0];
+    const unsigned char * blank = &data.blank[0];
+    size_t i = begin;
+#if PUZ_USE_SSE2
+    const __m128i one = _mm_set1_epi8(1);
+    for (; i + 16 <= end; i += 16)
+    {
+        // 0xff where text == solution, narrowed from 32 to 8 bits
+        __m128i equal[4];
+        for (int j = 0; j < 4; ++j)
+        {
+            equal[j] = _mm_cmpeq_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i + 4 * j)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(solution + i + 4 * j)));
+        }
+        const __m128i same = _mm_packs_epi16(_mm_packs_epi32(equal[0], equal[1]),
+                                             _mm_packs_epi32(equal[2], equal[3]));
+        const __m128i different = _mm_andnot_si128(same, one);
+        const __m128i isBlank =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(blank + i));
+        const __m128i result = checkBlank ? _mm_or_si128(different, isBlank)
+                                          : _mm_andnot_si128(isBlank, different);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(incorrect + i), result);
+    }
+#endif // PUZ_USE_SSE2
+    if (checkBlank)
+    {
+        for (; i < end; ++i)
+            incorrect[i] = (text[i] != solution[i]) | blank[i];
+    }
+    else
+    {
+        for (; i < end; ++i)
+            incorrect[i] = (text[i] != solution[i]) & (blank[i] ^ 1);
+    }
+}
+
+void
+Grid::CheckGrid(std::vector<Square *> * incorrect, bool checkBlank, bool strictRebus)
+{
+    std::vector<unsigned char> isIncorrect;
+    CheckGrid(&isIncorrect, checkBlank, strictRebus);
+    for (size_t i = 0; i < isIncorrect.size(); ++i)
+        if (isIncorrect[i])
+            incorrect->push_back(&m_squares[i].m_square);
+}
+
+void
+Grid::CheckGrid(std::vector<unsigned char> * incorrect, bool checkBlank, bool strictRebus) const
+{
+    incorrect->assign(m_squares.size(), 0);
+    if (! m_squares.empty())
+        CheckRange(*m_data, 0, m_squares.size(), checkBlank, strictRebus,
+                   &(*incorrect)[0]);
+}
+
+void
+Grid::CheckWord(std::vector<Square *> * incorrect,
+                const Word * word, bool checkBlank, bool strictRebus)
+{
+    if (! word)
+        throw NoWord();
+    square_iterator it;
+    for (it = word->begin(); it != word->end(); ++it)
+    {
+        if (! it->Check(checkBlank, strictRebus))
+            incorrect->push_back(&At(it->GetCol(), it->GetRow()));
+    }
+}
+
+void
+Grid::CheckWord(std::vector<unsigned char> * incorrect,
+                const Word * word, bool checkBlank, bool strictRebus) const
 {
-    int clueNumber = 1;
+    if (! word)
+        throw NoWord();
+    incorrect->assign(m_squares.size(), 0);
+    square_iterator it;
+    for (it = word->begin(); it != word->end(); ++it)
+    {
+        const int index = m_data->GetIndex(*it);
+        if (index >= 0)
+            CheckRange(*m_data, index, index + 1,
+                       checkBlank, strictRebus, &(*incorrect)[0]);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Change tracking
+//------------------------------------------------------------------------------
 
-    for (Square * square = First();
-         square != NULL;
-         square = square->Next())
+void
+GridData::SetDirty(const Square & square)
+{
+    const int index = GetIndex(square);
+    if (index >= 0 && static_cast<size_t>(index) < dirty.size()
+        && ! dirty[index])
     {
-        if (square->WantsClue())
-            square->SetNumber(clueNumber++);
-        else
-            square->SetNumber(puzT(""));
+        dirty[index] = true;
+        ++dirtyCount;
+    }
+}
+
+void
+GridData::Record(Square * square, GridChange::Type type,
+                 unsigned int oldValue, unsigned int newValue)
+{
+    if (trackChanges)
+        SetDirty(*square);
+    if (journalEnabled)
+    {
+        GridChange change;
+        change.square = square;
+        change.type = type;
+        change.oldValue = oldValue;
+        change.newValue = newValue;
+        change.serial = ++serial;
+        change.time = std::time(NULL);
+        journal.push_back(change);
+    }
+}
+
+void
+Grid::TrackChanges(bool doit)
+{
+    m_data->trackChanges = doit;
+    ClearChanges();
+}
+
+void
+Grid::GetChanges(std::vector<Square *> * changed)
+{
+    if (m_data->dirtyCount == 0)
+        return;
+    std::vector<bool> & dirty = m_data->dirty;
+    for (size_t i = 0; i < dirty.size(); ++i)
+    {
+        if (dirty[i])
+        {
+            changed->push_back(&m_squares[i].m_square);
+            dirty[i] = false;
+        }
+    }
+    m_data->dirtyCount = 0;
+}
+
+void
+Grid::ClearChanges()
+{
+    m_data->dirty.assign(m_data->trackChanges ? m_squares.size() : 0, false);
+    m_data->dirtyCount = 0;
+}
+
+void
+Grid::EnableJournal(bool doit)
+{
+    m_data->journalEnabled = doit;
+    if (! doit)
+        ClearJournal();
+}
+
+void
+Grid::TakeJournal(std::vector<GridChange> * journal)
+{
+    journal->clear();
+    journal->swap(m_data->journal);
+}
+
+string_t
+Grid::GetString(SquareText text) const
+{
+    if (text.IsChar())
+        return string_t(1, text.GetChar());
+    if (text.IsSymbol())
+    {
+        string_t ret = puzT("[ ]");
+        ret[1] = text.GetChar();
+        return ret;
+    }
+    return m_data->rebus.at(text.GetIndex());
+}
+
+void Grid::NumberGrid()
+{
+    for (Grid_t::iterator it = m_squares.begin(); it != m_squares.end(); ++it)
+        if (it->m_square.HasNumber())
+            it->m_square.SetNumber(puzT(""));
+
+    GridNumbering numbering(*this, GridNumbering::NUMBER_TEXT);
+    std::vector<GridNumbering::Start>::const_iterator start;
+    for (start = numbering.GetStarts().begin();
+         start != numbering.GetStarts().end();
+         ++start)
+    {
+        start->square->SetNumber(start->number);
     }
 }
 
@@ -285,8 +611,8 @@ Grid::FindPartnerSquares()
                 typedef std::multimap<string_t, Square*>::iterator PartnerIterator;
                 std::pair<PartnerIterator, PartnerIterator> result = partner_map.equal_range(square.GetNumber());
                 for (PartnerIterator it = result.first; it != result.second; ++it) {
-                    (*it).second->m_partner.push_back(&square);
-                    square.m_partner.push_back((*it).second);
+                    (*it).second->GetExtra().partner.push_back(&square);
+                    square.GetExtra().partner.push_back((*it).second);
                 }
                 partner_map.insert(std::make_pair(square.GetNumber(), &square));
             }
@@ -318,27 +644,4 @@ Grid::CheckScrambledGrid() const
 
 
 
-void
-Grid::CheckGrid(std::vector<Square *> * incorrect, bool checkBlank, bool strictRebus)
-{
-    Square * square;
-    for (square = First(); square != NULL; square = square->Next())
-        if (! square->Check(checkBlank, strictRebus))
-            incorrect->push_back(square);
-}
-
-void
-Grid::CheckWord(std::vector<Square *> * incorrect,
-                const Word * word, bool checkBlank, bool strictRebus)
-{
-    if (! word)
-        throw NoWord();
-    square_iterator it;
-    for (it = word->begin(); it != word->end(); ++it)
-    {
-        if (! it->Check(checkBlank, strictRebus))
-            incorrect->push_back(&At(it->GetCol(), it->GetRow()));
-    }
-}
-
 } // namespace puz
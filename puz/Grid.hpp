@@ -20,6 +20,10 @@
 #define PUZ_GRID_H
 
 #include <vector>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <ctime>
 #include "Square.hpp"
 #include "Word.hpp"
 
@@ -71,6 +75,116 @@ public:
     Square m_square;
 };
 
+// Counts of squares in each state.  Squares update these whenever their
+// text, solution, or flags change, so reading them is O(1).
+// Correct and incorrect squares are checked as by Square::Check(false),
+// and strictIncorrect as by Square::Check(false, true).
+struct PUZ_API SolveStats
+{
+    SolveStats()
+        : white(0), black(0), blank(0), blankCorrect(0),
+          correct(0), incorrect(0), strictIncorrect(0),
+          revealed(0), checked(0)
+    {}
+
+    int white;           // Squares that are not black or missing
+    int black;           // Black squares
+    int blank;           // Blank white squares
+    int blankCorrect;    // Blank white squares with a blank solution
+    int correct;         // Filled white squares that are correct
+    int incorrect;       // Filled white squares that are incorrect
+    int strictIncorrect; // Incorrect, comparing rebus entries exactly
+    int revealed;        // Squares with FLAG_REVEALED
+    int checked;         // Squares with FLAG_X, FLAG_BLACK, or FLAG_CORRECT
+
+    // Square states (see Square::GetStatus)
+    enum
+    {
+        WHITE            = 0x001,
+        BLACK            = 0x002,
+        BLANK            = 0x004,
+        BLANK_CORRECT    = 0x008,
+        CORRECT          = 0x010,
+        INCORRECT        = 0x020,
+        STRICT_INCORRECT = 0x040,
+        REVEALED         = 0x080,
+        CHECKED          = 0x100
+    };
+
+    // Add (or remove) a square with the given status
+    void Add(unsigned int status, int count = 1);
+};
+
+// A change to one square, recorded in the grid's journal.
+// Text and solution values are SquareText values; use Grid::GetString to
+// get the text.  Flag values are Square flags.
+struct PUZ_API GridChange
+{
+    enum Type
+    {
+        TEXT,
+        SOLUTION,
+        FLAG
+    };
+
+    Square * square;
+    Type type;
+    unsigned int oldValue;
+    unsigned int newValue;
+    unsigned long serial; // Increases by one with each change to the grid
+    std::time_t time;
+
+    SquareText GetOldText() const { return SquareText(oldValue); }
+    SquareText GetNewText() const { return SquareText(newValue); }
+};
+
+// Grid data that squares refer to.  This is kept on the heap so that moving
+// or swapping a Grid doesn't need to touch every square.
+class PUZ_API GridData
+{
+public:
+    GridData()
+        : width(0), trackChanges(false), journalEnabled(false),
+          dirtyCount(0), serial(0)
+    {}
+
+    // Rebus entries used by squares in this grid (see SquareText)
+    std::vector<string_t> rebus;
+    std::map<string_t, unsigned int> rebusIndex;
+    unsigned int AddRebus(const string_t & str);
+
+    SolveStats stats;
+
+    // The arrays below are indexed by row * width + col
+    size_t width;
+    // Return a square's index, or -1 if it isn't in the grid yet
+    int GetIndex(const Square & square) const;
+
+    // Packed copies of each square's text and solution, for checking the
+    // whole grid at once (see Grid::CheckGrid)
+    std::vector<unsigned int> text;     // SquareText values
+    std::vector<unsigned int> solution;
+    // What Square::Check compares without strictRebus: the SquareText
+    // values if both are rebus entries, otherwise the plain characters.
+    std::vector<unsigned int> plainText;
+    std::vector<unsigned int> plainSolution;
+    // Blank text and a solution that isn't blank
+    std::vector<unsigned char> blank;
+    void UpdateSquare(const Square & square);
+
+    // Change tracking (see Grid::TrackChanges and Grid::EnableJournal)
+    bool trackChanges;
+    bool journalEnabled;
+    std::vector<bool> dirty;
+    size_t dirtyCount;
+    std::vector<GridChange> journal;
+    unsigned long serial;
+
+    void SetDirty(const Square & square);
+    void Record(Square * square, GridChange::Type type,
+                unsigned int oldValue, unsigned int newValue);
+};
+
 class PUZ_API Grid
 {
     friend class Scrambler;
@@ -80,8 +194,15 @@ class PUZ_API Grid
 public:
     explicit Grid(size_t width = 0, size_t height = 0);
     Grid(const Grid & other);
+    // Doesn't allocate.  The moved-from grid must be assigned to, resized,
+    // or cleared before it is used again.
+    Grid(Grid && other);
     ~Grid();
 
+    // Handles both copy and move assignment
+    Grid & operator=(Grid other);
+    void swap(Grid & other);
+
     // Setup
     //------
     // Fills in Square Next / Prev, etc.  Called automatically from SetSize.
@@ -114,21 +235,29 @@ public:
     // Access to squares provided as (x,y):
     // i.e. square "b4" is At(1, 3)
     const Square & At(size_t col, size_t row) const
-        { return m_vector.at(row).at(col).m_square; }
+    {
+        if (col >= m_width || row >= m_height)
+            throw std::out_of_range("Grid::At");
+        return m_squares[row * m_width + col].m_square;
+    }
     Square & At(size_t col, size_t row)
-        { return m_vector.at(row).at(col).m_square; }
+    {
+        if (col >= m_width || row >= m_height)
+            throw std::out_of_range("Grid::At");
+        return m_squares[row * m_width + col].m_square;
+    }
 
     const Square * AtNULL(int col, int row) const
     {
         if (col < 0 || col > LastCol() || row < 0 || row > LastRow())
             return NULL;
-        return &m_vector[row][col].m_square;
+        return &m_squares[row * m_width + col].m_square;
     }
     Square * AtNULL(int col, int row)
     {
         if (col < 0 || col > LastCol() || row < 0 || row > LastRow())
             return NULL;
-        return &m_vector[row][col].m_square;
+        return &m_squares[row * m_width + col].m_square;
     }
 
     // Searching
@@ -213,17 +342,59 @@ public:
     void CheckGrid(std::vector<Square *> * incorrect,
                    bool checkBlank = false,
                    bool strictRebus = false);
+    // Check every square at once.  (*incorrect)[row * width + col] is
+    // 1 if the square is incorrect, otherwise 0.
+    void CheckGrid(std::vector<unsigned char> * incorrect,
+                   bool checkBlank = false,
+                   bool strictRebus = false) const;
     void CheckWord(std::vector<Square *> * incorrect,
                    const Word * word,
                    bool checkBlank = false,
                    bool strictRebus = false);
+    // Only the squares in word are set in *incorrect.
+    void CheckWord(std::vector<unsigned char> * incorrect,
+                   const Word * word,
+                   bool checkBlank = false,
+                   bool strictRebus = false) const;
     bool CheckSquare(const Square & square, bool checkBlank = false,
                                             bool strictRebus = false) const
         { return square.Check(checkBlank, strictRebus); }
 
+    // Solve statistics, kept up to date as squares change
+    const SolveStats & GetStats() const { return m_data->stats; }
+
+    // Change tracking
+    //----------------
+    // Both of these are off by default.  Resizing or copying the grid
+    // clears the journal and marks every square as changed.
+
+    // Keep a set of squares whose text, solution, or flag has changed.
+    void TrackChanges(bool doit = true);
+    bool IsTrackingChanges() const { return m_data->trackChanges; }
+    bool HasChanges() const { return m_data->dirtyCount > 0; }
+    // Append the changed squares (in row-major order) and clear the set.
+    void GetChanges(std::vector<Square *> * changed);
+    void ClearChanges();
+
+    // Keep a log of every change to a square's text, solution, or flag.
+    void EnableJournal(bool doit = true);
+    bool IsJournalEnabled() const { return m_data->journalEnabled; }
+    const std::vector<GridChange> & GetJournal() const
+        { return m_data->journal; }
+    // Move the journal into *journal, leaving the grid's journal empty.
+    void TakeJournal(std::vector<GridChange> * journal);
+    void ClearJournal() { m_data->journal.clear(); }
+
+    // The text of a SquareText value (e.g. from GridChange)
+    string_t GetString(SquareText text) const;
+
 protected:
-    typedef std::vector< std::vector< GridSquare > > Grid_t;
-    Grid_t m_vector;
+    // All squares in a single row-major block: At(col, row) is
+    // m_squares[row * m_width + col]
+    typedef std::vector< GridSquare > Grid_t;
+    Grid_t m_squares;
+
+    std::unique_ptr<GridData> m_data;
 
     size_t m_width, m_height;
     Square * m_first;
@@ -251,6 +422,8 @@ Grid::Clear()
     m_first = NULL;
     m_last = NULL;
     SetSize(0,0);
+    m_data->rebus.clear();
+    m_data->rebusIndex.clear();
 }
 
 // Functions/functors for FindSquare
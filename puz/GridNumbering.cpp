@@ -0,0 +1,165 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "GridNumbering.hpp"
+#include "Grid.hpp"
+
+#if defined(_MSC_VER) && defined(_WIN64)
+#   include <intrin.h>
+#endif
+
+namespace puz {
+
+// Index of the lowest set bit.  bits must not be 0.
+static int CountTrailingZeros(unsigned long long bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    int index = 0;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+GridNumbering::GridNumbering(Grid & grid, Source source)
+    : m_grid(grid),
+      m_source(source),
+      m_words((grid.GetWidth() + 63) / 64)
+{
+    const size_t width = grid.GetWidth();
+    const size_t height = grid.GetHeight();
+    const size_t size = m_words * height;
+
+    // Pack white squares and bars.
+    // barRight has the bit for a square set if there is a bar between it
+    // and the square to its right; barDown likewise for the square below.
+    std::vector<bits_t> white(size), barRight(size), barDown(size);
+    for (size_t row = 0; row < height; ++row)
+    {
+        for (size_t col = 0; col < width; ++col)
+        {
+            const Square & square = grid.At(col, row);
+            const size_t word = row * m_words + col / 64;
+            const bits_t bit = bits_t(1) << (col % 64);
+            if (IsWhite(square))
+                white[word] |= bit;
+            if (square.m_bars[BAR_RIGHT])
+                barRight[word] |= bit;
+            if (square.m_bars[BAR_BOTTOM])
+                barDown[word] |= bit;
+            if (square.m_bars[BAR_LEFT] && col > 0)
+                barRight[row * m_words + (col - 1) / 64]
+                    |= bits_t(1) << ((col - 1) % 64);
+            if (square.m_bars[BAR_TOP] && row > 0)
+                barDown[word - m_words] |= bit;
+        }
+    }
+
+    // Find squares that continue a word across or down
+    m_right.assign(size, 0);
+    m_down.assign(size, 0);
+    for (size_t row = 0; row < height; ++row)
+    {
+        for (size_t k = 0; k < m_words; ++k)
+        {
+            const size_t i = row * m_words + k;
+            // The white bit of the next square across
+            bits_t next = white[i] >> 1;
+            if (k + 1 < m_words)
+                next |= white[i + 1] << 63;
+            m_right[i] = white[i] & next & ~barRight[i];
+            if (row + 1 < height)
+                m_down[i] = white[i] & white[i + m_words] & ~barDown[i];
+        }
+    }
+
+    // Words start at squares that continue a word, but do not continue the
+    // word from the previous square.
+    int number = 1;
+    for (size_t row = 0; row < height; ++row)
+    {
+        for (size_t k = 0; k < m_words; ++k)
+        {
+            const size_t i = row * m_words + k;
+            bits_t prev = m_right[i] << 1;
+            if (k > 0)
+                prev |= m_right[i - 1] >> 63;
+            const bits_t across = m_right[i] & ~prev;
+            const bits_t down = m_down[i] & ~(row > 0 ? m_down[i - m_words] : 0);
+            for (bits_t starts = across | down; starts != 0; starts &= starts - 1)
+            {
+                const int bit = CountTrailingZeros(starts);
+                Start start;
+                start.square = &grid.At(k * 64 + bit, row);
+                start.number = number++;
+                start.across = ((across >> bit) & 1) != 0;
+                start.down = ((down >> bit) & 1) != 0;
+                m_starts.push_back(start);
+            }
+        }
+    }
+}
+
+bool
+GridNumbering::IsWhite(const Square & square) const
+{
+    return m_source == NUMBER_SOLUTION ? square.IsSolutionWhite()
+                                       : square.IsWhite();
+}
+
+Square *
+GridNumbering::GetWordEnd(Square * square, GridDirection dir) const
+{
+    if (dir != ACROSS && dir != DOWN)
+        return m_source == NUMBER_SOLUTION ? square->GetSolutionWordEnd(dir)
+                                           : square->GetWordEnd(dir);
+    if (! IsWhite(*square))
+        return NULL;
+    int col = square->GetCol();
+    int row = square->GetRow();
+    if (dir == DOWN)
+    {
+        while (Test(m_down, col, row))
+            ++row;
+        return &m_grid.At(col, row);
+    }
+    // The word ends at the first square that doesn't continue it.  The
+    // last square in each row never continues a word, so this stops within
+    // the row.
+    const bits_t * right = &m_right[row * m_words];
+    size_t k = col / 64;
+    bits_t stop = ~right[k] >> (col % 64);
+    while (stop == 0)
+    {
+        ++k;
+        col = k * 64;
+        stop = ~right[k];
+    }
+    return &m_grid.At(col + CountTrailingZeros(stop), row);
+}
+
+} // namespace puz
@@ -0,0 +1,88 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_GRID_NUMBERING_H
+#define PUZ_GRID_NUMBERING_H
+
+#include <vector>
+#include "Square.hpp"
+
+namespace puz {
+
+class Grid;
+
+// The clue numbering of a grid, found in one pass over the grid.
+//
+// Each row of white squares is packed into a bitmap, along with the bars
+// between squares.  Squares that start (or continue) across and down words
+// are then found with a few bit operations per 64 squares, instead of
+// walking each square's neighbors.
+//
+// Numbering the solution gives the same results as
+// Square::SolutionWantsClue and Square::GetSolutionWordEnd; numbering the
+// text gives the same results as Square::WantsClue and
+// Square::GetWordEnd.  The numbering is not updated when the grid changes.
+class GridNumbering
+{
+public:
+    enum Source
+    {
+        NUMBER_TEXT,
+        NUMBER_SOLUTION
+    };
+
+    GridNumbering(Grid & grid, Source source = NUMBER_SOLUTION);
+
+    // A square that wants a clue
+    struct Start
+    {
+        Square * square;
+        int number;
+        bool across;
+        bool down;
+    };
+
+    // Clue starts in grid order, numbered from 1
+    const std::vector<Start> & GetStarts() const { return m_starts; }
+
+    // Return the last square in the word that contains square, like
+    // Square::GetWordEnd.
+    Square * GetWordEnd(Square * square, GridDirection dir) const;
+
+private:
+    typedef unsigned long long bits_t;
+
+    Grid & m_grid;
+    Source m_source;
+    size_t m_words; // bits_t per row
+
+    // Row-major bitmaps: bit (col % 64) of m_x[row * m_words + col / 64]
+    std::vector<bits_t> m_right; // White, followed by a white square across
+    std::vector<bits_t> m_down;  // White, followed by a white square down
+    std::vector<Start> m_starts;
+
+    bool IsWhite(const Square & square) const;
+    bool Test(const std::vector<bits_t> & bits, int col, int row) const
+    {
+        return (bits[row * m_words + col / 64] >> (col % 64)) & 1;
+    }
+};
+
+} // namespace puz
+
+#endif // PUZ_GRID_NUMBERING_H
@@ -17,7 +17,12 @@
 
 
 #include "Puzzle.hpp"
+#include "GridNumbering.hpp"
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <vector>
 
 // Format handlers
 #include "formats/jpz/jpz.hpp"
@@ -25,6 +30,8 @@
 #include "formats/xpf/xpf.hpp"
 #include "formats/puz/puz.hpp"
 #include "formats/txt/txt.hpp"
+#include "formats/xwa/xwa.hpp"
+#include "formats/xws/xws.hpp"
 
 namespace puz {
 
@@ -38,12 +45,7 @@ Puzzle::DoLoad(const std::string & filename, const FileHandlerDesc * desc)
     Clear();
     try {
         desc->handler(this, filename.c_str(), desc->data);
-        if (! m_clues.HasWords())
-            GenerateWords();
-        MarkThemeSquares();
-        FixMalformattedDiagramless();
-        m_grid.FindPartnerSquares();
-        TestOk();
+        OnLoad();
     }
     catch (std::ios::failure &) {
         m_formatData.reset();
@@ -55,6 +57,69 @@ Puzzle::DoLoad(const std::string & filename, const FileHandlerDesc * desc)
     }
 }
 
+void
+Puzzle::DoLoad(const char * data, size_t length, const FileHandlerDesc * desc)
+{
+    Clear();
+    try {
+        desc->bufferHandler(this, data, length, desc->data);
+        OnLoad();
+    }
+    catch (std::ios::failure &) {
+        m_formatData.reset();
+        throw LoadError("Unexpected end of file");
+    }
+    catch (...) {
+        m_formatData.reset();
+        throw;
+    }
+}
+
+// Finish setting up a puzzle after the handler has loaded it
+void
+Puzzle::OnLoad()
+{
+    if (! m_clues.HasWords())
+        GenerateWords();
+    MarkThemeSquares();
+    FixMalformattedDiagramless();
+    m_grid.FindPartnerSquares();
+    TestOk();
+}
+
+// Return the load handlers in the order they should be tried.
+// Handlers whose probe recognizes the data come first, most confident
+// first, followed by the handler for the file extension, followed by the
+// rest in their usual order.
+typedef std::vector<const Puzzle::FileHandlerDesc *> handler_list;
+typedef std::pair<int, const Puzzle::FileHandlerDesc *> handler_score;
+
+static bool HigherScore(const handler_score & a, const handler_score & b)
+{
+    return a.first > b.first;
+}
+
+static handler_list
+SortLoadHandlers(const char * data, size_t length, const std::string & ext)
+{
+    std::vector<handler_score> scores;
+    for (const Puzzle::FileHandlerDesc * desc = &Puzzle::sm_loadHandlers[0];
+         desc->handler != NULL;
+         ++desc)
+    {
+        // Scale the scores so the extension breaks ties
+        int score = desc->probe ? desc->probe(data, length) * 2 : 0;
+        if (ext == desc->ext)
+            ++score;
+        scores.push_back(handler_score(score, desc));
+    }
+    std::stable_sort(scores.begin(), scores.end(), HigherScore);
+    handler_list handlers;
+    for (size_t i = 0; i < scores.size(); ++i)
+        handlers.push_back(scores[i].second);
+    return handlers;
+}
+
 void
 Puzzle::Load(const std::string & filename, const FileHandlerDesc * desc)
 {
@@ -70,27 +135,20 @@ Puzzle::Load(const std::string & filename, const FileHandlerDesc * desc)
         // If loading throws a different error (EOF or LoadError), it means
         // that the file type isn't wrong, it just wasn't loaded.
 
-        // Prefer the handler with the correct extension
-        const FileHandlerDesc * expectedHandler
-            = FindLoadHandler(GetExtension(filename));
-        if (expectedHandler)
+        // Look at the start of the file to guess the format.  Usually
+        // the first handler is the right one.
+        char head[PROBE_SIZE];
+        std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+        stream.read(head, PROBE_SIZE);
+        const size_t length = stream.gcount();
+        stream.close();
+
+        const handler_list handlers
+            = SortLoadHandlers(head, length, GetExtension(filename));
+        for (size_t i = 0; i < handlers.size(); ++i)
         {
             try {
-                DoLoad(filename, expectedHandler);
-                return;
-            }
-            catch (FileTypeError &) {
-                // Do nothing
-            }
-        }
-        // Try all the handlers
-        for (desc = &sm_loadHandlers[0]; desc->handler != NULL; ++desc)
-        {
-            // We've already tried the expected handler
-            if (desc == expectedHandler)
-                continue;
-            try {
-                DoLoad(filename, desc);
+                DoLoad(filename, handlers[i]);
                 return;
             }
             catch (FileTypeError &) {
@@ -101,6 +159,43 @@ Puzzle::Load(const std::string & filename, const FileHandlerDesc * desc)
     }
 }
 
+void
+Puzzle::LoadBuffer(const char * data, size_t length, const FileHandlerDesc * desc)
+{
+    m_formatData.reset();
+    if (desc)
+    {
+        if (! desc->bufferHandler)
+            throw MissingHandler();
+        DoLoad(data, length, desc);
+        return;
+    }
+    // Try the handlers in order of their probes (see Load).
+    const handler_list handlers
+        = SortLoadHandlers(data, length < PROBE_SIZE ? length : PROBE_SIZE, "");
+    for (size_t i = 0; i < handlers.size(); ++i)
+    {
+        if (! handlers[i]->bufferHandler)
+            continue;
+        try {
+            DoLoad(data, length, handlers[i]);
+            return;
+        }
+        catch (FileTypeError &) {
+            // Do nothing
+        }
+    }
+    throw MissingHandler();
+}
+
+void
+Puzzle::LoadStream(std::istream & stream, const FileHandlerDesc * desc)
+{
+    const std::string data((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+    LoadBuffer(data, desc);
+}
+
 void
 Puzzle::LoadIpuzString(const std::string & data)
 {
@@ -134,6 +229,9 @@ void Puzzle::NumberClues()
 {
     ClueList & across_clues = GetClueList(puzT("Across"));
     ClueList & down_clues = GetClueList(puzT("Down"));
+    // Clue numbers are changed in place
+    across_clues.InvalidateIndex();
+    down_clues.InvalidateIndex();
 
     ClueList::iterator across = across_clues.begin();
     ClueList::iterator down   = down_clues.begin();
@@ -142,35 +240,27 @@ void Puzzle::NumberClues()
     ClueList::iterator down_end   = down_clues.end();
 
     // Number the clues based on the grid solution
-    int clueNumber = 1;
-    for (Square * square = m_grid.First();
-         square != NULL;
-         square = square->Next())
+    GridNumbering numbering(m_grid);
+    std::vector<GridNumbering::Start>::const_iterator start;
+    for (start = numbering.GetStarts().begin();
+         start != numbering.GetStarts().end();
+         ++start)
     {
-        if (! square->IsSolutionWhite())
-            continue;
-
-        const bool wantsAcross = square->SolutionWantsClue(ACROSS);
-        const bool wantsDown   = square->SolutionWantsClue(DOWN);
-
-        if (wantsAcross)
+        if (start->across)
         {
             if (across == across_end)
                 throw InvalidClues();
-            across->SetNumber(clueNumber);
+            across->SetNumber(start->number);
             ++across;
         }
 
-        if (wantsDown)
+        if (start->down)
         {
             if (down == down_end)
                 throw InvalidClues();
-            down->SetNumber(clueNumber);
+            down->SetNumber(start->number);
             ++down;
         }
-
-        if (wantsAcross || wantsDown)
-            ++clueNumber;
     }
     if (across != across_end || down != down_end)
         throw InvalidClues();
@@ -186,7 +276,8 @@ template <typename T> int sign(T val)
 // Number the grid, set the clues, and create words
 void Puzzle::SetAllClues(const std::vector<string_t> & clues)
 {
-    NumberGrid();
+    // Words are generated below, once the clues are set
+    m_grid.NumberGrid();
 
     ClueList across = ClueList();
     ClueList down   = ClueList();
@@ -195,39 +286,31 @@ void Puzzle::SetAllClues(const std::vector<string_t> & clues)
     std::vector<string_t>::const_iterator clue_end = clues.end();
 
     // Number the clues based on the grid solution
-    int clueNumber = 1;
-    for (Square * square = m_grid.First();
-         square != NULL;
-         square = square->Next())
+    GridNumbering numbering(m_grid);
+    std::vector<GridNumbering::Start>::const_iterator start;
+    for (start = numbering.GetStarts().begin();
+         start != numbering.GetStarts().end();
+         ++start)
     {
-        if (! square->IsSolutionWhite())
-            continue;
-
-        const bool wantsAcross = square->SolutionWantsClue(ACROSS);
-        const bool wantsDown   = square->SolutionWantsClue(DOWN);
-
-        if (wantsAcross)
+        if (start->across)
         {
             if (clue_it == clue_end)
                 throw InvalidClues();
-            across.push_back(Clue(clueNumber, *clue_it));
+            across.push_back(Clue(start->number, *clue_it));
             ++clue_it;
         }
 
-        if (wantsDown)
+        if (start->down)
         {
             if (clue_it == clue_end)
                 throw InvalidClues();
-            down.push_back(Clue(clueNumber, *clue_it));
+            down.push_back(Clue(start->number, *clue_it));
             ++clue_it;
         }
-
-        if (wantsAcross || wantsDown)
-            ++clueNumber;
     }
 
-    SetClueList(puzT("Across"), across);
-    SetClueList(puzT("Down"), down);
+    SetClueList(puzT("Across"), std::move(across));
+    SetClueList(puzT("Down"), std::move(down));
 
     if (clue_it != clue_end)
         throw InvalidClues();
@@ -240,19 +323,45 @@ void Puzzle::NumberGrid()
     GenerateWords();
 }
 
+// Return the number for a clue number that is written the usual way
+// (digits without leading zeros) and is at most maxNumber, otherwise -1.
+static int ToClueNumber(const string_t & str, size_t maxNumber)
+{
+    if (str.empty() || str.length() > 9 || (str[0] == puzT('0') && str.length() > 1))
+        return -1;
+    const int number = ToInt(str);
+    if (number < 0 || static_cast<size_t>(number) > maxNumber)
+        return -1;
+    return number;
+}
+
 void Puzzle::GenerateWords()
 {
     if (IsDiagramless())
         return;
-    // Simulate numbering the grid (solution) so that we can generate words
+    // Look up squares by clue number.  Plain numbers (the usual case) go
+    // in a dense array; anything else goes in a map.
+    const size_t maxNumber = m_grid.GetWidth() * m_grid.GetHeight();
+    std::vector<Square *> numberIndex;
     std::map<string_t, Square *> wordMap;
     for (Square * square = m_grid.First();
          square != NULL;
          square = square->Next())
     {
-        if (square->HasNumber())
+        if (! square->HasNumber())
+            continue;
+        const int number = ToClueNumber(square->GetNumber(), maxNumber);
+        if (number < 0)
+        {
             wordMap[square->GetNumber()] = square;
+            continue;
+        }
+        if (static_cast<size_t>(number) >= numberIndex.size())
+            numberIndex.resize(number + 1);
+        numberIndex[number] = square;
     }
+    // Simulate numbering the grid (solution) so that we can generate words
+    GridNumbering numbering(m_grid);
 
     Clues::iterator cluelist_it;
     GridDirection dir;
@@ -271,17 +380,29 @@ void Puzzle::GenerateWords()
         for (clue = cluelist.begin(); clue != cluelist.end(); ++clue)
         {
             // Find the square with this clue number.
-            std::map<string_t, Square*>::iterator map_it;
-            map_it = wordMap.find(clue->GetNumber());
-            if (map_it == wordMap.end())
+            Square * start = NULL;
+            const int number = ToClueNumber(clue->GetNumber(), maxNumber);
+            if (number >= 0)
+            {
+                if (static_cast<size_t>(number) < numberIndex.size())
+                    start = numberIndex[number];
+            }
+            else
+            {
+                std::map<string_t, Square*>::iterator map_it;
+                map_it = wordMap.find(clue->GetNumber());
+                if (map_it != wordMap.end())
+                    start = map_it->second;
+            }
+            if (! start)
                 throw InvalidClues("All Clues must have a word");
-            Square * start = map_it->second;
-            Square * end = start->GetSolutionWordEnd(dir);
+            Square * end = numbering.GetWordEnd(start, dir);
             if (! end)
                 throw InvalidClues("All clues must have a word");
             clue->SetWord(Word(start, end));
         }
     }
+    m_wordIndex.Build(m_grid, m_clues);
 }
 
 
@@ -417,61 +538,24 @@ Puzzle::FindWord(const puz::Square * square) const
     return &clue->GetWord();
 }
 
+const WordIndex &
+Puzzle::GetWordIndex() const
+{
+    if (! m_wordIndex.IsValid(m_grid, m_clues))
+        m_wordIndex.Build(m_grid, m_clues);
+    return m_wordIndex;
+}
+
 const Word *
 Puzzle::FindWord(const puz::Square * square, short direction) const
 {
-    // Prefer words that start on square.  Otherwise use words that contain
-    // square.  Prefer words where square is closest to the start.
-    const Word * bestWord = NULL;
-    int distance = -1;
-    // Prefer words in exactly the specified direction.
-    // If we can't find any of those, return a word in the inverse
-    // direction.
-    short inverseDirection = InvertDirection(direction);
-    const Word * inverseWord = NULL;
-
-    Clues::const_iterator it;
-    for (it = m_clues.begin(); it != m_clues.end(); ++it)
-    {
-        const ClueList & cluelist = it->second;
-        ClueList::const_iterator clue;
-        for (clue = cluelist.begin(); clue != cluelist.end(); ++clue)
-        {
-            const Word * word = &clue->GetWord();
-            int d = word->FindSquare(square);
-            if (d == -1)
-                continue;
-            short wordDirection = word->GetDirection();
-            if (wordDirection == direction)
-            {
-                if (d == 0)
-                    return word;
-                else if (distance == -1 || d <  distance)
-                {
-                    bestWord = word;
-                    distance = d;
-                }
-            }
-            else if (wordDirection == inverseDirection)
-                inverseWord = word;
-        }
-    }
-    if (bestWord)
-        return bestWord;
-    return inverseWord;
+    return GetWordIndex().FindWord(m_grid, square, direction);
 }
 
 const Clue *
 Puzzle::FindClue(const puz::Square * square) const
 {
-    Clues::const_iterator it;
-    for (it = m_clues.begin(); it != m_clues.end(); ++it)
-    {
-        const Clue * clue = it->second.Find(square);
-        if (clue)
-            return clue;
-    }
-    return NULL;
+    return GetWordIndex().FindClue(m_grid, square);
 }
 
 const Clue *
@@ -601,25 +685,49 @@ Puzzle::FindSaveHandler(const std::string & ext)
 }
 
 
+const Puzzle::FileHandlerDesc *
+Puzzle::DetectHandler(const char * data, size_t length, int * confidence)
+{
+    const FileHandlerDesc * best = NULL;
+    int best_score = 0;
+    if (length > PROBE_SIZE)
+        length = PROBE_SIZE;
+    for (const FileHandlerDesc * d = sm_loadHandlers; d->handler != NULL; ++d)
+    {
+        const int score = d->probe ? d->probe(data, length) : 0;
+        if (score > best_score)
+        {
+            best = d;
+            best_score = score;
+        }
+    }
+    if (confidence)
+        *confidence = best_score;
+    return best;
+}
+
+
 // -----------------------------------------------------------------------
 // Load and save handlers
 // -----------------------------------------------------------------------
 
 // Load handlers
 const Puzzle::FileHandlerDesc Puzzle::sm_loadHandlers[] = {
-    { LoadPuz, "puz", puzT("Across Lite"), NULL },
-    { LoadTxt, "txt", puzT("Across Lite Text"), NULL },
-    { LoadXPF, "xml", puzT("XPF"), NULL },
-    { LoadJpz, "jpz", puzT("jpuz"), NULL },
-    { LoadIpuz,"ipuz", puzT("ipuz"), NULL },
-    { NULL, NULL, NULL }
+    { LoadPuz, "puz", puzT("Across Lite"), NULL, LoadPuzBuffer, ProbePuz },
+    { LoadTxt, "txt", puzT("Across Lite Text"), NULL, LoadTxtBuffer, ProbeTxt },
+    { LoadXPF, "xml", puzT("XPF"), NULL, LoadXPFBuffer, ProbeXPF },
+    { LoadJpz, "jpz", puzT("jpuz"), NULL, LoadJpzBuffer, ProbeJpz },
+    { LoadIpuz,"ipuz", puzT("ipuz"), NULL, LoadIpuzBuffer, ProbeIpuz },
+    { LoadXwa, "xwa", puzT("XWord archive"), NULL, LoadXwaBuffer, ProbeXwa },
+    { LoadXws, "xws", puzT("XWord snapshot"), NULL, LoadXwsBuffer, ProbeXws },
+    { NULL, NULL, NULL, NULL, NULL, NULL }
 };
 
 const Puzzle::FileHandlerDesc Puzzle::sm_saveHandlers[] = {
-    { SavePuz, "puz", puzT("Across Lite"), NULL },
-    { SaveXPF, "xml", puzT("XPF"), NULL },
-    { SaveJpz, "jpz", puzT("jpuz"), NULL },
-    { NULL, NULL, NULL }
+    { SavePuz, "puz", puzT("Across Lite"), NULL, NULL, NULL },
+    { SaveXPF, "xml", puzT("XPF"), NULL, NULL, NULL },
+    { SaveJpz, "jpz", puzT("jpuz"), NULL, NULL, NULL },
+    { NULL, NULL, NULL, NULL, NULL, NULL }
 };
 
 // -----------------------------------------------------------------------
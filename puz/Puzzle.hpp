@@ -22,11 +22,14 @@
 #include "Grid.hpp"
 #include "Clue.hpp"
 #include "Word.hpp"
+#include "WordIndex.hpp"
 #include "puzstring.hpp"
 #include <vector>
 #include <cassert>
 #include <memory>
 #include <map>
+#include <iosfwd>
+#include <utility>
 
 namespace puz {
 
@@ -40,7 +43,7 @@ public:
         : m_time(0),
           m_isTimerRunning(false),
           m_isOk(false),
-          m_formatData(NULL)
+          m_formatData()
     {}
 
     explicit Puzzle(const std::string & filename,
@@ -48,16 +51,32 @@ public:
         : m_time(0),
           m_isTimerRunning(false),
           m_isOk(false),
-          m_formatData(NULL)
+          m_formatData()
     {
         Load(filename, desc);
     }
 
+    // Puzzles can be moved but not copied
+    Puzzle(Puzzle && other) = default;
+    Puzzle & operator=(Puzzle && other) = default;
+
     ~Puzzle() {}
 
     void Load(const std::string & filename,
               const FileHandlerDesc * handler = NULL);
 
+    // Load a puzzle from memory.
+    // If handler is NULL, try each handler that can load from memory.
+    void LoadBuffer(const char * data, size_t length,
+                    const FileHandlerDesc * handler = NULL);
+    void LoadBuffer(const std::string & data,
+                    const FileHandlerDesc * handler = NULL)
+    {
+        LoadBuffer(data.data(), data.size(), handler);
+    }
+    void LoadStream(std::istream & stream,
+                    const FileHandlerDesc * handler = NULL);
+
     // For lua, to simplify puzzle loading
     void LoadIpuzString(const std::string & data);
 
@@ -131,6 +150,12 @@ public:
     const std::vector<std::pair<string_t, string_t> > GetAllNotes() const;
 
     // Words
+    // FindWord and FindClue use an index of the words that contain each
+    // square.  The index is built by GenerateWords, and rebuilt when the
+    // grid or the clue lists change (see ClueList::GetVersion).  Call
+    // InvalidateWordIndex after setting Clue::word or changing a word in
+    // place through Clue::GetWord.
+    void InvalidateWordIndex() { m_wordIndex.Invalidate(); }
     const Word * FindWord(const puz::Square * square) const;
           Word * FindWord(const puz::Square * square);
     const Word * FindWord(const puz::Square * square, short direction) const;
@@ -156,13 +181,23 @@ public:
           { return m_clues.GetClueList(direction); }
 
     ClueList & SetClueList(const string_t & direction, const ClueList & clues)
-          { return m_clues.SetClueList(direction, clues); }
+    {
+        m_wordIndex.Invalidate();
+        return m_clues.SetClueList(direction, clues);
+    }
+
+    ClueList & SetClueList(const string_t & direction, ClueList && clues)
+    {
+        m_wordIndex.Invalidate();
+        return m_clues.SetClueList(direction, std::move(clues));
+    }
 
     // Grid
     // ----
     const Grid & GetGrid() const { return m_grid; }
           Grid & GetGrid()       { return m_grid; }
-    void SetGrid(const Grid & grid) { m_grid = grid; }
+    void SetGrid(const Grid & grid) { m_grid = grid; m_wordIndex.Invalidate(); }
+    void SetGrid(Grid && grid) { m_grid = std::move(grid); m_wordIndex.Invalidate(); }
     bool IsDiagramless() const { return m_grid.IsDiagramless(); }
     void ConvertDiagramlessToNormal();
 
@@ -193,18 +228,30 @@ public:
     // Load / Save
     // -------------------------------------------------------------------
     typedef void (*FileHandler)(Puzzle *, const std::string &, void *);
+    typedef void (*BufferHandler)(Puzzle *, const char *, size_t, void *);
+    typedef int (*ProbeHandler)(const char *, size_t);
 
     // The load and save functions are passed a void pointer with whatever
     // data the handler needs. This is kind of hackish and mostly just
     // for lua, but it might be useful at some other point.
+    // Load handlers that can read from memory also have a bufferHandler
+    // (NULL otherwise).
+    // Load handlers can also have a probe, which looks at the start of a
+    // file and returns how likely it is that the handler can load it,
+    // from 0 (not at all) to 100 (certain).
     struct PUZ_API FileHandlerDesc
     {
         FileHandler handler;
         const char * ext;
         const char_t * desc;
         void * data;
+        BufferHandler bufferHandler;
+        ProbeHandler probe;
     };
 
+    // The number of bytes at the start of a file that are given to probes
+    static const size_t PROBE_SIZE = 4096;
+
     static const FileHandlerDesc sm_loadHandlers[];
     static const FileHandlerDesc sm_saveHandlers[];
 
@@ -214,6 +261,13 @@ public:
     static const FileHandlerDesc * FindLoadHandler(const std::string & ext);
     static const FileHandlerDesc * FindSaveHandler(const std::string & ext);
 
+    // Return the load handler that is most likely to load a file that
+    // starts with data, or NULL if no handler recognizes the data.
+    // If confidence is given, it is set to the handler's probe result.
+    static const FileHandlerDesc * DetectHandler(const char * data,
+                                                 size_t length,
+                                                 int * confidence = NULL);
+
     // Load/save data
     // This class should be derived from to implement a puzzle format-specific
     // userdata that can be used to save unknown sections.
@@ -244,13 +298,17 @@ protected:
 
     Clues m_clues;
     Grid m_grid;
+    mutable WordIndex m_wordIndex;
+    const WordIndex & GetWordIndex() const;
 
     bool m_isOk;
-    std::auto_ptr<FormatData> m_formatData;
+    std::unique_ptr<FormatData> m_formatData;
 
 private:
     void TestClueList(const string_t & direction);
     void DoLoad(const std::string & filename, const FileHandlerDesc * desc);
+    void DoLoad(const char * data, size_t length, const FileHandlerDesc * desc);
+    void OnLoad();
 };
 
 
@@ -262,6 +320,7 @@ Puzzle::Clear()
     m_metadata.clear();
     m_grid.Clear();
     m_clues.clear();
+    m_wordIndex.Invalidate();
     m_time = 0;
     m_isTimerRunning = false;
 }
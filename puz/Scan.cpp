@@ -0,0 +1,90 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+
+#include "Scan.hpp"
+#include "Puzzle.hpp"
+#include "formats/puz/puz.hpp"
+#include "utils/filemap.hpp"
+
+namespace puz {
+
+// Summarize a puzzle that has already been loaded
+static void ScanPuzzle(const Puzzle & puz, ScanInfo * info)
+{
+    const Grid & grid = puz.GetGrid();
+    info->title = puz.GetTitle();
+    info->author = puz.GetAuthor();
+    info->width = grid.GetWidth();
+    info->height = grid.GetHeight();
+    info->type = grid.GetType();
+    info->flag = grid.GetFlag();
+    info->time = puz.GetTime();
+    info->isTimerRunning = puz.IsTimerRunning();
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        if (! square->IsSolutionWhite())
+            continue;
+        ++info->white;
+        if (! square->IsBlank())
+            ++info->filled;
+        else if (! square->IsSolutionBlank())
+        {
+            ++info->blank;
+            if (square->HasFlag(FLAG_X | FLAG_REVEALED | FLAG_BLACK))
+                ++info->marked;
+        }
+    }
+}
+
+ScanInfo Scan(const char * data, size_t length)
+{
+    ScanInfo info;
+    if (ProbePuz(data, length) > 0)
+    {
+        ScanPuz(data, length, &info);
+    }
+    else
+    {
+        Puzzle puz;
+        puz.LoadBuffer(data, length);
+        ScanPuzzle(puz, &info);
+    }
+    return info;
+}
+
+bool VerifyChecksums(const char * data, size_t length)
+{
+    if (ProbePuz(data, length) > 0)
+        return TestPuzChecksums(data, length);
+    return true;
+}
+
+ScanInfo Scan(const std::string & filename)
+{
+    // Mapping the file means that only the parts of a .puz file that are
+    // scanned are actually read.
+    file_map file;
+    if (! file.Open(filename))
+        throw FileError(filename);
+    return Scan(file.data(), file.size());
+}
+
+} // namespace puz
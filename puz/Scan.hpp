@@ -0,0 +1,69 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+
+#ifndef PUZ_SCAN_H
+#define PUZ_SCAN_H
+
+#include "puzstring.hpp"
+#include <string>
+
+namespace puz {
+
+// A summary of a puzzle file, for listing many puzzles at once.
+struct PUZ_API ScanInfo
+{
+    ScanInfo()
+        : width(0), height(0), type(0), flag(0),
+          time(0), isTimerRunning(false),
+          white(0), filled(0), blank(0), marked(0)
+    {}
+
+    string_t title;
+    string_t author;
+    int width;
+    int height;
+    unsigned short type; // GridType
+    unsigned short flag; // GridFlag
+    int time;
+    bool isTimerRunning;
+
+    // Progress.  Only squares with a white solution are counted.
+    int white;  // White squares
+    int filled; // White squares with an entry
+    int blank;  // White squares without an entry (but with a solution)
+    int marked; // Blank squares that have been checked or revealed
+
+    bool IsStarted() const { return filled > 0 || marked > 0 || time > 0; }
+    bool IsComplete() const { return filled > 0 && blank == 0; }
+};
+
+// Scan a puzzle file without loading the whole puzzle.
+// .puz files are scanned directly: only the header, grids, and sections
+// are read, and no clues or words are created.  Other formats are loaded
+// normally.  Throws the same exceptions as Puzzle::Load.
+PUZ_API ScanInfo Scan(const std::string & filename);
+PUZ_API ScanInfo Scan(const char * data, size_t length);
+
+// Return false if a .puz file's checksums don't match its contents.
+// Other formats don't have checksums, and always return true.
+PUZ_API bool VerifyChecksums(const char * data, size_t length);
+
+} // namespace puz
+
+#endif // PUZ_SCAN_H
@@ -110,7 +110,7 @@ Scrambler::ScrambleSolution(unsigned short key_int)
 
         // Make sure we preserve any rebus in the solution
         if (! square->HasSolutionRebus())
-            square->SetSolution(decode_puz(std::string(1, *it)));
+            square->SetSolution(static_cast<char_t>(*it)); // Always A-Z
         else
             square->SetPlainSolution(*it);
         ++it;
@@ -278,7 +278,7 @@ Scrambler::UnscrambleSolution(unsigned short key_int)
 
         // Preserve any rebus in the solution
         if (! square->HasSolutionRebus())
-            square->SetSolution(decode_puz(std::string(1, *it)));
+            square->SetSolution(static_cast<char_t>(*it)); // Always A-Z
         else
             square->SetPlainSolution(*it);
         ++it;
@@ -0,0 +1,53 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "Snapshot.hpp"
+#include "Puzzle.hpp"
+#include "formats/xws/xws.hpp"
+#include "utils/filemap.hpp"
+
+namespace puz {
+
+void SaveSnapshot(const Puzzle & puz, const std::string & filename)
+{
+    SaveSnapshot(puz, filename, NULL, 0);
+}
+
+void SaveSnapshot(const Puzzle & puz, const std::string & filename,
+                  const char * puzzle, size_t length)
+{
+    buffer_writer out(4096 + length);
+    SaveXwsBuffer(puz, out, puzzle, length);
+    if (! WriteWholeFile(filename, out.data(), out.size()))
+        throw FileError(filename);
+}
+
+bool LoadSnapshot(Puzzle * puz, const std::string & filename)
+{
+    file_map file;
+    if (! file.Open(filename))
+        throw FileError(filename);
+    return LoadXwsState(puz, file.data(), file.size());
+}
+
+bool LoadSnapshotBuffer(Puzzle * puz, const char * data, size_t length)
+{
+    return LoadXwsState(puz, data, length);
+}
+
+} // namespace puz
@@ -0,0 +1,49 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_SNAPSHOT_H
+#define PUZ_SNAPSHOT_H
+
+#include <string>
+
+namespace puz {
+
+class Puzzle;
+
+// A snapshot is the solving state of a puzzle: the text and flags of each
+// square, and the timer.  Snapshots are small and quick to write, so they
+// are meant for autosaving; the puzzle's own file only needs to be
+// rewritten when the user saves.
+//
+// A snapshot can also include the puzzle's file (in any format), in which
+// case the snapshot can be loaded as a puzzle on its own (.xws).
+
+// Throws FileError if the snapshot can't be written.
+PUZ_API void SaveSnapshot(const Puzzle & puz, const std::string & filename);
+PUZ_API void SaveSnapshot(const Puzzle & puz, const std::string & filename,
+                          const char * puzzle, size_t length);
+
+// Restore a snapshot to a puzzle that is already loaded.
+// Return false if the snapshot was saved from a different puzzle.
+// Throws FileError, FileTypeError, or LoadError.
+PUZ_API bool LoadSnapshot(Puzzle * puz, const std::string & filename);
+PUZ_API bool LoadSnapshotBuffer(Puzzle * puz, const char * data, size_t length);
+
+} // namespace puz
+
+#endif // PUZ_SNAPSHOT_H
@@ -32,18 +32,21 @@ namespace puz {
 // Default constructor
 // Square is white and blank.
 Square::Square()
-    : m_col(-1),
-      m_row(-1),
+    : m_solution(SquareText::BLANK),
+      m_text(SquareText::BLANK),
+      m_asciiSolution(ToPlain(Blank)),
+      m_asciiText(ToPlain(Blank)),
       m_flag(FLAG_CLEAR),
+      m_col(-1),
+      m_row(-1),
       m_number(),
       m_red(255),
       m_green(255),
       m_blue(255),
-      m_bars()
+      m_bars(),
+      m_data(NULL),
+      m_extra(NULL)
 {
-    SetText(puzT(""));
-    SetSolution(puzT(""));
-
     // These will be filled in by the grid
     m_next.clear();
 }
@@ -54,19 +57,28 @@ Square::Square()
 // must be reset.  Linked-list information will be filled in
 // by the grid.
 Square::Square(const Square & other)
-    : m_col(other.m_col),
-      m_row(other.m_row),
-      m_asciiSolution(other.m_asciiSolution),
-      m_solution(other.m_solution),
+    : m_solution(other.m_solution),
       m_text(other.m_text),
+      m_asciiSolution(other.m_asciiSolution),
+      m_asciiText(other.m_asciiText),
       m_flag(other.m_flag),
+      m_col(other.m_col),
+      m_row(other.m_row),
       m_number(other.m_number),
       m_red(other.m_red),
       m_green(other.m_green),
-      m_blue(other.m_blue)
+      m_blue(other.m_blue),
+      m_data(other.m_data),
+      m_extra(NULL)
 {
-    m_next = SquareDirectionMap(m_next);
+    m_next.clear();
     std::memcpy(m_bars, other.m_bars, 4 * sizeof(bool));
+    CopyExtra(other);
+}
+
+Square::~Square()
+{
+    delete m_extra;
 }
 
 // Since all constructors are private, only a grid can create squares.
@@ -76,23 +88,98 @@ Square::Square(const Square & other)
 // from being copied.
 Square & Square::operator=(const Square & other)
 {
+    if (this == &other)
+        return *this;
+
+    const State state = GetState();
     m_asciiSolution = other.m_asciiSolution;
-    m_solution = other.m_solution;
-    m_text = other.m_text;
+    m_asciiText = other.m_asciiText;
+    m_solution = CopyText(other, other.m_solution);
+    m_text = CopyText(other, other.m_text);
     m_flag = other.m_flag;
 
     m_red = other.m_red;
     m_green = other.m_green;
     m_blue = other.m_blue;
+    std::memcpy(m_bars, other.m_bars, 4 * sizeof(bool));
 
     m_number = other.m_number;
 
     // Don't copy grid information
+    CopyExtra(other);
+    OnChange(state);
 
     return *this;
 }
 
 
+//------------------------------------------------------------------------------
+// Rarely used data
+//------------------------------------------------------------------------------
+
+// Returned for squares that have no extra data
+static const string_t empty_string;
+static const std::string empty_data;
+
+Square::Extra & Square::GetExtra()
+{
+    if (! m_extra)
+        m_extra = new Extra;
+    return *m_extra;
+}
+
+// Copy marks and images.  Partner squares are grid information, and are
+// filled in by the grid.
+void Square::CopyExtra(const Square & other)
+{
+    std::vector<Square*> partner;
+    if (m_extra)
+        partner.swap(m_extra->partner);
+    delete m_extra;
+    m_extra = NULL;
+    if (other.m_extra)
+    {
+        m_extra = new Extra(*other.m_extra);
+        m_extra->partner.swap(partner);
+    }
+    else if (! partner.empty())
+    {
+        GetExtra().partner.swap(partner);
+    }
+}
+
+const string_t & Square::GetMark(CornerMark mark) const
+{
+    return m_extra ? m_extra->mark[mark] : empty_string;
+}
+
+void Square::SetMark(CornerMark mark, const string_t & text)
+{
+    if (m_extra || ! text.empty())
+        GetExtra().mark[mark] = text;
+}
+
+const std::string & Square::GetImageFormat() const
+{
+    return m_extra ? m_extra->imageformat : empty_data;
+}
+
+const std::string & Square::GetImageData() const
+{
+    return m_extra ? m_extra->imagedata : empty_data;
+}
+
+void Square::SetImage(const std::string & format, const std::string & data)
+{
+    if (m_extra || ! data.empty())
+    {
+        Extra & extra = GetExtra();
+        extra.imageformat = format;
+        extra.imagedata = data;
+    }
+}
+
+
 // Character tables and the definition of Square::Blank and Square::Black
 #include "char_tables.hpp"
 
@@ -420,29 +507,120 @@ void Square::RemoveColor()
 // Square text and solution
 //------------------------------------------------------------------------------
 
+// Rebus entries are stored in the grid; everything else is stored inline.
+string_t Square::GetLongString(SquareText text) const
+{
+    if (text.IsSymbol())
+    {
+        string_t ret = puzT("[ ]");
+        ret[1] = text.GetChar();
+        return ret;
+    }
+    assert(m_data && text.IsRebus());
+    return m_data->rebus.at(text.GetIndex());
+}
+
+// str is a valid (non-empty) square text
+SquareText Square::MakeText(const string_t & str)
+{
+    assert(! str.empty());
+    if (str.length() == 1)
+        return SquareText::Char(str[0]);
+    if (IsSymbol(str))
+        return SquareText::Symbol(str[1]);
+    assert(m_data);
+    return SquareText::Rebus(m_data->AddRebus(str));
+}
+
+// Rebus entries from another grid have to be added to this grid.
+SquareText Square::CopyText(const Square & other, SquareText text)
+{
+    if (! text.IsRebus() || other.m_data == m_data)
+        return text;
+    return MakeText(other.GetLongString(text));
+}
+
+void Square::SetText(char_t ch, bool propagate)
+{
+    const State state = GetState();
+    if (ch == Black[0])
+        m_text = SquareText(SquareText::BLACK);
+    else
+    {
+        ch = ToGrid(ch);
+        m_text = ch == 0 ? SquareText(SquareText::BLANK) : SquareText::Char(ch);
+    }
+    m_asciiText = ToPlain(m_text.GetChar());
+    if (m_asciiText == 0)
+        m_asciiText = ToPlain(Blank);
+    OnChange(state);
+    if (propagate && m_extra && !m_extra->partner.empty()) {
+        std::vector<Square*> & partner = m_extra->partner;
+        for (std::vector<Square*>::iterator it = partner.begin(); it != partner.end(); ++it)
+            (*it)->SetText(ch, false);
+    }
+}
+
 void Square::SetText(const string_t & text, bool propagate)
 {
+    if (text.length() == 1)
+    {
+        SetText(text[0], propagate);
+        return;
+    }
+    const State state = GetState();
     if (text.empty())
-        m_text = Blank;
-    else if (text == Black || IsSymbol(text))
-        m_text = text;
+        m_text = SquareText(SquareText::BLANK);
+    else if (IsSymbol(text))
+        m_text = MakeText(text);
     else {
-        m_text = ToGrid(text);
-        if (m_text.empty())
-            m_text = Blank;
+        string_t grid = ToGrid(text);
+        m_text = grid.empty() ? SquareText(SquareText::BLANK) : MakeText(grid);
     }
-    if (propagate && !m_partner.empty()) {
-        for (std::vector<Square*>::iterator it = m_partner.begin(); it != m_partner.end(); ++it)
+    m_asciiText = m_text.IsChar() ? ToPlain(m_text.GetChar())
+                                  : ToPlain(GetLongString(m_text));
+    if (m_asciiText == 0)
+        m_asciiText = ToPlain(Blank);
+    OnChange(state);
+    if (propagate && m_extra && !m_extra->partner.empty()) {
+        std::vector<Square*> & partner = m_extra->partner;
+        for (std::vector<Square*>::iterator it = partner.begin(); it != partner.end(); ++it)
             (*it)->SetText(text, false);
     }
 }
 
+void Square::SetSolution(char_t ch)
+{
+    if (ch == Black[0])
+        SetText(ch);
+    const State state = GetState();
+    if (ch == Black[0])
+    {
+        m_solution = SquareText(SquareText::BLACK);
+    }
+    else
+    {
+        char_t grid = ToGrid(ch);
+        m_solution = grid == 0 ? SquareText(SquareText::BLANK)
+                               : SquareText::Char(grid);
+    }
+    m_asciiSolution = ToPlain(ch);
+    if (m_asciiSolution == 0)
+        m_asciiSolution = ToPlain(Blank);
+    OnChange(state);
+}
+
 void Square::SetSolution(const string_t & solution)
 {
-    if (solution == Black)
-        SetText(Black);
+    if (solution.length() == 1)
+    {
+        SetSolution(solution[0]);
+        return;
+    }
     SetSolutionRebus(solution);
+    const State state = GetState();
     m_asciiSolution = ToPlain(solution);
+    OnChange(state);
 }
 
 void Square::SetSolution(const string_t & solution, char plain)
@@ -460,60 +638,52 @@ void Square::SetPlainSolution(char solution)
 #endif
     // This could break word start and end
 
+    const State state = GetState();
     m_asciiSolution = solution;
+    OnChange(state);
 }
 
 void Square::SetSolutionRebus(const string_t & rebus)
 {
+    const State state = GetState();
     if (rebus.empty())
-        m_solution = Blank;
+        m_solution = SquareText(SquareText::BLANK);
     else if (rebus == Blank ||
              rebus == Black ||
              IsSymbol(rebus))
-        m_solution = rebus;
+        m_solution = MakeText(rebus);
     else {
-        m_solution = ToGrid(rebus);
-        if (m_solution.empty())
-            m_solution = Blank;
+        string_t grid = ToGrid(rebus);
+        m_solution = grid.empty() ? SquareText(SquareText::BLANK)
+                                  : MakeText(grid);
     }
+    OnChange(state);
 }
 
 void Square::SetSolutionSymbol(unsigned char symbol)
 {
-    m_solution = puzT("[ ]");
-    m_solution.at(1) = static_cast<char_t>(symbol);
+    const State state = GetState();
+    m_solution = SquareText::Symbol(static_cast<char_t>(symbol));
+    OnChange(state);
 }
 
 bool Square::HasTextRebus() const
 {
-    const size_t len = m_text.length();
-    return len > 1 || (len > 0 && m_text.at(0) != GetPlainText());
+    return ! m_text.IsChar() || m_text.GetChar() != GetPlainText();
 }
 
 
 bool Square::HasSolutionRebus() const
 {
-    const size_t len = m_solution.length();
-    return len > 1 || (m_solution.at(0) != GetPlainSolution());
-}
-
-
-bool Square::HasTextSymbol() const
-{
-    return IsSymbol(m_text);
+    return ! m_solution.IsChar() || m_solution.GetChar() != GetPlainSolution();
 }
 
 
-bool Square::HasSolutionSymbol() const
-{
-    return IsSymbol(m_solution);
-}
-
 char_t Square::GetTextSymbol() const
 {
     if (! HasTextSymbol())
         throw NoSymbol();
-    return m_text.at(1);
+    return m_text.GetChar();
 }
 
 
@@ -521,7 +691,7 @@ char_t Square::GetSolutionSymbol() const
 {
     if (! HasSolutionSymbol())
         throw NoSymbol();
-    return m_solution.at(1);
+    return m_solution.GetChar();
 }
 
 
@@ -532,12 +702,100 @@ bool Square::Check(bool checkBlank, bool strictRebus)  const
     if (IsBlank() && ! IsSolutionBlank())
         return ! checkBlank;
 
+    // Rebus entries are unique, so this is an integer compare
     if (strictRebus || (HasTextRebus() && HasSolutionRebus()))
         return m_solution == m_text;
     else
         return GetPlainText() == GetPlainSolution();
 }
 
+//------------------------------------------------------------------------------
+// Flags and solve statistics
+//------------------------------------------------------------------------------
+
+void Square::SetFlag(unsigned int flag, bool propagate)
+{
+    const State state = GetState();
+    m_flag = flag;
+    OnChange(state);
+    if (propagate && m_extra && !m_extra->partner.empty()) {
+        std::vector<Square*> & partner = m_extra->partner;
+        for (std::vector<Square*>::iterator it = partner.begin(); it != partner.end(); ++it)
+            (*it)->SetFlag(flag, false);
+    }
+}
+
+unsigned int Square::GetStatus() const
+{
+    unsigned int status = 0;
+    if (IsBlack() && (IsSolutionBlack() || IsSolutionBlank()))
+    {
+        status |= SolveStats::BLACK;
+    }
+    else if (IsBlack())
+    {
+        // A diagramless square filled in black where the solution has a
+        // letter: Check() says this is wrong.
+        status |= SolveStats::WHITE
+                | SolveStats::INCORRECT
+                | SolveStats::STRICT_INCORRECT;
+    }
+    else if (! IsMissing())
+    {
+        status |= SolveStats::WHITE;
+        if (IsBlank())
+        {
+            status |= SolveStats::BLANK;
+            if (IsSolutionBlank())
+                status |= SolveStats::BLANK_CORRECT;
+        }
+        else
+        {
+            status |= Check() ? SolveStats::CORRECT : SolveStats::INCORRECT;
+            if (! Check(false, true))
+                status |= SolveStats::STRICT_INCORRECT;
+        }
+    }
+    if (HasFlag(FLAG_REVEALED))
+        status |= SolveStats::REVEALED;
+    if (HasFlag(FLAG_X | FLAG_BLACK | FLAG_CORRECT))
+        status |= SolveStats::CHECKED;
+    return status;
+}
+
+Square::State Square::GetState() const
+{
+    State state;
+    state.text = m_text;
+    state.solution = m_solution;
+    state.flag = m_flag;
+    state.status = GetStatus();
+    return state;
+}
+
+void Square::OnChange(const State & old)
+{
+    if (! m_data)
+        return;
+    m_data->UpdateSquare(*this);
+    const unsigned int status = GetStatus();
+    if (status != old.status)
+    {
+        m_data->stats.Add(old.status, -1);
+        m_data->stats.Add(status);
+    }
+    if (! m_data->trackChanges && ! m_data->journalEnabled)
+        return;
+    if (old.text != m_text)
+        m_data->Record(this, GridChange::TEXT,
+                       old.text.GetValue(), m_text.GetValue());
+    if (old.solution != m_solution)
+        m_data->Record(this, GridChange::SOLUTION,
+                       old.solution.GetValue(), m_solution.GetValue());
+    if (old.flag != m_flag)
+        m_data->Record(this, GridChange::FLAG, old.flag, m_flag);
+}
+
 bool Square::IsSymbol(const string_t & str)
 {
     return str.length() == 3
@@ -551,4 +809,15 @@ bool Square::IsBetween(const Square * start, const Square * end) const
         && m_row >= start->m_row && m_row <= end->m_row;
 }
 
+
+unsigned short GetAngle(const Square & first, const Square & second)
+{
+    static const double PI = std::atan(1.0)*4;
+    double radians = std::atan2(
+        double(first.GetRow() - second.GetRow()), // y1 - y2
+        double(second.GetCol() - first.GetCol())  // x2 - x1
+    );
+    return (unsigned short)((radians * 180. / PI) + 360) % 360;
+}
+
 } // namespace puz
@@ -157,14 +157,57 @@ enum CheckTest
 };
 
 
+// The text or solution of a square.
+// Nearly every square holds a single character, so characters and symbols
+// ("[x]") are stored inline.  Longer (rebus) entries are stored in the
+// grid's rebus table, and referred to by index.  Rebus entries are unique
+// within a grid, so two SquareTexts from the same grid are equal only if
+// they hold the same string.
+class SquareText
+{
+public:
+    static const unsigned int BLANK = ' ';
+    static const unsigned int BLACK = '.';
+
+    static const unsigned int SYMBOL = 0x40000000; // Value is a symbol's character
+    static const unsigned int REBUS  = 0x80000000; // Value is an index into the rebus table
+    static const unsigned int VALUE_MASK = 0x3fffffff;
+
+    explicit SquareText(unsigned int value = BLANK) : m_value(value) {}
+
+    static SquareText Char(char_t ch)
+        { return SquareText(static_cast<unsigned int>(ch) & VALUE_MASK); }
+    static SquareText Symbol(char_t ch)
+        { return SquareText(Char(ch).m_value | SYMBOL); }
+    static SquareText Rebus(unsigned int index)
+        { return SquareText(index | REBUS); }
+
+    bool IsChar()   const { return (m_value & (SYMBOL | REBUS)) == 0; }
+    bool IsSymbol() const { return (m_value & SYMBOL) != 0; }
+    bool IsRebus()  const { return (m_value & REBUS) != 0; }
+
+    char_t       GetChar()  const { return static_cast<char_t>(m_value & VALUE_MASK); }
+    unsigned int GetIndex() const { return m_value & VALUE_MASK; }
+    unsigned int GetValue() const { return m_value; }
+
+    bool operator==(const SquareText & other) const { return m_value == other.m_value; }
+    bool operator!=(const SquareText & other) const { return m_value != other.m_value; }
+
+private:
+    unsigned int m_value;
+};
+
+
 // To be used as friends
 class PUZ_API Grid;
+class PUZ_API GridData;
 class GridSquare;
 class PUZ_API GridScrambler;
 
 class PUZ_API Square
 {
     friend class Grid;
+    friend class GridData;
     friend class GridSquare;
     friend class GridScrambler;
 
@@ -174,6 +217,7 @@ private:
     Square(const Square & other);
 
 public:
+    ~Square();
     Square & operator=(const Square & other);
 
     // Location information
@@ -190,22 +234,25 @@ public:
     // consistency, so if your puzzle is diagramless, you will have to
     // explicitly call SetText("") on black squares to make them empty.
     bool IsWhite()         const { return !IsBlack() && !IsMissing(); }
-    bool IsBlack()         const { return m_text == Black || IsAnnotation(); }
-    bool IsBlank()         const { return m_text == Blank; }
+    bool IsBlack()         const { return m_text == SquareText(SquareText::BLACK) || IsAnnotation(); }
+    bool IsBlank()         const { return m_text == SquareText(SquareText::BLANK); }
     // Corresponding functions for the solution
     bool IsSolutionWhite() const { return !IsSolutionBlack() && !IsMissing(); }
-    bool IsSolutionBlack() const { return m_solution == Black || IsAnnotation(); }
-    bool IsSolutionBlank() const { return m_solution == Blank; }
+    bool IsSolutionBlack() const { return m_solution == SquareText(SquareText::BLACK) || IsAnnotation(); }
+    bool IsSolutionBlank() const { return m_solution == SquareText(SquareText::BLANK); }
 
     // Text
     //-----
 
     // Text and Solution are guaranteed not to be empty.
-    const string_t & GetText()     const { return m_text; }
-    const string_t & GetSolution() const { return m_solution; }
+    string_t GetText()     const { return GetString(m_text); }
+    string_t GetSolution() const { return GetString(m_solution); }
 
     void SetText    (const string_t & text, bool propagate = true);
     void SetSolution(const string_t & solution);
+    // Single character versions
+    void SetText    (char_t ch, bool propagate = true);
+    void SetSolution(char_t ch);
     void SetSolution(const string_t & solution, char plain);
     void SetPlainSolution(char plain); // Leave solution rebus unchanged
     void SetSolutionRebus(const string_t & rebus); // Leave plain solution unchanged
@@ -215,13 +262,13 @@ public:
 
     bool Check(bool checkBlank = false, bool strictRebus = false) const;
 
-    char GetPlainText()     const { return ToPlain(m_text); }
+    char GetPlainText()     const { return m_asciiText; }
     char GetPlainSolution() const { return m_asciiSolution; }
 
     bool HasTextRebus()      const;
     bool HasSolutionRebus()  const;
-    bool HasTextSymbol()     const;
-    bool HasSolutionSymbol() const;
+    bool HasTextSymbol()     const { return m_text.IsSymbol(); }
+    bool HasSolutionSymbol() const { return m_solution.IsSymbol(); }
 
     char_t GetTextSymbol()      const;
     char_t GetSolutionSymbol()  const;
@@ -247,7 +294,11 @@ public:
     void SetNumber(int number)              { m_number = ToString(number); }
 
     // Corner marks
-    string_t m_mark[4];
+    //-------------
+    bool HasMark(CornerMark mark) const
+        { return m_extra && ! m_extra->mark[mark].empty(); }
+    const string_t & GetMark(CornerMark mark) const;
+    void SetMark(CornerMark mark, const string_t & text);
 
     // Bars
     bool m_bars[4];
@@ -263,13 +314,7 @@ public:
 
     // Flags
     //------
-    void         SetFlag (unsigned int flag, bool propagate = true) {
-        m_flag = flag;
-        if (propagate && !m_partner.empty()) {
-            for (std::vector<Square*>::iterator it = m_partner.begin(); it != m_partner.end(); ++it)
-                (*it)->SetFlag(flag, false);
-        }
-    }
+    void         SetFlag (unsigned int flag, bool propagate = true);
     unsigned int GetFlag() const             { return m_flag; }
     bool         HasFlag(unsigned int flag) const
         { return (m_flag & flag) != 0; }
@@ -310,9 +355,10 @@ public:
     unsigned char m_blue;
 
     // Image
-    bool HasImage() const { return ! m_imagedata.empty(); }
-    std::string m_imageformat;
-    std::string m_imagedata;
+    bool HasImage() const { return m_extra && ! m_extra->imagedata.empty(); }
+    const std::string & GetImageFormat() const;
+    const std::string & GetImageData() const;
+    void SetImage(const std::string & format, const std::string & data);
 
     // Linked-list
     //------------
@@ -371,25 +417,77 @@ public:
 
     bool IsBetween(const Square * start, const Square * end) const;
 
-    std::vector<Square*> GetPartnerSquares() const { return m_partner; }
+    std::vector<Square*> GetPartnerSquares() const
+    {
+        return m_extra ? m_extra->partner : std::vector<Square*>();
+    }
 protected:
-    // Location information
-    int m_col;
-    int m_row;
+    // Squares are stored contiguously in the grid, so the members that are
+    // used while iterating or checking the grid come first, and data that
+    // only a few squares ever have lives in a separately allocated block.
 
     // Text
-    string_t m_solution;
-    string_t m_text;
+    SquareText m_solution;
+    SquareText m_text;
     char m_asciiSolution;
+    char m_asciiText;
+
+    // Flag (GEXT)
+    unsigned int m_flag;
+
+    // Location information
+    int m_col;
+    int m_row;
 
     // Clue
     string_t m_number;
 
-    // Flag (GEXT)
-    unsigned int m_flag;
+    // The grid data that holds this square's rebus entries, the grid's
+    // solve statistics, and change tracking
+    GridData * m_data;
 
-    // Partner squares (for Acrostics and Coded puzzles)
-    std::vector<Square*> m_partner;
+    // Return this square's SolveStats status
+    unsigned int GetStatus() const;
+
+    // What a square looked like before a change
+    struct State
+    {
+        SquareText text;
+        SquareText solution;
+        unsigned int flag;
+        unsigned int status;
+    };
+    State GetState() const;
+    // Update the grid's solve statistics and change tracking after this
+    // square changes
+    void OnChange(const State & old);
+
+    string_t GetString(SquareText text) const
+    {
+        if (text.IsChar())
+            return string_t(1, text.GetChar());
+        return GetLongString(text);
+    }
+    string_t GetLongString(SquareText text) const;
+    SquareText MakeText(const string_t & str);
+    SquareText CopyText(const Square & other, SquareText text);
+
+    // Rarely used data
+    //-----------------
+    struct Extra
+    {
+        // Corner marks
+        string_t mark[4];
+        // Image
+        std::string imageformat;
+        std::string imagedata;
+        // Partner squares (for Acrostics and Coded puzzles)
+        std::vector<Square*> partner;
+    };
+    Extra * m_extra; // NULL until needed
+
+    Extra & GetExtra();
+    void CopyExtra(const Square & other);
 
     // Linked-list
     //------------
@@ -414,16 +512,24 @@ protected:
 };
 
 // Return the direction (angle) between two squares
-static const double PI = std::atan(1.0)*4;
+// Squares that are not in line use atan2.
+PUZ_API unsigned short GetAngle(const Square & first, const Square & second);
+
 inline unsigned short GetDirection(const Square & first, const Square & second)
 {
     // Note that the y coords are reversed, because our grid coordinate system
     // is also reversed.
-    double radians = std::atan2(
-        double(first.GetRow() - second.GetRow()), // y1 - y2
-        double(second.GetCol() - first.GetCol())  // x2 - x1
-    );
-    return (unsigned short)((radians * 180. / PI) + 360) % 360;
+    const int x = second.GetCol() - first.GetCol(); // x2 - x1
+    const int y = first.GetRow() - second.GetRow(); // y1 - y2
+    if (x != 0 && y != 0 && x != y && x != -y)
+        return GetAngle(first, second);
+    // Indexed by [sign(y) + 1][sign(x) + 1]
+    static const unsigned short directions[3][3] = {
+        { DIAGONAL_SW, DOWN,   DIAGONAL_SE },
+        { LEFT,        ACROSS, RIGHT       },
+        { DIAGONAL_NW, UP,     DIAGONAL_NE },
+    };
+    return directions[(y > 0) - (y < 0) + 1][(x > 0) - (x < 0) + 1];
 }
 
 } // namespace puz
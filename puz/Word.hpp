@@ -18,42 +18,39 @@
 #ifndef PUZ_WORD_H
 #define PUZ_WORD_H
 
-#include <memory>
+#include <vector>
+#include <cstddef>
 #include "puzstring.hpp"
 #include "Square.hpp"
 #include "iterator.hpp"
 
 namespace puz {
 
-class WordImpl;
-
 // Default functor for Find functions
 static bool FIND_ANY_SQUARE(const Square * square) { return true; }
 
 // A word
-// This is essentially a linked-list with an efficient implementation for
-// words that have squares in line.
+// Most words are a straight line of squares, which are stored as the first
+// and last squares and the distance between squares in the grid's storage.
+// Words that are not straight lines are stored as a list of squares.
+// Either way a Word is a value type: copying a straight Word or iterating
+// over it never allocates.
 class PUZ_API Word
 {
 public:
     // Constructors
     Word();
     Word(Square * start, Square * end);
-    Word(const Word & other);
-    ~Word();
-
-    // Operators
-    Word & operator=(const Word & other);
 
     bool Contains(const Square * square) const;
     // Return the index of square.  -1 means not found
     int FindSquare(const Square * square) const;
     short GetDirection() const;
-    bool empty() const;
+    bool empty() const { return m_front == NULL; }
 
     // Element access
-    Square * front() const;
-    Square * back() const;
+    Square * front() const { return m_front; }
+    Square * back() const { return m_back; }
 
     void push_back(Square * square);
     void push_front(Square * square);
@@ -61,10 +58,23 @@ public:
     void pop_front();
 
     // Iterators
-    square_iterator begin() const;
-    square_iterator end() const;
-    square_reverse_iterator rbegin() const;
-    square_reverse_iterator rend() const;
+    square_iterator begin() const
+    {
+        if (! IsStraight())
+            return square_iterator(&m_list[1]);
+        return square_iterator(m_front, m_front, m_back, m_stride);
+    }
+
+    square_iterator end() const { return square_iterator(); }
+
+    square_reverse_iterator rbegin() const
+    {
+        if (! IsStraight())
+            return square_reverse_iterator(&m_list[m_list.size() - 2]);
+        return square_reverse_iterator(m_back, m_front, m_back, m_stride);
+    }
+
+    square_reverse_iterator rend() const { return square_reverse_iterator(); }
 
     typedef square_iterator iterator;
     typedef square_reverse_iterator reverse_iterator;
@@ -153,7 +163,14 @@ public:
     }
 
 protected:
-    std::auto_ptr<WordImpl> m_impl;
+    Square * m_front;
+    Square * m_back;
+    ptrdiff_t m_stride;         // Straight words: m_back - m_front per square
+    GridDirection m_direction;  // Straight words: the direction
+    std::vector<Square *> m_list; // Other words: squares with a NULL at each end
+
+    bool IsStraight() const { return m_list.empty(); }
+    void MakeList();
 };
 
 } // namespace puz
@@ -0,0 +1,190 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "WordIndex.hpp"
+#include "Grid.hpp"
+#include "Clue.hpp"
+#include "Word.hpp"
+#include "iterator.hpp"
+
+namespace puz {
+
+bool
+WordIndex::IsValid(const Grid & grid, const Clues & clues) const
+{
+    if (! m_isValid
+        || grid.First() != m_first
+        || grid.GetWidth() != m_width
+        || grid.GetHeight() != m_height
+        || clues.size() != m_versions.size())
+    {
+        return false;
+    }
+    std::vector<unsigned long>::const_iterator version = m_versions.begin();
+    Clues::const_iterator it;
+    for (it = clues.begin(); it != clues.end(); ++it, ++version)
+        if (it->second.GetVersion() != *version)
+            return false;
+    return true;
+}
+
+int
+WordIndex::GetIndex(const Grid & grid, const Square * square) const
+{
+    if (! square)
+        return -1;
+    const int col = square->GetCol();
+    const int row = square->GetRow();
+    if (grid.AtNULL(col, row) != square)
+        return -1;
+    return row * m_width + col;
+}
+
+
+void
+WordIndex::Build(const Grid & grid, const Clues & clues)
+{
+    m_first = grid.First();
+    m_width = grid.GetWidth();
+    m_height = grid.GetHeight();
+    m_versions.clear();
+
+    // Collect (square index, entry) pairs in clue order
+    std::vector<std::pair<int, Entry> > found;
+    Clues::const_iterator list_it;
+    unsigned short list = 0;
+    for (list_it = clues.begin(); list_it != clues.end(); ++list_it, ++list)
+    {
+        const ClueList & cluelist = list_it->second;
+        m_versions.push_back(cluelist.GetVersion());
+        ClueList::const_iterator clue;
+        for (clue = cluelist.begin(); clue != cluelist.end(); ++clue)
+        {
+            const Word & word = clue->GetWord();
+            if (word.empty())
+                continue;
+            Entry entry;
+            entry.clue = &*clue;
+            entry.position = 0;
+            entry.direction = word.GetDirection();
+            entry.list = list;
+            const size_t wordStart = found.size();
+            square_iterator it;
+            for (it = word.begin(); it != word.end(); ++it, ++entry.position)
+            {
+                int index = GetIndex(grid, &*it);
+                if (index < 0)
+                    continue;
+                // A square's position is the first time it is in the word
+                bool isDuplicate = false;
+                for (size_t i = wordStart; i < found.size(); ++i)
+                    if (found[i].first == index)
+                        isDuplicate = true;
+                if (! isDuplicate)
+                    found.push_back(std::make_pair(index, entry));
+            }
+        }
+    }
+
+    // Sort by square, keeping clue order (counting sort)
+    m_start.assign(m_width * m_height + 1, 0);
+    std::vector<std::pair<int, Entry> >::const_iterator it;
+    for (it = found.begin(); it != found.end(); ++it)
+        ++m_start[it->first + 1];
+    for (size_t i = 1; i < m_start.size(); ++i)
+        m_start[i] += m_start[i-1];
+    m_entries.resize(found.size());
+    std::vector<size_t> next(m_start.begin(), m_start.end() - 1);
+    for (it = found.begin(); it != found.end(); ++it)
+        m_entries[next[it->first]++] = it->second;
+
+    m_isValid = true;
+}
+
+
+// Prefer words that start on square.  Otherwise use words that contain
+// square.  Prefer words where square is closest to the start.
+// Prefer words in exactly the specified direction.  If we can't find any of
+// those, return a word in the inverse direction.
+const Word *
+WordIndex::FindWord(const Grid & grid, const Square * square,
+                    short direction) const
+{
+    const int index = GetIndex(grid, square);
+    if (index < 0)
+        return NULL;
+
+    const Word * bestWord = NULL;
+    int distance = -1;
+    short inverseDirection = InvertDirection(direction);
+    const Word * inverseWord = NULL;
+
+    const size_t end = m_start[index + 1];
+    for (size_t i = m_start[index]; i < end; ++i)
+    {
+        const Entry & entry = m_entries[i];
+        const Word * word = &entry.clue->GetWord();
+        if (entry.direction == direction)
+        {
+            if (entry.position == 0)
+                return word;
+            else if (distance == -1 || entry.position < distance)
+            {
+                bestWord = word;
+                distance = entry.position;
+            }
+        }
+        else if (entry.direction == inverseDirection)
+            inverseWord = word;
+    }
+    if (bestWord)
+        return bestWord;
+    return inverseWord;
+}
+
+
+// Use the first clue list that has a clue containing square.
+// Prefer clues that start with square, otherwise return clues that
+// contain square.  Prefer clues that have square closest to the front.
+const Clue *
+WordIndex::FindClue(const Grid & grid, const Square * square) const
+{
+    const int index = GetIndex(grid, square);
+    if (index < 0)
+        return NULL;
+
+    const Clue * bestClue = NULL;
+    int distance = -1;
+    const size_t end = m_start[index + 1];
+    for (size_t i = m_start[index]; i < end; ++i)
+    {
+        const Entry & entry = m_entries[i];
+        if (bestClue && entry.list != m_entries[i-1].list)
+            break;
+        if (entry.position == 0)
+            return entry.clue;
+        else if (distance == -1 || entry.position < distance)
+        {
+            bestClue = entry.clue;
+            distance = entry.position;
+        }
+    }
+    return bestClue;
+}
+
+} // namespace puz
@@ -0,0 +1,84 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_WORD_INDEX_H
+#define PUZ_WORD_INDEX_H
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace puz {
+
+class Grid;
+class Square;
+class Word;
+class Clue;
+class Clues;
+
+// A lookup table from each square in the grid to the words (and clues) that
+// contain it, used by Puzzle::FindWord and Puzzle::FindClue.
+//
+// The index remembers the layout of the grid and the version of each clue
+// list it was built from (see ClueList::GetVersion).  IsValid() returns
+// false if any of these have changed.  Changes that bypass the Clue setters
+// are not detected: call Invalidate() afterwards.
+class WordIndex
+{
+public:
+    WordIndex() : m_isValid(false) {}
+
+    void Build(const Grid & grid, const Clues & clues);
+    void Invalidate() { m_isValid = false; }
+    bool IsValid(const Grid & grid, const Clues & clues) const;
+
+    // These give the same results as searching every word in every clue
+    // list (see Puzzle::FindWord and Puzzle::FindClue).
+    const Word * FindWord(const Grid & grid, const Square * square,
+                          short direction) const;
+    const Clue * FindClue(const Grid & grid, const Square * square) const;
+
+private:
+    struct Entry
+    {
+        const Clue * clue;
+        int position;         // Index of the square in the word
+        short direction;      // Word direction
+        unsigned short list;  // Index of the clue list
+    };
+
+    // Entries for the square at index i (row * width + col) are
+    // m_entries[m_start[i]] through m_entries[m_start[i+1] - 1], in the
+    // same order as the clues.
+    std::vector<std::size_t> m_start;
+    std::vector<Entry> m_entries;
+
+    // What the index was built from
+    std::vector<unsigned long> m_versions; // One per clue list
+    const Square * m_first;
+    std::size_t m_width;
+    std::size_t m_height;
+    bool m_isValid;
+
+    // Return the index of a square in the grid or -1 if it isn't in the grid
+    int GetIndex(const Grid & grid, const Square * square) const;
+};
+
+} // namespace puz
+
+#endif // PUZ_WORD_INDEX_H
@@ -48,7 +48,7 @@ const char_t * Square::Blank   = puzT(" ");
 const char_t * Square::Black   = puzT(".");
 
 // Across Lite representation
-static unsigned char ascii [] = {
+static const unsigned char ascii [] = {
 /*         0     1     2     3     4     5     6     7     8     9     a     b     c     d     e     f */
 /* 0 */    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
 /* 1 */    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
@@ -20,22 +20,12 @@
 
 #include "Puzzle.hpp"
 #include <string>
-#include "parse/json.hpp"
 
 namespace puz {
-    namespace json {
-    class Value;
-}
-
-class ipuzData : public Puzzle::FormatData
-{
-public:
-    ipuzData(json::Value * root = NULL) : root(root) {}
-    ~ipuzData() { delete root; }
-    json::Value * root;
-};
 
 void LoadIpuz(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadIpuzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeIpuz(const char * data, size_t length);
 void LoadIpuzString(Puzzle * puz, const std::string & data);
 
 } // namespace puz
@@ -17,50 +17,246 @@
 
 #include "ipuz.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <memory>
 #include "Puzzle.hpp"
 #include "puzstring.hpp"
 #include "parse/json.hpp"
+#include "utils/filemap.hpp"
 
 namespace puz {
 
-class ipuzParser : public json::Parser
+// Loads an ipuz document as it is parsed.
+//
+// Values are read straight from the parser events, using a stack of
+// states to keep track of where we are in the document.  Since ipuz keys
+// can come in any order, some parts of the document can't be used until
+// the end: styles are kept as json::Values, and grid cells and clue words
+// are kept as plain strings and coordinates until "dimensions", "block",
+// and "empty" are known.  Everything else is skipped.
+class ipuzHandler : public json::Handler
 {
 public:
-    virtual bool DoLoadPuzzle(Puzzle * puz, json::Value * root);
+    ipuzHandler(Puzzle * puz)
+        : m_puz(puz),
+          m_index(0),
+          m_row(0),
+          m_col(0),
+          m_skipDepth(0),
+          m_bufferTarget(NULL),
+          m_hasKind(false),
+          m_hasDimensions(false),
+          m_width(-1),
+          m_height(-1),
+          m_block(puzT("#")),
+          m_empty(puzT("0")),
+          m_styles(NULL),
+          m_grid(NULL),
+          m_hasClues(false),
+          m_clueList(NULL),
+          m_hasClueText(false),
+          m_hasClueCells(false)
+    {}
+
+    virtual void OnNull();
+    virtual void OnBool(bool val);
+    virtual void OnNumber(const char * str, size_t len);
+    virtual void OnString(const char * str, size_t len);
+    virtual void OnMapStart() { OnStart(true); }
+    virtual void OnMapKey(const char * str, size_t len);
+    virtual void OnMapEnd() { OnEnd(true); }
+    virtual void OnArrayStart() { OnStart(false); }
+    virtual void OnArrayEnd() { OnEnd(false); }
+
+    // Set up the puzzle once the whole document has been read
+    void Finish();
+
+private:
+    enum State
+    {
+        DOC,        // The root object
+        KIND,       // "kind": [ "http://ipuz.org/crossword#1", ... ]
+        DIMENSIONS, // "dimensions": { "width": 15, "height": 15 }
+        GRID,       // "puzzle", "solution", or "saved": [ [...], ... ]
+        GRID_ROW,   // [ cell, ... ]
+        GRID_CELL,  // { "cell": ..., "style": ..., "value": ... }
+        CLUES,      // "clues": { "Across": [...], ... }
+        CLUE_LIST,  // [ clue, ... ]
+        CLUE_ARRAY, // [ number, text ]
+        CLUE_MAP,   // { "number": ..., "clue": ..., "cells": [...] }
+        CLUE_CELLS, // [ [x, y], ... ]
+        CLUE_CELL   // [x, y]
+    };
+
+    // A simple value
+    struct Scalar
+    {
+        Scalar(json::json_t type_, const char * str_ = "", size_t len_ = 0)
+            : type(type_), str(str_), len(len_)
+        {}
+
+        bool IsNull() const { return type == json::j_null; }
+        bool IsText() const
+            { return type == json::j_string || type == json::j_number; }
+
+        json::json_t type;
+        const char * str;
+        size_t len;
+    };
 
+    // A grid cell that is not null
+    struct GridCell
+    {
+        GridCell(size_t col_, size_t row_)
+            : col(col_), row(row_), isMap(false), hasValue(false), style(NULL)
+        {}
+
+        size_t col;
+        size_t row;
+        bool isMap;
+        bool hasValue;       // false if value is the "empty" string
+        string_t value;      // The cell, or its "cell" (puzzle) or "value" key
+        string_t text;       // The "value" key of a puzzle cell
+        json::Value * style; // Owned by m_document
+    };
+
+    struct GridData
+    {
+        GridData() : present(false) {}
+        bool present;
+        std::vector<GridCell> cells;
+    };
+
+    // Clue words are a list of 0-based coordinates until the grid exists
+    typedef std::vector<std::pair<int, int> > coords_t;
+    struct ClueListData
+    {
+        ClueList clues;
+        std::vector<std::pair<size_t, coords_t> > words; // Clue index, cells
+    };
+
+    void OnScalar(const Scalar & val);
+    void OnStart(bool isMap);
+    void OnEnd(bool isMap);
+
+    // Skip the value that is starting
+    void Skip() { m_skipDepth = 1; }
+    // Keep the value that is starting as a json::Value in *target
+    void Buffer(json::Value ** target);
+    template <typename T> bool ForwardToBuffer(T event);
+
+    static string_t GetString(const Scalar & val);
+    static int GetInt(const Scalar & val);
+    bool KeyIs(const char * key) const { return m_key == key; }
+    void AddGridCell(const Scalar & val);
+    void AddClue(const string_t & number, const string_t & text);
+    void CheckKind(bool setType);
+    void ApplyGrid(const GridData & grid, bool isPuzzle, bool isSaved);
     void SetStyle(Square & square, json::Value * style_value);
+
+    Puzzle * m_puz;
+    std::vector<State> m_stack;
+    std::string m_key;  // The last key in the current map
+    size_t m_index;     // Index in the current CLUE_ARRAY or CLUE_CELL
+    size_t m_row;
+    size_t m_col;
+    size_t m_skipDepth; // Depth of a value that is being skipped
+
+    // Buffered values
+    json::Document m_document;
+    std::unique_ptr<json::TreeBuilder> m_builder;
+    json::Value ** m_bufferTarget;
+
+    // Document values
+    std::vector<string_t> m_kinds;
+    bool m_hasKind;
+    string_t m_title;
+    string_t m_author;
+    string_t m_copyright;
+    string_t m_notes;
+    string_t m_intro;
+    bool m_hasDimensions;
+    int m_width;
+    int m_height;
+    string_t m_block;
+    string_t m_empty;
+    json::Value * m_styles;
     std::map<string_t, json::Map *> m_style_map;
-    std::map<string_t, string_t> m_color_map;
+    GridData m_puzzle;
+    GridData m_solution;
+    GridData m_saved;
+    GridData * m_grid; // The grid being read
+    bool m_hasClues;
+    std::map<string_t, ClueListData> m_clues;
+    ClueListData * m_clueList; // The clue list being read
+
+    // The clue being read
+    string_t m_clueNumber;
+    string_t m_clueText;
+    string_t m_clueEnumeration;
+    bool m_hasClueText;
+    bool m_hasClueCells;
+    coords_t m_clueCells;
 };
 
-void LoadIpuzStream(Puzzle * puz, const std::string & filename, std::istream & stream)
+static void LoadIpuzData(Puzzle * puz, const char * data, size_t length)
 {
-    if (stream.fail())
-        throw FileError(filename);
     // Throw away "ipuz("
-    char test[6];
-    stream.read(test, 5);
-    test[5] = '\0';
-    if (std::string("ipuz(") != test)
-        stream.seekg(0);
-    // Load the file
-    ipuzParser parser;
-    parser.LoadPuzzle(puz, stream);
+    if (length >= 5 && memcmp(data, "ipuz(", 5) == 0)
+    {
+        data += 5;
+        length -= 5;
+    }
+    // JSON document errors will be LoadErrors
+    try {
+        ipuzHandler handler(puz);
+        json::Parse(data, length, handler);
+        handler.Finish();
+    }
+    catch (json::BaseError & e) {
+        throw LoadError(e.what());
+    }
 }
 
 void LoadIpuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
 {
-    std::ifstream stream(filename.c_str());
-    LoadIpuzStream(puz, filename, stream);
+    file_map file;
+    if (! file.Open(filename))
+        throw FileError(filename);
+    LoadIpuzData(puz, file.data(), file.size());
+}
+
+
+void LoadIpuzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    LoadIpuzData(puz, data, length);
 }
 
+int ProbeIpuz(const char * data, size_t length)
+{
+    const char * pos = data;
+    const char * end = data + length;
+    // UTF-8 BOM
+    if (length >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        pos += 3;
+    while (pos < end && ::isspace(static_cast<unsigned char>(*pos)))
+        ++pos;
+    if (end - pos >= 5 && memcmp(pos, "ipuz(", 5) == 0)
+        return 100;
+    if (pos == end || *pos != '{')
+        return 0;
+    // Any JSON object could be ipuz, but the "kind" should mention ipuz.org
+    static const char kind[] = "ipuz.org";
+    if (std::search(pos, end, kind, kind + sizeof(kind) - 1) != end)
+        return 100;
+    return 50;
+}
 
 void LoadIpuzString(Puzzle * puz, const std::string & data)
 {
-    std::istringstream stream(data);
-    std::string filename("<json>");
-    LoadIpuzStream(puz, filename, stream);
+    LoadIpuzData(puz, data.data(), data.size());
 }
 
 // Parse an ipuz enumeration value and return a string to append to
@@ -118,7 +314,460 @@ string_t ParseEnumeration(const string_t & str)
     return ret;
 }
 
-void ipuzParser::SetStyle(Square & square, json::Value * style_value)
+
+// ----------------------------------------------------------------------------
+// Parser events
+// ----------------------------------------------------------------------------
+
+string_t ipuzHandler::GetString(const Scalar & val)
+{
+    if (! val.IsText())
+        throw json::TypeError("string");
+    return decode_utf8(val.str, val.len);
+}
+
+int ipuzHandler::GetInt(const Scalar & val)
+{
+    if (val.type != json::j_number)
+        throw json::TypeError("number");
+    return ToInt(decode_utf8(val.str, val.len));
+}
+
+void ipuzHandler::Buffer(json::Value ** target)
+{
+    m_builder.reset(new json::TreeBuilder(m_document));
+    m_bufferTarget = target;
+}
+
+// If a value is being buffered, pass it the event and return true
+template <typename T>
+bool ipuzHandler::ForwardToBuffer(T event)
+{
+    if (! m_builder.get())
+        return false;
+    event(*m_builder);
+    if (m_builder->IsComplete())
+    {
+        *m_bufferTarget = m_builder->GetRoot();
+        m_builder.reset();
+    }
+    return true;
+}
+
+void ipuzHandler::OnNull()
+{
+    if (! ForwardToBuffer([](json::Handler & h) { h.OnNull(); }))
+        OnScalar(Scalar(json::j_null));
+}
+
+void ipuzHandler::OnBool(bool val)
+{
+    if (! ForwardToBuffer([val](json::Handler & h) { h.OnBool(val); }))
+        OnScalar(Scalar(json::j_bool));
+}
+
+void ipuzHandler::OnNumber(const char * str, size_t len)
+{
+    if (! ForwardToBuffer([=](json::Handler & h) { h.OnNumber(str, len); }))
+        OnScalar(Scalar(json::j_number, str, len));
+}
+
+void ipuzHandler::OnString(const char * str, size_t len)
+{
+    if (! ForwardToBuffer([=](json::Handler & h) { h.OnString(str, len); }))
+        OnScalar(Scalar(json::j_string, str, len));
+}
+
+void ipuzHandler::OnMapKey(const char * str, size_t len)
+{
+    if (ForwardToBuffer([=](json::Handler & h) { h.OnMapKey(str, len); }))
+        return;
+    if (m_skipDepth == 0)
+        m_key.assign(str, len);
+}
+
+void ipuzHandler::OnScalar(const Scalar & val)
+{
+    if (m_skipDepth > 0)
+        return;
+    if (m_stack.empty())
+        throw json::TypeError("map");
+    switch (m_stack.back())
+    {
+    case DOC:
+        if (KeyIs("kind"))
+            throw FileTypeError("ipuz");
+        else if (KeyIs("dimensions"))
+            throw json::TypeError("map");
+        else if (KeyIs("puzzle") || KeyIs("solution") || KeyIs("saved"))
+            throw json::TypeError("array");
+        else if (KeyIs("clues"))
+            throw json::TypeError("map");
+        else if (val.IsNull())
+            ; // Use the default
+        else if (KeyIs("title"))
+            m_title = GetString(val);
+        else if (KeyIs("author"))
+            m_author = GetString(val);
+        else if (KeyIs("copyright"))
+            m_copyright = GetString(val);
+        else if (KeyIs("notes"))
+            m_notes = GetString(val);
+        else if (KeyIs("intro"))
+            m_intro = GetString(val);
+        else if (KeyIs("block"))
+            m_block = GetString(val);
+        else if (KeyIs("empty"))
+            m_empty = GetString(val);
+        break;
+    case KIND:
+        if (! val.IsText())
+            throw FileTypeError("ipuz");
+        m_kinds.push_back(GetString(val));
+        break;
+    case DIMENSIONS:
+        if (KeyIs("width"))
+            m_width = GetInt(val);
+        else if (KeyIs("height"))
+            m_height = GetInt(val);
+        break;
+    case GRID:
+        throw json::TypeError("array");
+    case GRID_ROW:
+        AddGridCell(val);
+        break;
+    case GRID_CELL:
+    {
+        GridCell & cell = m_grid->cells.back();
+        const bool isPuzzle = m_grid == &m_puzzle;
+        if (KeyIs(isPuzzle ? "cell" : "value"))
+        {
+            cell.hasValue = ! val.IsNull();
+            cell.value = val.IsNull() ? string_t() : GetString(val);
+        }
+        else if (isPuzzle && KeyIs("value") && ! val.IsNull())
+            cell.text = GetString(val);
+        else if (isPuzzle && KeyIs("style") && val.type == json::j_string)
+        {
+            // Named style
+            json::TreeBuilder builder(m_document);
+            builder.OnString(val.str, val.len);
+            cell.style = builder.GetRoot();
+        }
+        break;
+    }
+    case CLUES:
+        throw json::TypeError("array");
+    case CLUE_LIST:
+        AddClue(puzT(""), GetString(val));
+        break;
+    case CLUE_ARRAY:
+        if (m_index == 0)
+            m_clueNumber = GetString(val);
+        else if (m_index == 1)
+            m_clueText = GetString(val);
+        ++m_index;
+        break;
+    case CLUE_MAP:
+        if (KeyIs("clue"))
+        {
+            m_clueText = GetString(val);
+            m_hasClueText = true;
+        }
+        else if (val.IsNull())
+            ; // Use the default
+        else if (KeyIs("number"))
+            m_clueNumber = GetString(val);
+        else if (KeyIs("enumeration"))
+            m_clueEnumeration = GetString(val);
+        else if (KeyIs("cells"))
+            throw json::TypeError("array");
+        break;
+    case CLUE_CELLS:
+        throw json::TypeError("array");
+    case CLUE_CELL:
+        if (m_index == 0)
+            m_clueCells.push_back(std::make_pair(GetInt(val) - 1, 0));
+        else if (m_index == 1)
+            m_clueCells.back().second = GetInt(val) - 1;
+        ++m_index;
+        break;
+    }
+}
+
+void ipuzHandler::OnStart(bool isMap)
+{
+    if (ForwardToBuffer([isMap](json::Handler & h) {
+            if (isMap) h.OnMapStart(); else h.OnArrayStart(); }))
+    {
+        return;
+    }
+    if (m_skipDepth > 0)
+    {
+        ++m_skipDepth;
+        return;
+    }
+    if (m_stack.empty())
+    {
+        if (! isMap)
+            throw json::TypeError("map");
+        m_stack.push_back(DOC);
+        return;
+    }
+    switch (m_stack.back())
+    {
+    case DOC:
+        if (KeyIs("kind"))
+        {
+            if (isMap)
+                throw FileTypeError("ipuz");
+            m_hasKind = true;
+            m_kinds.clear();
+            m_stack.push_back(KIND);
+        }
+        else if (KeyIs("dimensions"))
+        {
+            if (! isMap)
+                throw json::TypeError("map");
+            m_hasDimensions = true;
+            m_width = m_height = -1;
+            m_stack.push_back(DIMENSIONS);
+        }
+        else if (KeyIs("styles") && isMap)
+        {
+            Buffer(&m_styles);
+            m_builder->OnMapStart();
+        }
+        else if (KeyIs("puzzle") || KeyIs("solution") || KeyIs("saved"))
+        {
+            if (isMap)
+                throw json::TypeError("array");
+            m_grid = KeyIs("puzzle") ? &m_puzzle
+                   : KeyIs("solution") ? &m_solution
+                   : &m_saved;
+            m_grid->present = true;
+            m_grid->cells.clear();
+            m_row = 0;
+            m_stack.push_back(GRID);
+        }
+        else if (KeyIs("clues"))
+        {
+            if (! isMap)
+                throw json::TypeError("map");
+            m_hasClues = true;
+            m_clues.clear();
+            m_stack.push_back(CLUES);
+        }
+        else
+        {
+            Skip();
+        }
+        break;
+    case GRID:
+        if (isMap)
+            throw json::TypeError("array");
+        m_col = 0;
+        m_stack.push_back(GRID_ROW);
+        break;
+    case GRID_ROW:
+        if (! isMap)
+            throw json::TypeError("string");
+        m_grid->cells.push_back(GridCell(m_col++, m_row));
+        m_grid->cells.back().isMap = true;
+        m_stack.push_back(GRID_CELL);
+        break;
+    case GRID_CELL:
+        if (m_grid == &m_puzzle && KeyIs("style"))
+        {
+            GridCell & cell = m_grid->cells.back();
+            Buffer(&cell.style);
+            if (isMap) m_builder->OnMapStart(); else m_builder->OnArrayStart();
+        }
+        else if (KeyIs(m_grid == &m_puzzle ? "cell" : "value")
+                 || (m_grid == &m_puzzle && KeyIs("value")))
+        {
+            throw json::TypeError("string");
+        }
+        else
+        {
+            Skip();
+        }
+        break;
+    case CLUES:
+        if (isMap)
+            throw json::TypeError("array");
+        {
+            const string_t name = decode_utf8(m_key);
+            m_clueList = &m_clues[name];
+            *m_clueList = ClueListData();
+        }
+        m_stack.push_back(CLUE_LIST);
+        break;
+    case CLUE_LIST:
+        m_clueNumber.clear();
+        m_clueText.clear();
+        m_clueEnumeration.clear();
+        m_hasClueText = false;
+        m_hasClueCells = false;
+        m_clueCells.clear();
+        m_index = 0;
+        m_stack.push_back(isMap ? CLUE_MAP : CLUE_ARRAY);
+        break;
+    case CLUE_ARRAY:
+        if (m_index < 2)
+            throw json::TypeError("string");
+        ++m_index;
+        Skip();
+        break;
+    case CLUE_MAP:
+        if (KeyIs("cells"))
+        {
+            if (isMap)
+                throw json::TypeError("array");
+            m_hasClueCells = true;
+            m_clueCells.clear();
+            m_stack.push_back(CLUE_CELLS);
+        }
+        else if (KeyIs("number") || KeyIs("clue") || KeyIs("enumeration"))
+        {
+            throw json::TypeError("string");
+        }
+        else
+        {
+            Skip();
+        }
+        break;
+    case CLUE_CELLS:
+        if (isMap)
+            throw json::TypeError("array");
+        m_index = 0;
+        m_stack.push_back(CLUE_CELL);
+        break;
+    case CLUE_CELL:
+        if (m_index < 2)
+            throw json::TypeError("number");
+        ++m_index;
+        Skip();
+        break;
+    case KIND:
+        throw FileTypeError("ipuz");
+    case DIMENSIONS:
+        if (KeyIs("width") || KeyIs("height"))
+            throw json::TypeError("number");
+        Skip();
+        break;
+    }
+}
+
+void ipuzHandler::OnEnd(bool isMap)
+{
+    if (ForwardToBuffer([isMap](json::Handler & h) {
+            if (isMap) h.OnMapEnd(); else h.OnArrayEnd(); }))
+    {
+        return;
+    }
+    if (m_skipDepth > 0)
+    {
+        --m_skipDepth;
+        return;
+    }
+    const State state = m_stack.back();
+    m_stack.pop_back();
+    switch (state)
+    {
+    case KIND:
+        // Stop early if this isn't a crossword
+        CheckKind(false);
+        break;
+    case DIMENSIONS:
+        if (m_width < 0)
+            throw json::KeyError("width");
+        if (m_height < 0)
+            throw json::KeyError("height");
+        break;
+    case GRID_ROW:
+        ++m_row;
+        break;
+    case CLUE_ARRAY:
+        if (m_index < 2)
+            throw json::IndexError(1);
+        AddClue(m_clueNumber, m_clueText);
+        break;
+    case CLUE_MAP:
+    {
+        if (! m_hasClueText)
+            throw json::KeyError("clue");
+        const string_t enum_ = ParseEnumeration(m_clueEnumeration);
+        if (! enum_.empty())
+            m_clueText.append(puzT(" ("))
+                .append(enum_)
+                .append(puzT(")"));
+        AddClue(m_clueNumber, m_clueText);
+        if (m_hasClueCells)
+            m_clueList->words.push_back(
+                std::make_pair(m_clueList->clues.size() - 1, m_clueCells));
+        break;
+    }
+    case CLUE_CELL:
+        if (m_index < 2)
+            throw json::IndexError(m_index);
+        break;
+    default:
+        break;
+    }
+}
+
+void ipuzHandler::AddGridCell(const Scalar & val)
+{
+    if (! val.IsNull())
+    {
+        m_grid->cells.push_back(GridCell(m_col, m_row));
+        GridCell & cell = m_grid->cells.back();
+        cell.hasValue = true;
+        cell.value = GetString(val);
+    }
+    ++m_col;
+}
+
+void ipuzHandler::AddClue(const string_t & number, const string_t & text)
+{
+    m_clueList->clues.push_back(Clue(number, text, /* is_html */ true));
+}
+
+
+// ----------------------------------------------------------------------------
+// Puzzle setup
+// ----------------------------------------------------------------------------
+
+// Check kind from most to least specific until we find a match, and throw
+// if there isn't one.  If setType is true, also set the grid type.
+void ipuzHandler::CheckKind(bool setType)
+{
+    std::vector<string_t>::iterator i = m_kinds.end();
+    while (i != m_kinds.begin()) {
+        string_t kind = *(--i);
+        if (kind.substr(kind.size() - 2) == puzT("#1"))
+            kind = kind.substr(0, kind.size() - 2);
+        if (kind == puzT("http://ipuz.org/crossword") ||
+            kind == puzT("http://ipuz.org/crossword/crypticcrossword")) {
+            // Regular crossword
+            return;
+        } else if (kind == puzT("http://ipuz.org/crossword/diagramless")) {
+            // Diagramless crossword
+            if (setType)
+                m_puz->GetGrid().SetType(TYPE_DIAGRAMLESS);
+            return;
+        } else if (kind == puzT("http://crosswordnexus.com/ipuz/coded")) {
+            // Coded crossword
+            if (setType)
+                m_puz->GetGrid().SetType(TYPE_CODED);
+            return;
+        }
+    }
+    throw LoadError("Unsupported ipuz kind");
+}
+
+void ipuzHandler::SetStyle(Square & square, json::Value * style_value)
 {
     if (! style_value)
         return;
@@ -155,13 +804,13 @@ void ipuzParser::SetStyle(Square & square, json::Value * style_value)
     if (style->Contains(puzT("mark"))) {
         json::Map* mark = style->GetMap(puzT("mark"));
         if (mark->Contains(puzT("TL")))
-            square.m_mark[MARK_TL] = mark->GetString(puzT("TL"), puzT(""));
+            square.SetMark(MARK_TL, mark->GetString(puzT("TL"), puzT("")));
         if (mark->Contains(puzT("TR")))
-            square.m_mark[MARK_TR] = mark->GetString(puzT("TR"), puzT(""));
+            square.SetMark(MARK_TR, mark->GetString(puzT("TR"), puzT("")));
         if (mark->Contains(puzT("BL")))
-            square.m_mark[MARK_BL] = mark->GetString(puzT("BL"), puzT(""));
+            square.SetMark(MARK_BL, mark->GetString(puzT("BL"), puzT("")));
         if (mark->Contains(puzT("BR")))
-            square.m_mark[MARK_BR] = mark->GetString(puzT("BR"), puzT(""));
+            square.SetMark(MARK_BR, mark->GetString(puzT("BR"), puzT("")));
     }
 
     // Color
@@ -184,233 +833,105 @@ void ipuzParser::SetStyle(Square & square, json::Value * style_value)
 }
 
 
-bool ipuzParser::DoLoadPuzzle(Puzzle * puz, json::Value * root)
+
+void ipuzHandler::ApplyGrid(const GridData & grid, bool isPuzzle, bool isSaved)
 {
-    json::Map * doc = root->AsMap();
-    try {
-        // Check kind from most to least specific until we find a match
-        json::Array * kinds = doc->PopArray(puzT("kind"));
-        std::vector<json::Value*>::iterator i = kinds->end();
-        bool known_type = false;
-        while (i != kinds->begin() && !known_type) {
-            string_t kind = (*(--i))->AsString();
-            if (kind.substr(kind.size() - 2) == puzT("#1"))
-                kind = kind.substr(0, kind.size() - 2);
-            if (kind == puzT("http://ipuz.org/crossword") ||
-                kind == puzT("http://ipuz.org/crossword/crypticcrossword")) {
-                // Regular crossword
-                known_type = true;
-            } else if (kind == puzT("http://ipuz.org/crossword/diagramless")) {
-                // Diagramless crossword
-                known_type = true;
-                puz->GetGrid().SetType(TYPE_DIAGRAMLESS);
-            } else if (kind == puzT("http://crosswordnexus.com/ipuz/coded")) {
-                // Coded crossword
-                known_type = true;
-                puz->GetGrid().SetType(TYPE_CODED);
-            }
+    std::vector<GridCell>::const_iterator cell;
+    for (cell = grid.cells.begin(); cell != grid.cells.end(); ++cell)
+    {
+        Square & square = m_puz->GetGrid().At(cell->col, cell->row);
+        const string_t & val = cell->hasValue ? cell->value : m_empty;
+        if (isPuzzle)
+        {
+            square.SetMissing(false);
+            if (cell->style)
+                SetStyle(square, cell->style);
+            if (cell->isMap)
+                square.SetText(cell->text);
+            if (val == m_block)
+                square.SetSolution(square.Black);
+            else if (val != m_empty)
+                square.SetNumber(val);
+        }
+        else if (isSaved)
+        {
+            if (val == m_block)
+                square.SetText(square.Black);
+            else if (val != m_empty)
+                square.SetText(val);
         }
-        if (!known_type) {
-            throw LoadError("Unsupported ipuz kind");
+        else
+        {
+            if (val == m_block)
+                square.SetSolution(square.Black);
+            else if (val != m_empty)
+                square.SetSolution(val);
         }
     }
-    catch (json::BaseError &) {
+}
+
+void ipuzHandler::Finish()
+{
+    if (! m_hasKind)
         throw FileTypeError("ipuz");
-    }
+    CheckKind(true);
 
     // Metadata
-    puz->SetTitle(doc->PopString(puzT("title"), puzT("")), /* is_html */ true);
-    puz->SetAuthor(doc->PopString(puzT("author"), puzT("")), /* is_html */ true);
-    puz->SetCopyright(doc->PopString(puzT("copyright"), puzT("")), /* is_html */ true);
-    string_t notes = doc->PopString(puzT("notes"), puzT(""));
-    if (! notes.empty())
-        puz->SetNotes(notes, /* is_html */ true);
+    m_puz->SetTitle(m_title, /* is_html */ true);
+    m_puz->SetAuthor(m_author, /* is_html */ true);
+    m_puz->SetCopyright(m_copyright, /* is_html */ true);
+    if (! m_notes.empty())
+        m_puz->SetNotes(m_notes, /* is_html */ true);
     else
-        puz->SetNotes(doc->PopString(puzT("intro"), puzT("")), /* is_html */ true);
+        m_puz->SetNotes(m_intro, /* is_html */ true);
 
     // Read the styles into a style map
-    if (doc->Contains(puzT("styles")))
+    if (m_styles)
     {
-        json::Map * styles = doc->GetMap(puzT("styles"));
+        json::Map * styles = m_styles->AsMap();
         json::Map::iterator style;
         for (style = styles->begin(); style != styles->end(); ++style)
-            m_style_map[style->first] = style->second->AsMap();
+            m_style_map[decode_utf8(style->first.data(), style->first.size())] =
+                style->second->AsMap();
     }
 
     // Grid
-    string_t block_str = doc->PopString(puzT("block"), puzT("#"));
-    string_t empty_str = doc->PopString(puzT("empty"), puzT("0"));
-
-    json::Map * dim = doc->GetMap(puzT("dimensions"));
-    puz->GetGrid().SetSize(
-        ToInt(dim->GetNumber(puzT("width"))),
-        ToInt(dim->GetNumber(puzT("height")))
-    );
+    if (! m_hasDimensions)
+        throw json::KeyError("dimensions");
+    Grid & grid = m_puz->GetGrid();
+    grid.SetSize(m_width, m_height);
     // Set all squares to missing to start
-    {
-        for (Square * square = puz->GetGrid().First();
-             square != NULL;
-             square = square->Next())
-        {
-            square->SetMissing();
-        }
-    }
-
-    // Iterating the json grid is kind of a pain, and this ugly macro makes it
-    // a bit easier.
-#define GRID_FOREACH(grid_val, block)                                        \
-    {                                                                        \
-        json::Array * grid = grid_val;                                       \
-        size_t r = 0;                                                        \
-        json::Array::iterator row_it;                                        \
-        for (row_it = grid->begin(); row_it != grid->end(); ++row_it)        \
-        {                                                                    \
-            size_t c = 0;                                                    \
-            json::Array * row = (*row_it)->AsArray();                        \
-            json::Array::iterator cell_it;                                   \
-            for (cell_it = row->begin(); cell_it != row->end(); ++cell_it)   \
-            {                                                                \
-                json::Value * cell = *cell_it;                               \
-                Square & square = puz->GetGrid().At(c, r);                   \
-                block;                                                       \
-                ++c;                                                         \
-            }                                                                \
-            ++r;                                                             \
-        }                                                                    \
-    }
-
-    // Block / clue number layout
-    GRID_FOREACH(doc->GetArray(puzT("puzzle")),
-    {
-        if (! cell->IsNull())
-        {
-            square.SetMissing(false);
-            string_t val;
-            if (! cell->IsMap())
-                val = cell->AsString();
-            else
-            {
-                json::Map * map = cell->AsMap();
-                val = map->GetString(puzT("cell"), empty_str);
-                if (map->Contains(puzT("style")))
-                    SetStyle(square, map->Get(puzT("style")));
-                square.SetText(map->GetString(puzT("value"), puzT("")));
-            }
-            if (val == block_str)
-                square.SetSolution(square.Black);
-            else if (val != empty_str)
-                square.SetNumber(val);
-        }
-    });
-
-    // Solution
-    if (doc->Contains(puzT("solution")))
-    {
-        GRID_FOREACH(doc->GetArray(puzT("solution")),
-        {
-            if (! cell->IsNull())
-            {
-                string_t val;
-                if (! cell->IsMap())
-                    val = cell->AsString();
-                else
-                    val = cell->AsMap()->GetString(puzT("value"), empty_str);
-                if (val == block_str)
-                    square.SetSolution(square.Black);
-                else if (val != empty_str)
-                    square.SetSolution(val);
-            }
-        });
-    }
+    for (Square * square = grid.First(); square != NULL; square = square->Next())
+        square->SetMissing();
+
+    if (! m_puzzle.present)
+        throw json::KeyError("puzzle");
+    ApplyGrid(m_puzzle, true, false);
+    if (m_solution.present)
+        ApplyGrid(m_solution, false, false);
     else
-    {
-        puz->GetGrid().SetFlag(FLAG_NO_SOLUTION);
-    }
-
-    // User grid
-    if (doc->Contains(puzT("saved")))
-    {
-        GRID_FOREACH(doc->GetArray(puzT("saved")),
-        {
-            if (! cell->IsNull())
-            {
-                string_t val;
-                if (! cell->IsMap())
-                    val = cell->AsString();
-                else
-                    val = cell->AsMap()->GetString(puzT("value"), empty_str);
-                if (val == block_str)
-                    square.SetText(square.Black);
-                else if (val != empty_str)
-                    square.SetText(val);
-            }
-        });
-    }
-
+        grid.SetFlag(FLAG_NO_SOLUTION);
+    if (m_saved.present)
+        ApplyGrid(m_saved, false, true);
 
     // Clues
-    json::Map * cluelists = doc->GetMap(puzT("clues"));
+    if (! m_hasClues)
+        throw json::KeyError("clues");
+    std::map<string_t, ClueListData>::iterator list;
+    for (list = m_clues.begin(); list != m_clues.end(); ++list)
     {
-        json::Map::iterator cl_it;
-        for (cl_it = cluelists->begin(); cl_it != cluelists->end(); ++cl_it)
+        ClueListData & data = list->second;
+        std::vector<std::pair<size_t, coords_t> >::iterator word_it;
+        for (word_it = data.words.begin(); word_it != data.words.end(); ++word_it)
         {
-            ClueList cluelist;
-            json::Array * clues = cl_it->second->AsArray();
-            json::Array::iterator clue_it;
-            for (clue_it = clues->begin(); clue_it != clues->end(); ++clue_it)
-            {
-                json::Value * clueVal = (*clue_it);
-                if (clueVal->IsSimple())
-                    cluelist.push_back(Clue(puzT(""), clueVal->AsString(), /* is_html */ true));
-                else if (clueVal->IsArray())
-                {
-                    json::Array * clue = (*clue_it)->AsArray();
-                    cluelist.push_back(Clue(clue->GetString(0),
-                                            clue->GetString(1),
-                                            /* is_html */ true));
-                }
-                else
-                {
-                    json::Map * clue = (*clue_it)->AsMap();
-
-                    string_t enum_ = ParseEnumeration(
-                        clue->GetString(puzT("enumeration"), puzT(""))
-                    );
-                    string_t text = clue->GetString(puzT("clue"));
-                    if (! enum_.empty())
-                        text.append(puzT(" ("))
-                            .append(enum_)
-                            .append(puzT(")"));
-
-                    Clue outClue(
-                        clue->GetString(puzT("number"), puzT("")),
-                        text,
-                        /* is_html */ true
-                    );
-
-                    if (clue->Contains(puzT("cells"))) {
-                        json::Array * cells = clue->GetArray(puzT("cells"));
-                        Word word;
-                        json::Array::iterator cell_it;
-                        for (cell_it = cells->begin(); cell_it != cells->end(); ++cell_it) {
-                            json::Array * cellVal = (*cell_it)->AsArray();
-                            word.push_back(&puz->GetGrid().At(
-                                // ipuz coordinates are 1-based.
-                                ToInt(cellVal->GetNumber(0)) - 1,
-                                ToInt(cellVal->GetNumber(1)) - 1));
-                        }
-                        outClue.SetWord(word);
-                    }
-
-                    cluelist.push_back(outClue);
-                }
-            }
-            puz->SetClueList(cl_it->first, cluelist);
+            Word word;
+            coords_t::iterator cell;
+            for (cell = word_it->second.begin(); cell != word_it->second.end(); ++cell)
+                word.push_back(&grid.At(cell->first, cell->second));
+            data.clues[word_it->first].SetWord(std::move(word));
         }
+        m_puz->SetClueList(list->first, std::move(data.clues));
     }
-
-    puz->SetFormatData(new ipuzData(root));
-    return true; // puz owns json::Value * root
 }
 
 } // namespace puz
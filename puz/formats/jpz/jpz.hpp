@@ -33,6 +33,8 @@ public:
 };
 
 void LoadJpz(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadJpzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeJpz(const char * data, size_t length);
 void SaveJpz(Puzzle * puz, const std::string & filename, void * /* dummy */);
 
 } // namespace puz
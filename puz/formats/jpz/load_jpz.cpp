@@ -21,7 +21,10 @@
 #include "Clue.hpp"
 #include "puzstring.hpp"
 #include "utils/minizip.hpp"
-#include <sstream>
+#include "utils/filemap.hpp"
+#include <cstring>
+#include <climits>
+#include <algorithm>
 #include "parse/base64.hpp"
 
 namespace puz {
@@ -46,42 +49,73 @@ private:
 };
 
 
+static void LoadJpzArchive(Puzzle * puz, jpzParser & parser, unzip::Archive & zip);
+
 void LoadJpz(Puzzle * puz, const std::string & filename, void * /* dummy */)
+{
+    // Map the file, and read it as a zip archive or plain xml
+    file_map file;
+    if (! file.Open(filename))
+        throw FileError(filename);
+    LoadJpzBuffer(puz, file.data(), file.size(), NULL);
+}
+
+void LoadJpzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
 {
     jpzParser parser;
 
     // Open a zip archive
-    unzip::Archive zip(filename);
-    if (! zip)
+    unzip::Archive zip;
+    if (! zip.Open(data, length))
     {
-        parser.LoadFromFilename(puz, filename);
+        parser.LoadFromBuffer(puz, data, length);
         return;
     }
+    LoadJpzArchive(puz, parser, zip);
+}
+
+int ProbeJpz(const char * data, size_t length)
+{
+    // jpz is the only format that is zipped, but plenty of other things
+    // are zip files too.
+    if (length >= 4 && memcmp(data, "PK\x03\x04", 4) == 0)
+        return 75;
+    const std::string root = xml::GetRootName(data, length);
+    if (root == "crossword-compiler-applet" || root == "crossword-compiler")
+        return 100;
+    return 0;
+}
+
+void LoadJpzArchive(Puzzle * puz, jpzParser & parser, unzip::Archive & zip)
+{
     // Browse the archive
     unzip::File f = zip.First();
     int n_files = zip.GetFileCount();
     while (f)
     {
-        // Read the file
+        // Inflate the file straight into the buffer that is parsed
         f.Open();
-        std::ostringstream stream;
-        for (;;)
+        const size_t size = f.GetSize();
+        char * buffer = xml::Parser::AllocateBuffer(size);
+        size_t length = 0;
+        while (length < size)
         {
-            char buf[1024];
-            int chars_read = f.Read(buf, 1024);
-            stream.write(buf, chars_read);
+            const unsigned int chunk = static_cast<unsigned int>(
+                std::min<size_t>(size - length, INT_MAX));
+            const int chars_read = f.Read(buffer + length, chunk);
             if (chars_read <= 0)
                 break;
+            length += chars_read;
         }
         if (n_files == 1)
         {
-            parser.LoadFromString(puz, stream.str().c_str());
+            parser.LoadInPlace(puz, buffer, length);
             return;
         }
         else
         {
             try {
-                parser.LoadFromString(puz, stream.str().c_str());
+                parser.LoadInPlace(puz, buffer, length);
                 return;
             }
             catch (...) {
@@ -298,7 +332,7 @@ bool jpzParser::DoLoadPuzzle(Puzzle * puz, xml::document & doc)
                 if (GetAttribute(cell, "correct") == puzT("true"))
                     square->AddFlag(FLAG_CORRECT);
                 // Top right number
-                square->m_mark[MARK_TR] = GetAttribute(cell, "top-right-number");
+                square->SetMark(MARK_TR, GetAttribute(cell, "top-right-number"));
                 // Bars
                 if (GetAttribute(cell, "top-bar") == puzT("true"))
                     square->m_bars[BAR_TOP] = true;
@@ -313,9 +347,9 @@ bool jpzParser::DoLoadPuzzle(Puzzle * puz, xml::document & doc)
             xml::node image = cell.child("background-picture");
             if (image)
             {
-                square->m_imageformat = image.attribute("format").value();
-                square->m_imagedata = base64_decode(
-                    image.child_value("encoded-image"));
+                square->SetImage(image.attribute("format").value(),
+                                 base64_decode(
+                                     image.child_value("encoded-image")));
             }
         }
 
@@ -388,7 +422,7 @@ bool jpzParser::DoLoadPuzzle(Puzzle * puz, xml::document & doc)
                 string_t number = GetAttribute(clue, "number");
                 list.push_back(Clue(number, text, it->second, /* is_html */ true));
             }
-            puz->SetClueList(key, list);
+            puz->SetClueList(key, std::move(list));
             hasClueList = true;
         }
 
@@ -21,6 +21,8 @@
 #include "Clue.hpp"
 #include "puzstring.hpp"
 #include <fstream>
+#include <cstring>
+#include <map>
 #include "utils/minizip.hpp"
 #include "parse/base64.hpp"
 
@@ -42,193 +44,222 @@ protected:
     zip::File & m_file;
 };
 
-void AppendChildWithSpanWrapping(xml::node parent, int child_count, xml::node child) {
-    if (child_count > 1 && child.type() == pugi::xml_node_type::node_pcdata) {
-        // When writing mixed content, plain text must be wrapped in <span> tags.
-        xml::node span = parent.append_child("span");
-        span.append_copy(child);
-    } else {
-        parent.append_copy(child);
-    }
-}
-
 //-----------------------------------------------------------------------------
 // SaveJpz
 //-----------------------------------------------------------------------------
-void SaveJpz(Puzzle * puz, const std::string & filename, void * /* dummy */)
+static void WriteSettings(xml::Writer & w, Puzzle * puz)
 {
     const Grid & grid = puz->GetGrid();
-
-    if (grid.IsScrambled())
-        throw ConversionError("Jpz does not support scrambled puzzles");
-    if (grid.GetType() == TYPE_DIAGRAMLESS)
-        throw ConversionError("Can't save a diagramless puzzle as jpz.");
-
-    xml::document doc;
-
-    xml::node applet = doc.append_child("crossword-compiler-applet");
-    applet.append_attribute("xmlns") =
-        "http://crossword.info/xml/crossword-compiler-applet";
-
-    // Read settings from the saved XML Doc, otherwise provide default
+    // Keep settings from the saved XML Doc, otherwise provide default
     // settings.
     JpzData * data = dynamic_cast<JpzData *>(puz->GetFormatData());
+    xml::node settings;
     if (data)
+        settings = data->doc->child("crossword-compiler-applet")
+                             .child("applet-settings");
+    w.StartElement("applet-settings");
+    if (settings)
     {
-        applet.append_copy(data->doc->child("crossword-compiler-applet")
-                                    .child("applet-settings"));
+        xml::attribute attr;
+        for (attr = settings.first_attribute(); attr; attr = attr.next_attribute())
+            w.Attribute(attr.name(), attr.value());
+        // Copy everything but the timer
+        bool skippedTimer = false;
+        xml::node child;
+        for (child = settings.first_child(); child; child = child.next_sibling())
+        {
+            if (! skippedTimer && child.type() == pugi::node_element
+                && strcmp(child.name(), "timer") == 0)
+            {
+                skippedTimer = true;
+                continue;
+            }
+            w.Node(child);
+        }
     }
-    if (! applet.child("applet-settings"))
+    else
     {
-        xml::node settings = applet.append_child("applet-settings");
-        settings.append_attribute("cursor-color") = "#FFFF00";
-        settings.append_attribute("selected-cells-color") = "#C0C0C0";
+        w.Attribute("cursor-color", "#FFFF00");
+        w.Attribute("selected-cells-color", "#C0C0C0");
 
-        xml::node actions = settings.append_child("actions");
-        actions.append_attribute("buttons-layout") = "below";
-        actions.append_child("revert").append_attribute("label") = "Clear All";
-        xml::node completion = settings.append_child("completion");
+        w.StartElement("actions");
+        w.Attribute("buttons-layout", "below");
+        w.StartElement("revert");
+        w.Attribute("label", "Clear All");
+        w.EndElement();
         if (grid.HasSolution()) {
-            actions.append_child("check").append_attribute("label") = "Check";
-            actions.append_child("reveal-letter").append_attribute("label") =
-                "Reveal Letter";
-            actions.append_child("reveal-word").append_attribute("label") =
-                "Reveal Word";
-            actions.append_child("solution").append_attribute("label") = "Solution";
-            completion.append_attribute("only-if-correct") = "true";
-        }
-        else {
-            completion.append_attribute("only-if-correct") = "false";
+            w.StartElement("check");
+            w.Attribute("label", "Check");
+            w.EndElement();
+            w.StartElement("reveal-letter");
+            w.Attribute("label", "Reveal Letter");
+            w.EndElement();
+            w.StartElement("reveal-word");
+            w.Attribute("label", "Reveal Word");
+            w.EndElement();
+            w.StartElement("solution");
+            w.Attribute("label", "Solution");
+            w.EndElement();
         }
+        w.EndElement(); // actions
 
+        w.StartElement("completion");
+        w.Attribute("only-if-correct", grid.HasSolution());
         string_t message = puz->GetMeta(puzT("completion"));
         if (message.empty()) {
             message = puzT("Congratulations, you have solved the puzzle!");
         }
-        xml::SetText(completion, message);
+        w.Text(message);
+        w.EndElement();
     }
     // Timer
-    applet.child("applet-settings").remove_child("timer");
-    xml::node timer = applet.child("applet-settings").append_child("timer");
-    timer.append_attribute("start-on-load") = puz->IsTimerRunning();
-    timer.append_attribute("initial-value") = puz->GetTime();
+    w.StartElement("timer");
+    w.Attribute("start-on-load", puz->IsTimerRunning());
+    w.Attribute("initial-value", puz->GetTime());
+    w.EndElement();
+    w.EndElement(); // applet-settings
+}
+
+static void WriteCell(xml::Writer & w, const Grid & grid, const Square * square)
+{
+    w.StartElement("cell");
+    w.Attribute("x", square->GetCol() + 1); // 1-based
+    w.Attribute("y", square->GetRow() + 1);
+    if (square->IsMissing())
+    {
+        w.Attribute("type", "void");
+    }
+    else if (square->IsBlack() && !square->IsAnnotation())
+    {
+        w.Attribute("type", "block");
+        if (square->HasColor())
+            w.Attribute("background-color", square->GetHtmlColor());
+    }
+    else
+    {
+        if (square->IsAnnotation())
+            w.Attribute("type", "clue");
+        if (grid.HasSolution())
+            w.Attribute("solution", square->GetSolution());
+        if (square->HasNumber())
+            w.Attribute("number", square->GetNumber());
+        if (! square->IsBlank())
+            w.Attribute("solve-state", square->GetText());
+        if (square->HasCircle())
+            w.Attribute("background-shape", "circle");
+        if (square->HasColor())
+            w.Attribute("background-color", square->GetHtmlColor());
+        if (square->HasFlag(FLAG_REVEALED))
+        {
+            w.Attribute("solve-status", "revealed");
+            w.Attribute("hint", "true");
+        }
+        else if (square->HasFlag(FLAG_PENCIL))
+            w.Attribute("solve-status", "pencil");
+        // Extra square flags to keep track of incorrect letters
+        // This is nonstandard, but doesn't break Crossword Solver.
+        if (square->HasFlag(FLAG_BLACK))
+            w.Attribute("checked", "true");
+        if (square->HasFlag(FLAG_X))
+            w.Attribute("incorect", "true");
+        if (square->HasFlag(FLAG_CORRECT))
+            w.Attribute("correct", "true");
+    }
+    // Attributes come before the background picture
+    if (square->HasMark(MARK_TR))
+        w.Attribute("top-right-number", square->GetMark(MARK_TR));
+    if (square->m_bars[BAR_TOP])
+        w.Attribute("top-bar", "true");
+    if (square->m_bars[BAR_LEFT])
+        w.Attribute("left-bar", "true");
+    if (square->m_bars[BAR_RIGHT])
+        w.Attribute("right-bar", "true");
+    if (square->m_bars[BAR_BOTTOM])
+        w.Attribute("bottom-bar", "true");
+    if (square->HasImage())
+    {
+        w.StartElement("background-picture");
+        w.Attribute("format", square->GetImageFormat());
+        const std::string & data = square->GetImageData();
+        w.StartElement("encoded-image");
+        w.Text(base64_encode(
+            (const unsigned char *)data.c_str(), data.length()));
+        w.EndElement();
+        w.EndElement();
+    }
+    w.EndElement();
+}
+
+void SaveJpz(Puzzle * puz, const std::string & filename, void * /* dummy */)
+{
+    const Grid & grid = puz->GetGrid();
+
+    if (grid.IsScrambled())
+        throw ConversionError("Jpz does not support scrambled puzzles");
+    if (grid.GetType() == TYPE_DIAGRAMLESS)
+        throw ConversionError("Can't save a diagramless puzzle as jpz.");
+
+    // Save to a zip file.
+    zip::Archive archive(filename);
+    if (! archive)
+        throw FileError(filename);
+    // Open a zip in the archive with the filename part of the path
+    zip::File & file = archive.OpenFile(
+        filename.substr(filename.find_last_of("/\\") + 1));
+    // The XML is deflated as it is written
+    xml_zip_writer zip_writer(file);
+    xml::Writer w(zip_writer, "");
+
+    w.StartElement("crossword-compiler-applet");
+    w.Attribute("xmlns", "http://crossword.info/xml/crossword-compiler-applet");
+
+    WriteSettings(w, puz);
 
     // On to the actual puzzle
-    xml::node puzzle = applet.append_child("rectangular-puzzle");
-    puzzle.append_attribute("xmlns") = 
-        "http://crossword.info/xml/rectangular-puzzle";
+    w.StartElement("rectangular-puzzle");
+    w.Attribute("xmlns", "http://crossword.info/xml/rectangular-puzzle");
     // Metadata
-    xml::node metadata = puzzle.append_child("metadata");
+    w.StartElement("metadata");
     const Puzzle::metamap_t & puz_metadata = puz->GetMetadata();
     Puzzle::metamap_t::const_iterator it;
     for (it = puz_metadata.begin(); it != puz_metadata.end(); ++it)
     {
         // Author is "creator" in jpz
         if (it->first == puzT("author"))
-            xml::SetInnerXML(metadata.append_child("creator"), it->second);
+            w.StartElement("creator");
         // Notes are jpz "instructions" and are under the "puzzle" element
         else if (it->first != puzT("notes"))
-            xml::SetInnerXML(metadata.append_child(puz::encode_utf8(it->first).c_str()), it->second);
+            w.StartElement(puz::encode_utf8(it->first).c_str());
+        else
+            continue;
+        w.InnerXML(it->second);
+        w.EndElement();
     }
+    w.EndElement(); // metadata
 
-    xml::SetInnerXML(puzzle.append_child("instructions"), puz->GetNotes());
+    w.StartElement("instructions");
+    w.InnerXML(puz->GetNotes());
+    w.EndElement();
 
-    const char* puzzle_root_tag;
-    if (grid.IsAcrostic())
-        puzzle_root_tag = "acrostic";
-    else
-        puzzle_root_tag = "crossword";
-    xml::node crossword = puzzle.append_child(puzzle_root_tag);
+    w.StartElement(grid.IsAcrostic() ? "acrostic" : "crossword");
 
     // Grid
-    xml::node xmlgrid = crossword.append_child("grid");
+    w.StartElement("grid");
     // Size
-    xmlgrid.append_attribute("width") = int(grid.GetWidth());
-    xmlgrid.append_attribute("height") = int(grid.GetHeight());
+    w.Attribute("width", int(grid.GetWidth()));
+    w.Attribute("height", int(grid.GetHeight()));
     // Meta
-    xml::node gridlook = xmlgrid.append_child("grid-look");
-    gridlook.append_attribute("numbering-scheme") = "normal";
-    gridlook.append_attribute("grid-line-color") = "#000000";
-    gridlook.append_attribute("block-color") = "#000000";
-    gridlook.append_attribute("font-color") = "#000000";
-    gridlook.append_attribute("number-color") = "#000000";
+    w.StartElement("grid-look");
+    w.Attribute("numbering-scheme", "normal");
+    w.Attribute("grid-line-color", "#000000");
+    w.Attribute("block-color", "#000000");
+    w.Attribute("font-color", "#000000");
+    w.Attribute("number-color", "#000000");
+    w.EndElement();
     // Cells
-    {
-        const Square * square;
-        for (square = grid.First(); square; square = square->Next())
-        {
-            xml::node cell = xmlgrid.append_child("cell");
-            cell.append_attribute("x") = square->GetCol() + 1; // 1-based
-            cell.append_attribute("y") = square->GetRow() + 1;
-            if (square->IsMissing())
-            {
-                cell.append_attribute("type") = "void";
-            }
-            else if (square->IsBlack() && !square->IsAnnotation())
-            {
-                cell.append_attribute("type") = "block";
-                if (square->HasColor())
-                    cell.append_attribute("background-color") =
-                        encode_utf8(square->GetHtmlColor()).c_str();
-            }
-            else
-            {
-                if (square->IsAnnotation())
-                    cell.append_attribute("type") = "clue";
-                if (grid.HasSolution())
-                    cell.append_attribute("solution") =
-                        encode_utf8(square->GetSolution()).c_str();
-                if (square->HasNumber())
-                    cell.append_attribute("number") =
-                        encode_utf8(square->GetNumber()).c_str();
-                if (! square->IsBlank())
-                    cell.append_attribute("solve-state") =
-                        encode_utf8(square->GetText()).c_str();
-                if (square->HasCircle())
-                    cell.append_attribute("background-shape") = "circle";
-                if (square->HasColor())
-                    cell.append_attribute("background-color") =
-                        encode_utf8(square->GetHtmlColor()).c_str();
-                if (square->HasFlag(FLAG_REVEALED))
-                {
-                    cell.append_attribute("solve-status") = "revealed";
-                    cell.append_attribute("hint") = "true";
-                }
-                else if (square->HasFlag(FLAG_PENCIL))
-                    cell.append_attribute("solve-status") = "pencil";
-                // Extra square flags to keep track of incorrect letters
-                // This is nonstandard, but doesn't break Crossword Solver.
-                if (square->HasFlag(FLAG_BLACK))
-                    cell.append_attribute("checked") = "true";
-                if (square->HasFlag(FLAG_X))
-                    cell.append_attribute("incorect") = "true";
-                if (square->HasFlag(FLAG_CORRECT))
-                    cell.append_attribute("correct") = "true";
-            }
-            if (square->HasImage())
-            {
-                xml::node img = cell.append_child("background-picture");
-                img.append_attribute("format") = square->m_imageformat.c_str();
-                std::string encoded = base64_encode(
-                    (const unsigned char *)square->m_imagedata.c_str(),
-                                           square->m_imagedata.length());
-                xml::SetText(img.append_child("encoded-image"), encoded.c_str());
-            }
-            if (! square->m_mark[MARK_TR].empty())
-            {
-                cell.append_attribute("top-right-number") =
-                    encode_utf8(square->m_mark[MARK_TR]).c_str();
-            }
-            if (square->m_bars[BAR_TOP])
-                cell.append_attribute("top-bar") = "true";
-            if (square->m_bars[BAR_LEFT])
-                cell.append_attribute("left-bar") = "true";
-            if (square->m_bars[BAR_RIGHT])
-                cell.append_attribute("right-bar") = "true";
-            if (square->m_bars[BAR_BOTTOM])
-                cell.append_attribute("bottom-bar") = "true";
-        }
-    }
+    for (const Square * square = grid.First(); square; square = square->Next())
+        WriteCell(w, grid, square);
+    w.EndElement(); // grid
 
     // Words
     std::map<const Word *, int> wordMap; // Map words to ids
@@ -243,17 +274,19 @@ void SaveJpz(Puzzle * puz, const std::string & filename, void * /* dummy */)
             for (it = cluelist.begin(); it != cluelist.end(); ++it)
             {
                 Word * word = &it->GetWord();
-                xml::node xmlword = crossword.append_child("word");
-                xmlword.append_attribute("id") = id;
+                w.StartElement("word");
+                w.Attribute("id", id);
                 wordMap[word] = id;
                 ++id;
                 square_iterator it;
                 for (it = word->begin(); it != word->end(); ++it)
                 {
-                    xml::node cell = xmlword.append_child("cells");
-                    cell.append_attribute("x") = it->GetCol() + 1;
-                    cell.append_attribute("y") = it->GetRow() + 1;
+                    w.StartElement("cells");
+                    w.Attribute("x", it->GetCol() + 1);
+                    w.Attribute("y", it->GetRow() + 1);
+                    w.EndElement();
                 }
+                w.EndElement();
             }
         }
     }
@@ -265,31 +298,29 @@ void SaveJpz(Puzzle * puz, const std::string & filename, void * /* dummy */)
         for (clues_it = clues.begin(); clues_it != clues.end(); ++clues_it)
         {
             ClueList & cluelist = clues_it->second;
-            xml::node xmlclues = crossword.append_child("clues");
-            xml::SetInnerXML(xmlclues.append_child("title"),
-                             cluelist.GetTitle());
+            w.StartElement("clues");
+            w.StartElement("title");
+            w.InnerXML(cluelist.GetTitle());
+            w.EndElement();
             ClueList::iterator it;
             for (it = cluelist.begin(); it != cluelist.end(); ++it)
             {
-                xml::node clue = xmlclues.append_child("clue");
-                clue.append_attribute("number") =
-                    encode_utf8(it->GetNumber()).c_str();
-                clue.append_attribute("word") = wordMap[&it->GetWord()];
-                xml::SetInnerXML(clue, it->GetText(), &AppendChildWithSpanWrapping);
+                w.StartElement("clue");
+                w.Attribute("number", it->GetNumber());
+                w.Attribute("word", wordMap[&it->GetWord()]);
+                // When writing mixed content, plain text must be wrapped
+                // in <span> tags.
+                w.InnerXML(it->GetText(), true);
+                w.EndElement();
             }
+            w.EndElement();
         }
     }
 
-    // Save to a zip file.
-    zip::Archive archive(filename);
-    if (! archive)
-        throw FileError(filename);
-    // Open a zip in the archive with the filename part of the path
-    zip::File & file = archive.OpenFile(
-        filename.substr(filename.find_last_of("/\\") + 1));
-    // The XML writer instance
-    xml_zip_writer writer(file);
-    doc.save(writer, "");
+    w.EndElement(); // crossword
+    w.EndElement(); // rectangular-puzzle
+    w.EndElement(); // crossword-compiler-applet
+    w.Finish();
 }
 
 } // namespace puz
@@ -20,37 +20,58 @@
 #include "Puzzle.hpp"
 #include "Checksummer.hpp"
 #include "puzstring.hpp"
-#include "utils/streamwrapper.hpp"
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include "utils/bufferreader.hpp"
+#include "utils/filemap.hpp"
 #include <vector>
 #include <map>
 
 namespace puz {
 
-static void LoadSections(Puzzle * puz, istream_wrapper & f);
+static void LoadPuz(Puzzle * puz, buffer_reader & f);
+static void LoadSections(Puzzle * puz, buffer_reader & f);
 
 void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
 {
-    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
-    if (stream.fail())
+    file_map file;
+    if (! file.Open(filename))
         throw FileError(filename);
-    istream_wrapper f(stream);
+    buffer_reader f(file.data(), file.size());
+    LoadPuz(puz, f);
+}
+
+void LoadPuzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    buffer_reader f(data, length);
+    LoadPuz(puz, f);
+}
 
+int ProbePuz(const char * data, size_t length)
+{
+    // The magic string comes after the primary checksum
+    if (length >= 14 && memcmp(data + 2, "ACROSS&DOWN", 12) == 0)
+        return 100;
+    return 0;
+}
+
+// Reading past the end of the file sets f.Fail(), which is checked after
+// each part of the file.
+void LoadPuz(Puzzle * puz, buffer_reader & f)
+{
     const unsigned short c_primary = f.ReadShort();
     (void) c_primary; // unused
-    if (strcmp(f.ReadString(12).c_str(), "ACROSS&DOWN") != 0)
+    const byte_span magic = f.Read(12);
+    if (f.Fail() || memcmp(magic.data(), "ACROSS&DOWN", 12) != 0)
         throw FileTypeError("puz");
 
     const unsigned short c_cib = f.ReadShort();
     (void) c_cib; // unused
-    unsigned char c_masked[8];
-    f.ReadCharArray(c_masked, 8);
+    f.Skip(8); // Masked checksums
 
     // Version is "[major].[minor]\0"
     // We can read puzzles of 1.[anything] or 2.[anything]
-    std::string versionstr = f.ReadString(4);
+    const byte_span versionstr = f.Read(4);
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
     if (! isdigit(versionstr[0]) || ! isdigit(versionstr[2]) || versionstr[0] > '2')
         throw LoadError("Unknown puz version.");
 
@@ -73,18 +94,20 @@ void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
     const unsigned short grid_type = f.ReadShort();
     const unsigned short grid_flag = f.ReadShort();
 
+    // Read user text and solution
+    const byte_span solution = f.Read(width * height);
+    const byte_span text     = f.Read(width * height);
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+
     puz->GetGrid().SetCksum(c_grid);
     puz->GetGrid().SetType(grid_type);
     puz->GetGrid().SetFlag(grid_flag);
     puz->GetGrid().SetSize(width, height);
 
-    // Read user text and solution
-    std::string solution = f.ReadString(width * height);
-    std::string text     = f.ReadString(width * height);
-
     // Set the grid's solution and text
-    std::string::iterator sol_it  = solution.begin();
-    std::string::iterator text_it = text.begin();
+    const char * sol_it  = solution.begin();
+    const char * text_it = text.begin();
     for (Square * square = puz->GetGrid().First();
          square != NULL;
          square = square->Next())
@@ -94,8 +117,10 @@ void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
             square->SetSolution(puz::Square::Black);
         else if (*sol_it == '-')
             square->SetSolution(puz::Square::Blank);
+        else if (static_cast<unsigned char>(*sol_it) < 128)
+            square->SetSolution(static_cast<char_t>(*sol_it));
         else
-            square->SetSolution(decode_puz(std::string(1, *sol_it)));
+            square->SetSolution(decode_puz(sol_it, 1));
         ++sol_it;
 
         // Text
@@ -113,7 +138,10 @@ void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
         }
         else
         {
-            square->SetText(decode_puz(std::string(1, *text_it)));
+            if (static_cast<unsigned char>(*text_it) < 128)
+                square->SetText(static_cast<char_t>(*text_it));
+            else
+                square->SetText(decode_puz(text_it, 1));
             if (islower(*text_it))
                 square->AddFlag(FLAG_PENCIL);
         }
@@ -123,37 +151,29 @@ void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
     puz->NumberGrid();
 
     // General puzzle info
-    puz->SetTitle(decode_text(f.ReadString()));
-    puz->SetAuthor(decode_text(f.ReadString()));
-    puz->SetCopyright(decode_text(f.ReadString()));
+    puz->SetTitle(decode_text(f.ReadString().str()));
+    puz->SetAuthor(decode_text(f.ReadString().str()));
+    puz->SetCopyright(decode_text(f.ReadString().str()));
 
     // Clues
     std::vector<string_t> clues;
     clues.reserve(num_clues);
     // Save unaltered clues for the checksums
-    std::vector<std::string> cksum_clues;
-    cksum_clues.reserve(num_clues);
     for (size_t i = 0; i < num_clues; ++i)
-    {
-        cksum_clues.push_back(f.ReadString());
-        clues.push_back(decode_text(cksum_clues.back()));
-    }
-
-    puz->SetAllClues(clues);
+        clues.push_back(decode_text(f.ReadString().str()));
 
     // Notes
-    std::string notes = f.ReadString();
-    puz->SetNotes(decode_text(notes));
+    const byte_span notes = f.ReadString();
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+
+    puz->SetAllClues(clues);
+    puz->SetNotes(decode_text(notes.str()));
 
     puz->SetOk(true);
 
-    // Try to load the extra sections (i.e. GEXT, LTIM, etc).
-    try {
-        LoadSections(puz, f);
-    }
-    catch (std::ios::failure &) {
-        // EOF here doesn't matter.
-    }
+    // Load the extra sections (i.e. GEXT, LTIM, etc).
+    LoadSections(puz, f);
 
 
     // Don't even bother with the checksums, since we check the validity
@@ -165,19 +185,19 @@ void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
 // Load the sections
 //------------------------------------------------------------------------------
 
-static bool LoadGEXT(Puzzle * puz, const std::string & data);
+static bool LoadGEXT(Puzzle * puz, const byte_span & data);
 static void UnLoadGEXT(Puzzle * puz);
-static bool LoadMETA(Puzzle * puz, const std::string & data);
+static bool LoadMETA(Puzzle * puz, const byte_span & data);
 static void UnLoadMETA(Puzzle * puz);
-static bool LoadCHKD(Puzzle * puz, const std::string & data);
+static bool LoadCHKD(Puzzle * puz, const byte_span & data);
 static void UnLoadCHKD(Puzzle * puz);
-static bool LoadLTIM(Puzzle * puz, const std::string & data);
+static bool LoadLTIM(Puzzle * puz, const byte_span & data);
 static void UnLoadLTIM(Puzzle * puz);
-static bool LoadRUSR(Puzzle * puz, const std::string & data);
+static bool LoadRUSR(Puzzle * puz, const byte_span & data);
 static void UnLoadRUSR(Puzzle * puz);
 static bool LoadSolutionRebus(Puzzle * puz,
-                              const std::string & table,
-                              const std::string & grid);
+                              const byte_span & table,
+                              const byte_span & grid);
 static void UnLoadSolutionRebus(Puzzle * puz);
 
 #define LOAD_SECTION(name)                              \
@@ -187,45 +207,39 @@ static void UnLoadSolutionRebus(Puzzle * puz);
             UnLoad##name(puz);                          \
     sections.erase(#name);
 
-void LoadSections(Puzzle * puz, istream_wrapper & f)
+void LoadSections(Puzzle * puz, buffer_reader & f)
 {
-    std::map<std::string, std::string> sections;
+    // Sections refer to the file's data
+    std::map<std::string, byte_span> sections;
 
-    std::string title;
     // Read all the sections
     // If an error occurs while reading a section, skip
     // that section.
-    for (;;)
+    while (! f.Eof())
     {
         // An extra section is defined as:
         // Title (4 chars)
         // Section length   (le-short)
         // Section checksum (le-short)
-
-        try {
-            title = f.ReadString(4);
-        } catch (std::ios::failure &) {
-            break;
-        }
-
+        const byte_span title = f.Read(4);
         unsigned short length = f.ReadShort();
         unsigned short c_section = f.ReadShort();
 
-        std::string data = f.ReadString(length);
+        const byte_span data = f.Read(length);
 
         // Check the nul-terminator
-        if (f.ReadChar() != 0)
+        if (f.ReadChar() != 0 || f.Fail())
             break; // Don't throw an error
 
         // Test the checksum
-        if (c_section != Checksummer::cksum_region(data, 0))
+        if (c_section != Checksummer::cksum_region(data.data(), data.size(), 0))
             continue; // Skip this section.
 
-        sections[title] = data;
+        sections[title.str()] = data;
     }
 
     // Fill in the puzzle data
-    std::string data;
+    byte_span data;
 
     LOAD_SECTION(GEXT)
     LOAD_SECTION(META)
@@ -234,7 +248,7 @@ void LoadSections(Puzzle * puz, istream_wrapper & f)
     LOAD_SECTION(RUSR)
 
     // Solution rebus needs RTBL and GRBS
-    std::string table = sections["RTBL"];
+    byte_span table = sections["RTBL"];
     data = sections["GRBS"];
     if (! data.empty() && ! table.empty())
     {
@@ -252,9 +266,10 @@ void LoadSections(Puzzle * puz, istream_wrapper & f)
     // If an exception is thrown, Puzzle::LoadPuzzle will clean up this pointer
     PuzData * extra = new PuzData;
     puz->SetFormatData(extra);
-    std::map<std::string, std::string>::iterator it;
+    std::map<std::string, byte_span>::iterator it;
     for (it = sections.begin(); it != sections.end(); ++it)
-        extra->extraSections.push_back(*it);
+        extra->extraSections.push_back(
+            std::make_pair(it->first, it->second.str()));
 }
 
 #undef LOAD_SECTION
@@ -264,10 +279,9 @@ void LoadSections(Puzzle * puz, istream_wrapper & f)
 // GEXT (square flags)
 //------------------------------------------------------------------------------
 
-bool LoadGEXT(Puzzle * puz, const std::string & data)
+bool LoadGEXT(Puzzle * puz, const byte_span & data)
 {
-    std::istringstream stream(data);
-    istream_wrapper f(stream);
+    buffer_reader f(data);
 
     for (Square * square = puz->GetGrid().First();
          square != NULL;
@@ -275,9 +289,7 @@ bool LoadGEXT(Puzzle * puz, const std::string & data)
     {
         square->SetFlag(f.ReadChar());
     }
-    if (! f.CheckEof())
-        return false;
-    return true;
+    return f.Eof() && ! f.Fail();
 }
 
 // Rollback changes
@@ -295,13 +307,19 @@ void UnLoadGEXT(Puzzle * puz)
 // META (additional metadata) // This is my own extension
 //------------------------------------------------------------------------------
 
-bool LoadMETA(Puzzle * puz, const std::string & data)
+bool LoadMETA(Puzzle * puz, const byte_span & data)
 {
-    std::istringstream stream(data);
-    istream_wrapper f(stream);
+    buffer_reader f(data);
 
-    while (! f.CheckEof())
-        puz->SetMeta(decode_utf8(f.ReadString()), decode_utf8(f.ReadString()));
+    while (! f.Eof())
+    {
+        const byte_span name = f.ReadString();
+        const byte_span value = f.ReadString();
+        if (f.Fail())
+            return false;
+        puz->SetMeta(decode_utf8(name.data(), name.size()),
+                     decode_utf8(value.data(), value.size()));
+    }
     return true;
 }
 
@@ -316,10 +334,9 @@ void UnLoadMETA(Puzzle * puz)
 // CHKD (correct squares) // This is my own extension
 //------------------------------------------------------------------------------
 
-bool LoadCHKD(Puzzle * puz, const std::string & data)
+bool LoadCHKD(Puzzle * puz, const byte_span & data)
 {
-    std::istringstream stream(data);
-    istream_wrapper f(stream);
+    buffer_reader f(data);
 
     for (Square * square = puz->GetGrid().First();
          square != NULL;
@@ -328,9 +345,7 @@ bool LoadCHKD(Puzzle * puz, const std::string & data)
         if (f.ReadChar() != 0)
             square->AddFlag(FLAG_CORRECT);
     }
-    if (! f.CheckEof())
-        return false;
-    return true;
+    return f.Eof() && ! f.Fail();
 }
 
 // Rollback changes
@@ -348,19 +363,20 @@ void UnLoadCHKD(Puzzle * puz)
 // LTIM (timer)
 //------------------------------------------------------------------------------
 
-bool LoadLTIM(Puzzle * puz, const std::string & data)
+bool LoadLTIM(Puzzle * puz, const byte_span & data)
 {
-    std::istringstream stream(data);
-    istream_wrapper f(stream);
+    buffer_reader f(data);
 
     // Split the string at the ','
-    const std::string timestring = f.ReadString(',');
+    const std::string timestring = f.ReadString(',').str();
+    if (f.Fail())
+        return false;
 
     int time = atoi(timestring.c_str());
     if (time == 0 && ! timestring.empty() && timestring[0] != '0')
         return false;
 
-    const std::string runningstring = f.ReadString(-1);
+    const std::string runningstring = f.ReadRest().str();
     int isTimerRunning = atoi(runningstring.c_str());
     if (isTimerRunning == 0 && ! runningstring.empty() && runningstring[0] != '0')
         return false;
@@ -381,29 +397,28 @@ void UnLoadLTIM(Puzzle * puz)
 //------------------------------------------------------------------------------
 // RUSR (user rebus grid)
 //------------------------------------------------------------------------------
-bool LoadRUSR(Puzzle * puz, const std::string & data)
+bool LoadRUSR(Puzzle * puz, const byte_span & data)
 {
     // RUSR is a series of strings (each nul-terminated) that represent any
     // user grid rebus entries.  If the rebus is a symbol, it is enclosed
     // in '[' ']'.
 
-    std::istringstream stream(data);
-    istream_wrapper f(stream);
+    buffer_reader f(data);
 
     for (Square * square = puz->GetGrid().First();
          square != NULL;
          square = square->Next())
     {
-        std::string str = f.ReadString();
+        const byte_span str = f.ReadString();
+        if (f.Fail())
+            return false;
 
         if (str.empty())
             continue;
 
-        square->SetText(decode_puz(str));
+        square->SetText(decode_puz(str.data(), str.size()));
     }
-    if (! f.CheckEof())
-        return false;
-    return true;
+    return f.Eof();
 }
 
 void UnLoadRUSR(Puzzle * puz)
@@ -418,8 +433,8 @@ void UnLoadRUSR(Puzzle * puz)
 //------------------------------------------------------------------------------
 
 bool LoadSolutionRebus(Puzzle * puz,
-                       const std::string & table,
-                       const std::string & grid)
+                       const byte_span & table,
+                       const byte_span & grid)
 {
     // NB: In the grid rebus section (GRBS), the index is 1 greater than the
     // index in the rebus table section (RTBL).
@@ -432,20 +447,14 @@ bool LoadSolutionRebus(Puzzle * puz,
     //   - Index is a number, padded to two digits with a space if needed.
     std::map<unsigned char, std::string> rebusTable;
 
-    std::istringstream tstream(table);
-    istream_wrapper table_stream(tstream);
+    buffer_reader table_stream(table);
 
-    for (;;)
+    while (! table_stream.Eof())
     {
-        std::string key;
-
         // Read the index
-        try {
-            key = table_stream.ReadString(':');
-        }
-        catch(std::ios::failure &) {
+        const std::string key = table_stream.ReadString(':').str();
+        if (table_stream.Fail())
             break;
-        }
 
         int index = atoi(key.c_str());
         if (index == 0 && key != " 0")
@@ -455,17 +464,16 @@ bool LoadSolutionRebus(Puzzle * puz,
         // index in the grid-rebus, so we need add 1 here.
         ++index;
 
-        std::string value = table_stream.ReadString(';');
+        std::string value = table_stream.ReadString(';').str();
+        if (table_stream.Fail())
+            return false;
 
         rebusTable[static_cast<unsigned char>(index)] = value;
     }
-    if (! table_stream.CheckEof())
-        return false;
 
 
     // Set the grid rebus solution
-    std::istringstream gstream(grid);
-    istream_wrapper grid_stream(gstream);
+    buffer_reader grid_stream(grid);
 
     for (Square * square = puz->GetGrid().First();
          square != NULL;
@@ -484,9 +492,7 @@ bool LoadSolutionRebus(Puzzle * puz,
             square->SetSolutionRebus(decode_puz(it->second));
         }
     }
-    if (! grid_stream.CheckEof())
-        return false;
-    return true;
+    return grid_stream.Eof() && ! grid_stream.Fail();
 }
 
 void UnLoadSolutionRebus(Puzzle * puz)
@@ -19,6 +19,7 @@
 #define PUZ_FORMATS_PUZ_H
 
 #include "Puzzle.hpp"
+#include "Scan.hpp"
 #include <vector>
 #include <utility>
 #include <string>
@@ -32,6 +33,10 @@ public:
 };
 
 void LoadPuz(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadPuzBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbePuz(const char * data, size_t length);
+void ScanPuz(const char * data, size_t length, ScanInfo * info);
+bool TestPuzChecksums(const char * data, size_t length);
 void SavePuz(Puzzle * puz, const std::string & filename, void * /* dummy */);
 
 } // namespace puz
@@ -20,21 +20,26 @@
 #include "Puzzle.hpp"
 #include "puzstring.hpp"
 #include "Checksummer.hpp"
-#include "utils/streamwrapper.hpp"
-#include <iostream>
-#include <fstream>
+#include "utils/bufferwriter.hpp"
+#include "utils/filemap.hpp"
 #include <sstream>
 #include <map>
 
 namespace puz {
 
-static const int SAVE_VERSION = 13;
 static const char * SAVE_VERSION_STRING = "1.3\0";
-
-static const int UTF8_SAVE_VERSION = 20;
 static const char * UTF8_SAVE_VERSION_STRING = "2.0\0";
 
-static void SaveSections(Puzzle * puz, ostream_wrapper & f);
+// Header layout
+static const size_t PRIMARY_OFFSET = 0x00;
+static const size_t CIB_CKSUM_OFFSET = 0x0E;
+static const size_t MASKED_OFFSET = 0x10;
+static const size_t CIB_OFFSET = 0x2C;
+static const size_t HEADER_SIZE = 0x34;
+
+static void WriteString(buffer_writer & f, const std::string & str, bool withNul,
+                        unsigned short * c_primary, unsigned short * c_part);
+static void SaveSections(Puzzle * puz, buffer_writer & f);
 
 void SavePuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
 {
@@ -94,81 +99,173 @@ void SavePuz(Puzzle * puz, const std::string & filename, void * /* dummy */)
         }
     }
 
-    int save_version;
     const char * save_version_string;
     if (uses_utf8)
-    {
-        save_version = UTF8_SAVE_VERSION;
         save_version_string = UTF8_SAVE_VERSION_STRING;
-    }
     else
-    {
-        save_version = SAVE_VERSION;
         save_version_string = SAVE_VERSION_STRING;
-    }
 
-    // Checksums
-    unsigned short c_cib;
-    unsigned short c_primary;
-    unsigned char c_masked[8];
-
-    // This will check to make sure we have no formatted clues or notes.
-    Checksummer cksum(*puz, save_version);
-    cksum.GetChecksums(&c_cib, &c_primary, c_masked);
+    std::string(*encode_text)(const string_t&);
+    if (uses_utf8)
+        encode_text = encode_utf8;
+    else
+        encode_text = encode_puz;
 
-    const std::vector<std::string> & clues = cksum.GetClues();
+    Grid & grid = puz->GetGrid();
+    const size_t area = grid.GetWidth() * grid.GetHeight();
 
-    std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
-    if (stream.fail())
-        throw FileError(filename);
-    ostream_wrapper f(stream);
+    // The whole file is assembled in memory and written at once.  Each
+    // field is checksummed as soon as it is written.
+    buffer_writer f(HEADER_SIZE + area * 4 + 4096);
 
-    // Header
-    f.Write(c_primary);
+    // Header (checksums are filled in at the end)
+    f.Skip(2); // primary checksum
     f.Write("ACROSS&DOWN\0", 12);
-    f.Write(c_cib);
-    f.Write(&c_masked[0], 8);
+    f.Skip(2); // CIB checksum
+    f.Skip(8); // masked checksums
     f.Write(save_version_string, 4);
     f.Skip(2); // 1 unknown short
-    f.Write(puz->GetGrid().GetCksum());
+    f.Write(grid.GetCksum());
     f.Skip(12); // 6 noise shorts
 
     // Puzzle information
-    f.Put(puz->GetGrid().GetWidth());
-    f.Put(puz->GetGrid().GetHeight());
+    // UsesNumberAlgorithm() guarantees one clue per word
+    const unsigned short num_clues =
+        puz->GetClueList(puzT("Across")).size()
+        + puz->GetClueList(puzT("Down")).size();
+    f.Put(grid.GetWidth());
+    f.Put(grid.GetHeight());
+    f.Write(num_clues);
+    f.Write(grid.GetType());
+    f.Write(grid.GetFlag());
+
+    const unsigned short c_cib =
+        Checksummer::cksum_region(f.data() + CIB_OFFSET, 8, 0);
+    unsigned short c_primary = c_cib;
+
+    // Solution
+    size_t start = f.size();
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        if (square->IsSolutionBlack())
+            f.Put(puz->IsDiagramless() ? ':' : '.');
+        else
+            f.Put(square->GetPlainSolution());
+    }
+    const unsigned short c_sol =
+        Checksummer::cksum_region(f.data() + start, area, 0);
+    c_primary = Checksummer::cksum_region(f.data() + start, area, c_primary);
 
-    f.Write(clues.size());
+    // Grid text
+    start = f.size();
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        if (square->IsBlack())
+        {
+            f.Put('.');
+        }
+        else
+        {
+            char plain = square->GetPlainText();
+            f.Put(square->IsBlank() || plain == 0 ? '-' : plain);
+        }
+    }
+    const unsigned short c_grid =
+        Checksummer::cksum_region(f.data() + start, area, 0);
+    c_primary = Checksummer::cksum_region(f.data() + start, area, c_primary);
+
+    // Strings
+    // Everything from here to the end of the notes is covered by both
+    // the primary checksum and the "part" masked checksum.
+    unsigned short c_part = 0;
+    WriteString(f, GetPuzText(puz->GetTitle(), encode_text), true,
+                &c_primary, &c_part);
+    WriteString(f, GetPuzText(puz->GetAuthor(), encode_text), true,
+                &c_primary, &c_part);
+    WriteString(f, GetPuzText(puz->GetCopyright(), encode_text), true,
+                &c_primary, &c_part);
+
+    // Clues in grid order
+    ClueList::const_iterator across = puz->GetClueList(puzT("Across")).begin();
+    ClueList::const_iterator down   = puz->GetClueList(puzT("Down")).begin();
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        if (square->SolutionWantsClue(ACROSS))
+        {
+            WriteString(f, GetPuzText(across->GetText(), encode_text), false,
+                        &c_primary, &c_part);
+            ++across;
+        }
+        if (square->SolutionWantsClue(DOWN))
+        {
+            WriteString(f, GetPuzText(down->GetText(), encode_text), false,
+                        &c_primary, &c_part);
+            ++down;
+        }
+    }
 
-    f.Write(puz->GetGrid().GetType());
-    f.Write(puz->GetGrid().GetFlag());
+    WriteString(f, GetPuzNotes(*puz, encode_text), true,
+                &c_primary, &c_part);
 
-    // Puzzle data, as already calculated by Checksummer
-    f.Write(cksum.GetSolution());
-    f.Write(cksum.GetGridText());
-    f.WriteNulTerminated(cksum.GetTitle());
-    f.WriteNulTerminated(cksum.GetAuthor());
-    f.WriteNulTerminated(cksum.GetCopyright());
+    // Fill in the header
+    unsigned char c_masked[8];
+    // le-low bits
+    c_masked[0] = 'I' ^ (c_cib & 0x00ff);
+    c_masked[1] = 'C' ^ (c_sol & 0x00ff);
+    c_masked[2] = 'H' ^ (c_grid & 0x00ff);
+    c_masked[3] = 'E' ^ (c_part & 0x00ff);
+    // le-high bits
+    c_masked[4] = 'A' ^ ((c_cib & 0xff00) >> 8);
+    c_masked[5] = 'T' ^ ((c_sol & 0xff00) >> 8);
+    c_masked[6] = 'E' ^ ((c_grid & 0xff00) >> 8);
+    c_masked[7] = 'D' ^ ((c_part & 0xff00) >> 8);
+
+    f.WriteAt(PRIMARY_OFFSET, c_primary);
+    f.WriteAt(CIB_CKSUM_OFFSET, c_cib);
+    f.WriteAt(MASKED_OFFSET, c_masked, 8);
+
+    SaveSections(puz, f);
 
-    std::vector<std::string>::const_iterator it;
-    for (it = clues.begin(); it != clues.end(); ++it)
-        f.WriteNulTerminated(*it);
+    if (! WriteWholeFile(filename, f.data(), f.size()))
+        throw FileError(filename);
+}
 
-    f.WriteNulTerminated(cksum.GetNotes());
 
-    SaveSections(puz, f);
+// Write a NUL-terminated string, and add it to the checksums.
+// Clues are checksummed without the NUL; other strings are checksummed
+// with the NUL, but only if they are not empty.
+void WriteString(buffer_writer & f, const std::string & str, bool withNul,
+                 unsigned short * c_primary, unsigned short * c_part)
+{
+    const size_t start = f.size();
+    f.WriteNulTerminated(str);
+    size_t length = str.size();
+    if (withNul)
+    {
+        if (str.empty())
+            return;
+        ++length;
+    }
+    *c_primary = Checksummer::cksum_region(f.data() + start, length, *c_primary);
+    *c_part = Checksummer::cksum_region(f.data() + start, length, *c_part);
 }
 
 
-static void WriteGEXT(Puzzle * puz, ostream_wrapper & f);
-static void WriteCHKD(Puzzle * puz, ostream_wrapper & f);
-static void WriteLTIM(Puzzle * puz, ostream_wrapper & f);
-static void WriteRUSR(Puzzle * puz, ostream_wrapper & f);
-static void WriteSolutionRebus(Puzzle * puz, ostream_wrapper & f);
-static void WriteSection(ostream_wrapper & f,
-                         const std::string & name,
-                         const std::string & data);
+static void WriteGEXT(Puzzle * puz, buffer_writer & f);
+static void WriteCHKD(Puzzle * puz, buffer_writer & f);
+static void WriteLTIM(Puzzle * puz, buffer_writer & f);
+static void WriteRUSR(Puzzle * puz, buffer_writer & f);
+static void WriteSolutionRebus(Puzzle * puz, buffer_writer & f);
+static size_t BeginSection(buffer_writer & f, const std::string & name);
+static void EndSection(buffer_writer & f, size_t start);
 
-void SaveSections(Puzzle * puz, ostream_wrapper & f)
+void SaveSections(Puzzle * puz, buffer_writer & f)
 {
     WriteGEXT(puz, f);
     WriteCHKD(puz, f);
@@ -185,27 +282,38 @@ void SaveSections(Puzzle * puz, ostream_wrapper & f)
              it != data->extraSections.end();
              ++it)
         {
-            WriteSection(f, it->first, it->second);
+            const size_t start = BeginSection(f, it->first);
+            f.Write(it->second);
+            EndSection(f, start);
         }
     }
 }
 
 
-void WriteSection(ostream_wrapper & f,
-                  const std::string & name,
-                  const std::string & data)
+// Sections are written in place: BeginSection writes the name and leaves
+// room for the length and checksum, which EndSection fills in once the
+// data has been written.  A section can be dropped with f.Truncate(start).
+size_t BeginSection(buffer_writer & f, const std::string & name)
 {
+    const size_t start = f.size();
     f.Write(name);
-    f.Write(data.size());
-    f.Write(Checksummer::cksum_region(data, 0));
-    f.WriteNulTerminated(data);
+    f.Skip(4); // length and checksum
+    return start;
+}
+
+void EndSection(buffer_writer & f, size_t start)
+{
+    const size_t data = start + 8;
+    const size_t length = f.size() - data;
+    f.WriteAt(start + 4, static_cast<unsigned short>(length));
+    f.WriteAt(start + 6, Checksummer::cksum_region(f.data() + data, length, 0));
+    f.Put(0);
 }
 
 
-void WriteGEXT(Puzzle * puz, ostream_wrapper & f)
+void WriteGEXT(Puzzle * puz, buffer_writer & f)
 {
-    std::string data;
-    data.reserve(puz->GetGrid().GetWidth() * puz->GetGrid().GetHeight());
+    const size_t start = BeginSection(f, "GEXT");
     bool hasData = false;
 
     for (Square * square = puz->GetGrid().First();
@@ -213,21 +321,22 @@ void WriteGEXT(Puzzle * puz, ostream_wrapper & f)
          square = square->Next())
     {
         const char flag = square->GetFlag() & ACROSS_LITE_MASK;
-        data.push_back(flag);
+        f.Put(flag);
         if (! hasData && flag != 0)
             hasData = true;
     }
     if (hasData)
-        WriteSection(f, "GEXT", data);
+        EndSection(f, start);
+    else
+        f.Truncate(start);
 }
 
 
 
-void WriteCHKD(Puzzle * puz, ostream_wrapper & f)
+void WriteCHKD(Puzzle * puz, buffer_writer & f)
 {
     // Checked square data
-    std::string data;
-    data.reserve(puz->GetGrid().GetWidth() * puz->GetGrid().GetHeight());
+    const size_t start = BeginSection(f, "CHKD");
     bool hasData = false;
 
     for (Square * square = puz->GetGrid().First();
@@ -235,29 +344,33 @@ void WriteCHKD(Puzzle * puz, ostream_wrapper & f)
          square = square->Next())
     {
         const bool correct = square->HasFlag(FLAG_CORRECT);
-        data.push_back(correct ? 1 : 0);
+        f.Put(correct ? 1 : 0);
         if (! hasData && correct)
             hasData = true;
     }
     if (hasData)
-        WriteSection(f, "CHKD", data);
+        EndSection(f, start);
+    else
+        f.Truncate(start);
 }
 
 
 
-void WriteLTIM(Puzzle * puz, ostream_wrapper & f)
+void WriteLTIM(Puzzle * puz, buffer_writer & f)
 {
     if (puz->GetTime() == 0 && ! puz->IsTimerRunning())
         return;
     std::ostringstream data;
     data << puz->GetTime() << "," << (puz->IsTimerRunning() ? 0 : 1);
-    WriteSection(f, "LTIM", data.str());
+    const size_t start = BeginSection(f, "LTIM");
+    f.Write(data.str());
+    EndSection(f, start);
 }
 
 
-void WriteRUSR(Puzzle * puz, ostream_wrapper & f)
+void WriteRUSR(Puzzle * puz, buffer_writer & f)
 {
-    std::string data;
+    const size_t start = BeginSection(f, "RUSR");
     bool hasData = false;
 
     for (Square * square = puz->GetGrid().First();
@@ -266,22 +379,23 @@ void WriteRUSR(Puzzle * puz, ostream_wrapper & f)
     {
         if (square->HasTextRebus())
         {
-            data.append(encode_puz(square->GetText()));
+            f.Write(encode_puz(square->GetText()));
             if (! hasData)
                 hasData = true;
         }
-        data.push_back('\0');
+        f.Put(0);
     }
     if (hasData)
-        WriteSection(f, "RUSR", data);
+        EndSection(f, start);
+    else
+        f.Truncate(start);
 }
 
 
 
-void WriteSolutionRebus(Puzzle * puz, ostream_wrapper & f)
+void WriteSolutionRebus(Puzzle * puz, buffer_writer & f)
 {
     std::map<string_t, unsigned char> tableMap;
-    std::string rebus;
     std::ostringstream table; // Write this as we go
     bool rebusHasData = false;
     bool tableHasData = false;
@@ -295,14 +409,15 @@ void WriteSolutionRebus(Puzzle * puz, ostream_wrapper & f)
     unsigned char index = 1;
 
 
-    // Assemble the grid rebus string
+    // Write the grid rebus section
+    const size_t start = BeginSection(f, "GRBS");
     for (Square * square = puz->GetGrid().First();
          square != NULL;
          square = square->Next())
     {
         if (! square->HasSolutionRebus())
         {
-            rebus.push_back(0);
+            f.Put(0);
             continue;
         }
 
@@ -315,13 +430,13 @@ void WriteSolutionRebus(Puzzle * puz, ostream_wrapper & f)
 
         if (table_it != tableMap.end())
         {
-            rebus.push_back(table_it->second);
+            f.Put(table_it->second);
         }
         else // We need to add this entry to the map
         {
             // The grid-rebus section adds 1 for every index
             tableMap[square->GetSolution()] = index + 1;
-            rebus.push_back(index + 1);
+            f.Put(index + 1);
 
             if (! tableHasData)
                 tableHasData = true;
@@ -341,8 +456,14 @@ void WriteSolutionRebus(Puzzle * puz, ostream_wrapper & f)
 
     if (rebusHasData && tableHasData)
     {
-        WriteSection(f, "GRBS", rebus);
-        WriteSection(f, "RTBL", table.str());
+        EndSection(f, start);
+        const size_t table_start = BeginSection(f, "RTBL");
+        f.Write(table.str());
+        EndSection(f, table_start);
+    }
+    else
+    {
+        f.Truncate(start);
     }
 }
 
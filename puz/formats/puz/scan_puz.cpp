@@ -0,0 +1,176 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "puz.hpp"
+
+#include "Square.hpp"
+#include "Checksummer.hpp"
+#include "puzstring.hpp"
+#include "utils/bufferreader.hpp"
+#include <cstdlib>
+#include <cctype>
+
+namespace puz {
+
+// The file layout is the same as in load_puz.cpp, but only the parts
+// needed for ScanInfo are read.
+void ScanPuz(const char * data, size_t length, ScanInfo * info)
+{
+    buffer_reader f(data, length);
+    f.Skip(2); // Primary checksum
+    const byte_span magic = f.Read(12);
+    if (f.Fail() || memcmp(magic.data(), "ACROSS&DOWN", 12) != 0)
+        throw FileTypeError("puz");
+    f.Skip(2 + 8); // CIB and masked checksums
+
+    const byte_span versionstr = f.Read(4);
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+    if (! isdigit(versionstr[0]) || ! isdigit(versionstr[2]) || versionstr[0] > '2')
+        throw LoadError("Unknown puz version.");
+    string_t(*decode_text)(const std::string&);
+    if (versionstr[0] >= '2')
+        decode_text = decode_utf8;
+    else
+        decode_text = decode_puz;
+
+    f.Skip(2 + 2 + 2 * 6); // Unknown, grid checksum, noise
+
+    info->width  = f.ReadChar();
+    info->height = f.ReadChar();
+    const unsigned short num_clues = f.ReadShort();
+    info->type = f.ReadShort();
+    info->flag = f.ReadShort();
+
+    const size_t area = info->width * info->height;
+    const byte_span solution = f.Read(area);
+    const byte_span text     = f.Read(area);
+
+    // Same as Puzzle::GetTitle() and GetAuthor()
+    info->title  = escape_xml(decode_text(f.ReadString().str()));
+    info->author = escape_xml(decode_text(f.ReadString().str()));
+    f.ReadString(); // Copyright
+    for (size_t i = 0; i < num_clues; ++i)
+        f.ReadString();
+    f.ReadString(); // Notes
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+
+    // Sections: only GEXT (for checked squares) and LTIM are needed
+    byte_span gext;
+    while (! f.Eof())
+    {
+        const byte_span title = f.Read(4);
+        const unsigned short length = f.ReadShort();
+        const unsigned short c_section = f.ReadShort();
+        const byte_span data = f.Read(length);
+        if (f.ReadChar() != 0 || f.Fail())
+            break;
+        if (memcmp(title.data(), "GEXT", 4) == 0)
+        {
+            if (data.size() == area
+                && c_section == Checksummer::cksum_region(data.data(), data.size(), 0))
+            {
+                gext = data;
+            }
+        }
+        else if (memcmp(title.data(), "LTIM", 4) == 0)
+        {
+            if (c_section != Checksummer::cksum_region(data.data(), data.size(), 0))
+                continue;
+            // "[time],[0 if running]"
+            const std::string timer = data.str();
+            const size_t comma = timer.find(',');
+            if (comma == std::string::npos)
+                continue;
+            info->time = atoi(timer.c_str());
+            info->isTimerRunning = atoi(timer.c_str() + comma + 1) == 0;
+        }
+    }
+
+    // Progress
+    for (size_t i = 0; i < area; ++i)
+    {
+        const char sol = solution[i];
+        if (sol == '.' || sol == ':')
+            continue;
+        ++info->white;
+        const char entry = text[i];
+        if (entry != '-' && entry != '\0' && entry != ':')
+            ++info->filled;
+        else if (sol != '-')
+        {
+            ++info->blank;
+            if (! gext.empty()
+                && (gext[i] & (FLAG_X | FLAG_REVEALED | FLAG_BLACK)) != 0)
+            {
+                ++info->marked;
+            }
+        }
+    }
+}
+
+// Checksum the strings as they appear in the file, instead of as they
+// would be saved from a loaded Puzzle.
+bool TestPuzChecksums(const char * data, size_t length)
+{
+    buffer_reader f(data, length);
+    const unsigned short c_primary = f.ReadShort();
+    const byte_span magic = f.Read(12);
+    if (f.Fail() || memcmp(magic.data(), "ACROSS&DOWN", 12) != 0)
+        throw FileTypeError("puz");
+    const unsigned short c_cib = f.ReadShort();
+    const byte_span masked = f.Read(8);
+
+    const byte_span versionstr = f.Read(4);
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+    if (! isdigit(versionstr[0]) || ! isdigit(versionstr[2]))
+        throw LoadError("Unknown puz version.");
+    f.Skip(2 + 2 + 2 * 6); // Unknown, grid checksum, noise
+
+    Checksummer cksum;
+    cksum.SetVersion((versionstr[0] - '0') * 10 + (versionstr[2] - '0'));
+    const unsigned char width  = f.ReadChar();
+    const unsigned char height = f.ReadChar();
+    const unsigned short num_clues = f.ReadShort();
+    cksum.SetWidth(width);
+    cksum.SetHeight(height);
+    cksum.SetGridType(f.ReadShort());
+    cksum.SetGridFlag(f.ReadShort());
+
+    const size_t area = width * height;
+    cksum.SetSolution(f.Read(area).str());
+    cksum.SetGridText(f.Read(area).str());
+    cksum.SetTitle(f.ReadString().str());
+    cksum.SetAuthor(f.ReadString().str());
+    cksum.SetCopyright(f.ReadString().str());
+    std::vector<std::string> clues;
+    clues.reserve(num_clues);
+    for (size_t i = 0; i < num_clues; ++i)
+        clues.push_back(f.ReadString().str());
+    cksum.SetClues(clues);
+    cksum.SetNotes(f.ReadString().str());
+    if (f.Fail())
+        throw LoadError("Unexpected end of file");
+
+    return cksum.TestChecksums(
+        c_cib, c_primary, reinterpret_cast<const unsigned char *>(masked.data()));
+}
+
+} // namespace puz
@@ -20,25 +20,54 @@
 #include "Puzzle.hpp"
 #include "puzstring.hpp"
 #include "utils/streamwrapper.hpp"
+#include "utils/memorystream.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <map>
+#include <cstring>
 
 namespace puz {
 
+static void LoadTxt(Puzzle * puz, std::istream & stream);
+
 void LoadTxt(Puzzle * puz, const std::string & filename, void * /* dummy */)
 {
     std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
     if (stream.fail())
         throw FileError(filename);
-    istream_wrapper f(stream);
+    LoadTxt(puz, stream);
+}
+
+void LoadTxtBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    memory_istream stream(data, length);
+    LoadTxt(puz, stream);
+}
+
+int ProbeTxt(const char * data, size_t length)
+{
+    static const char header[] = "<ACROSS PUZZLE";
+    if (length >= sizeof(header) - 1
+        && memcmp(data, header, sizeof(header) - 1) == 0)
+    {
+        return 100;
+    }
+    return 0;
+}
 
-    std::string version = f.ReadLine();
+void LoadTxt(Puzzle * puz, std::istream & stream)
+{
+    // Check the header before istream_wrapper turns on exceptions, so that
+    // a file without any newlines is a FileTypeError, not an EOF error.
+    std::string version;
+    std::getline(stream, version);
     if (version != "<ACROSS PUZZLE>" && version != "<ACROSS PUZZLE V2>")
         throw FileTypeError("txt");
 
+    istream_wrapper f(stream);
+
     if (f.ReadLine() != "<TITLE>")
         throw LoadError("Missing <TITLE>");
     puz->SetTitle(TrimWhitespace(decode_utf8(f.ReadLine())));
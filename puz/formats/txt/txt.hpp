@@ -24,6 +24,8 @@
 namespace puz {
 
 void LoadTxt(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadTxtBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeTxt(const char * data, size_t length);
 
 } // namespace puz
 
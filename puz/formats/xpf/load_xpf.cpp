@@ -41,6 +41,17 @@ void LoadXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
     parser.LoadFromFilename(puz, filename);
 }
 
+void LoadXPFBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    XPFParser parser;
+    parser.LoadFromBuffer(puz, data, length);
+}
+
+int ProbeXPF(const char * data, size_t length)
+{
+    return xml::GetRootName(data, length) == "Puzzles" ? 100 : 0;
+}
+
 inline Square *
 XPFParser::GetSquare(Puzzle * puz, const xml::node & node)
 {
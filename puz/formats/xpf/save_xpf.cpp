@@ -21,9 +21,35 @@
 #include "Clue.hpp"
 #include "puzstring.hpp"
 #include <fstream>
+#include "utils/filemap.hpp"
 
 namespace puz {
 
+// Collects the document in memory, so that nothing is written if the
+// puzzle can't be converted.
+class xml_string_writer
+    : public pugi::xml_writer
+{
+public:
+    xml_string_writer(std::string & str) : m_str(str) {}
+
+    virtual void write(const void* data, size_t size)
+    {
+        m_str.append(static_cast<const char *>(data), size);
+    }
+
+protected:
+    std::string & m_str;
+};
+
+template <typename T>
+static void Append(xml::Writer & w, const char * name, const T & value)
+{
+    w.StartElement(name);
+    w.Text(value);
+    w.EndElement();
+}
+
 //-----------------------------------------------------------------------------
 // SaveXPF
 //-----------------------------------------------------------------------------
@@ -43,41 +69,41 @@ void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
             throw ConversionError("XPF does not support puzzles with background images.");
     }
 
-    xml::document doc;
-    xml::node puzzles = doc.append_child("Puzzles");
-    puzzles.append_attribute("Version") = "1.0";
-    xml::node puzzle = puzzles.append_child("Puzzle");
+    std::string output;
+    xml_string_writer out(output);
+    xml::Writer w(out);
+    w.StartElement("Puzzles");
+    w.Attribute("Version", "1.0");
+    w.StartElement("Puzzle");
     // Metadata
     puz::Puzzle::metamap_t & meta = puz->GetMetadata();
     puz::Puzzle::metamap_t::iterator it;
     for (it = meta.begin(); it != meta.end(); ++it)
     {
         if (it->first == puzT("notes")) // "notes" -> "Notepad"
-            xml::Append(puzzle, "Notepad", it->second);
+            Append(w, "Notepad", it->second);
         else
-            xml::Append(puzzle, xml::CamelCase(it->first).c_str(), it->second);
+            Append(w, xml::CamelCase(it->first).c_str(), it->second);
     }
 
     // Grid
     if (grid.GetType() == TYPE_DIAGRAMLESS)
-        xml::Append(puzzle, "Type", "diagramless");
+        Append(w, "Type", "diagramless");
 
     // Grid Size
-    xml::node size = puzzle.append_child("Size");
-    xml::Append(size, "Rows", puz::ToString(grid.GetHeight()));
-    xml::Append(size, "Cols", puz::ToString(grid.GetWidth()));
+    w.StartElement("Size");
+    Append(w, "Rows", puz::ToString(grid.GetHeight()));
+    Append(w, "Cols", puz::ToString(grid.GetWidth()));
+    w.EndElement();
 
     // Answers
     {
-        xml::node grid_node = puzzle.append_child("Grid");
-        xml::node row;
+        w.StartElement("Grid");
         std::string row_text;
         row_text.reserve(grid.GetWidth());
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
-            if (square->IsFirst(ACROSS))
-                row = grid_node.append_child("Row");
             if (square->IsMissing())
                 row_text.append(1, '~');
             else if (square->IsBlack())
@@ -88,73 +114,74 @@ void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
                 row_text.append(1, square->GetPlainSolution());
             if (square->IsLast(ACROSS))
             {
-                xml::SetText(row, row_text.c_str());
+                Append(w, "Row", row_text);
                 row_text.clear();
             }
         }
+        w.EndElement();
     }
 
     // Circles
     {
-        xml::node circles = puzzle.append_child("Circles");
+        w.StartElement("Circles");
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
             if (square->HasCircle())
             {
-                xml::node circle = circles.append_child("Circle");
-                circle.append_attribute("Row") = square->GetRow() + 1;
-                circle.append_attribute("Col") = square->GetCol() + 1;
+                w.StartElement("Circle");
+                w.Attribute("Row", square->GetRow() + 1);
+                w.Attribute("Col", square->GetCol() + 1);
+                w.EndElement();
             }
         }
-        if (circles.empty())
-            puzzle.remove_child(circles);
+        w.EndElement();
     }
 
     // Rebus
     {
-        xml::node rebus = puzzle.append_child("RebusEntries");
+        w.StartElement("RebusEntries");
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
             if (square->HasSolutionRebus())
             {
-                xml::node entry = rebus.append_child("Rebus");
-                entry.append_attribute("Row") = square->GetRow() + 1;
-                entry.append_attribute("Col") = square->GetCol() + 1;
-                entry.append_attribute("Short") =
-                    std::string(1, square->GetPlainSolution()).c_str();
-                xml::SetText(entry, square->GetSolution());
+                w.StartElement("Rebus");
+                w.Attribute("Row", square->GetRow() + 1);
+                w.Attribute("Col", square->GetCol() + 1);
+                w.Attribute("Short",
+                    std::string(1, square->GetPlainSolution()));
+                w.Text(square->GetSolution());
+                w.EndElement();
             }
         }
-        if (rebus.empty())
-            puzzle.remove_child(rebus);
+        w.EndElement();
     }
 
     // Shades
     {
-        xml::node shades = puzzle.append_child("Shades");
+        w.StartElement("Shades");
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
             if (square->HasColor())
             {
-                xml::node shade = shades.append_child("Shade");
-                shade.append_attribute("Row") = square->GetRow() + 1;
-                shade.append_attribute("Col") = square->GetCol() + 1;
+                w.StartElement("Shade");
+                w.Attribute("Row", square->GetRow() + 1);
+                w.Attribute("Col", square->GetCol() + 1);
                 if (square->HasHighlight())
-                    xml::SetText(shade, "gray");
+                    w.Text("gray");
                 else
-                    xml::SetText(shade, square->GetHtmlColor());
+                    w.Text(square->GetHtmlColor());
+                w.EndElement();
             }
         }
-        if (shades.empty())
-            puzzle.remove_child(shades);
+        w.EndElement();
     }
 
     // Clues
     {
-        xml::node clues_node = puzzle.append_child("Clues");
+        w.StartElement("Clues");
         Clues & clues = puz->GetClues();
         Clues::iterator clues_it;
         for (clues_it = clues.begin(); clues_it != clues.end(); ++clues_it)
@@ -163,7 +190,7 @@ void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
             ClueList::iterator it;
             for (it = cluelist.begin(); it != cluelist.end(); ++it)
             {
-                xml::node clue = clues_node.append_child("Clue");
+                w.StartElement("Clue");
                 // Find the clue direction
                 if (! puz->IsDiagramless())
                 {
@@ -171,52 +198,51 @@ void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
                     switch (word.GetDirection())
                     {
                     case ACROSS:
-                        clue.append_attribute("Dir") = "Across";
+                        w.Attribute("Dir", "Across");
                         break;
                     case DOWN:
-                        clue.append_attribute("Dir") = "Down";
+                        w.Attribute("Dir", "Down");
                         break;
                     case DIAGONAL_SW:
-                        clue.append_attribute("Dir") = "Diagonal";
+                        w.Attribute("Dir", "Diagonal");
                         break;
                     default:
                         throw ConversionError("XPF clues must be Across, Down, or Diagonal");
                         break;
                     }
-                    clue.append_attribute("Row") = word.front()->GetRow() + 1;
-                    clue.append_attribute("Col") = word.front()->GetCol() + 1;
+                    w.Attribute("Row", word.front()->GetRow() + 1);
+                    w.Attribute("Col", word.front()->GetCol() + 1);
                 }
                 else // diagramless
                 {
                     puz::string_t title = cluelist.GetTitle();
                     if (title == puzT("Across"))
-                        clue.append_attribute("Dir") = "Across";
+                        w.Attribute("Dir", "Across");
                     else if (title == puzT("Down"))
-                        clue.append_attribute("Dir") = "Down";
+                        w.Attribute("Dir", "Down");
                     else if (title == puzT("Diagonal"))
-                        clue.append_attribute("Dir") = "Diagonal";
+                        w.Attribute("Dir", "Diagonal");
                     else
                         throw ConversionError("XPF clues must be Across, Down, or Diagonal");
                 }
-                clue.append_attribute("Num") = encode_utf8(it->GetNumber()).c_str();
+                w.Attribute("Num", it->GetNumber());
                 // Clue formatting needs to be escaped if it is XHTML.
-                // xml::SetInnerXML(clue, it->GetText());
-                xml::SetText(clue, it->GetText());
+                // w.InnerXML(it->GetText());
+                w.Text(it->GetText());
+                w.EndElement();
             }
         }
+        w.EndElement();
     }
 
     // User Grid
     {
-        xml::node usergrid = puzzle.append_child("UserGrid");
-        xml::node row;
+        w.StartElement("UserGrid");
         std::string row_text;
         row_text.reserve(grid.GetWidth());
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
-            if (square->IsFirst(ACROSS))
-                row = usergrid.append_child("Row");
             if (square->IsMissing())
                 row_text.append(1, '~');
             else if (square->IsBlack())
@@ -227,73 +253,79 @@ void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */)
                 row_text.append(1, square->GetPlainText());
             if (square->IsLast(ACROSS))
             {
-                xml::SetText(row, row_text.c_str());
+                w.StartElement("Row");
+                w.Text(row_text);
+                w.EndElement();
                 row_text.clear();
             }
         }
-        if (usergrid.empty())
-            puzzle.remove_child(usergrid);
+        w.EndElement();
     }
 
     // User Rebus
     {
-        xml::node rebus = puzzle.append_child("UserRebusEntries");
+        w.StartElement("UserRebusEntries");
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
             if (square->HasTextRebus())
             {
-                xml::node entry = rebus.append_child("Rebus");
-                entry.append_attribute("Row") = square->GetRow() + 1;
-                entry.append_attribute("Col") = square->GetCol() + 1;
-                entry.append_attribute("Short") =
-                    std::string(1, square->GetPlainText()).c_str();
-                xml::SetText(entry, square->GetText());
+                w.StartElement("Rebus");
+                w.Attribute("Row", square->GetRow() + 1);
+                w.Attribute("Col", square->GetCol() + 1);
+                w.Attribute("Short",
+                    std::string(1, square->GetPlainText()));
+                w.Text(square->GetText());
+                w.EndElement();
             }
         }
-        if (rebus.empty())
-            puzzle.remove_child(rebus);
+        w.EndElement();
     }
 
     // Square Flags
     {
-        xml::node flags = puzzle.append_child("SquareFlags");
+        w.StartElement("SquareFlags");
         const Square * square;
         for (square = grid.First(); square; square = square->Next())
         {
             if (square->GetFlag() != 0)
             {
-                xml::node entry = flags.append_child("Flag");
-                entry.append_attribute("Row") = square->GetRow() + 1;
-                entry.append_attribute("Col") = square->GetCol() + 1;
+                w.StartElement("Flag");
+                w.Attribute("Row", square->GetRow() + 1);
+                w.Attribute("Col", square->GetCol() + 1);
                 if (square->HasFlag(FLAG_PENCIL))
-                    entry.append_attribute("Pencil") = "true";
+                    w.Attribute("Pencil", "true");
                 if (square->HasFlag(FLAG_BLACK))
-                    entry.append_attribute("Checked") = "true";
+                    w.Attribute("Checked", "true");
                 if (square->HasFlag(FLAG_REVEALED))
-                    entry.append_attribute("Revealed") = "true";
+                    w.Attribute("Revealed", "true");
                 if (square->HasFlag(FLAG_X))
-                    entry.append_attribute("Incorrect") = "true";
+                    w.Attribute("Incorrect", "true");
                 if (square->HasFlag(FLAG_CORRECT))
-                    entry.append_attribute("Correct") = "true";
+                    w.Attribute("Correct", "true");
+                w.EndElement();
             }
         }
-        if (flags.empty())
-            puzzle.remove_child(flags);
+        w.EndElement();
     }
 
     // Timer
     {
         if (puz->GetTime() != 0)
         {
-            xml::node timer = puzzle.append_child("Timer");
-            timer.append_attribute("Seconds") = puz->GetTime();
+            w.StartElement("Timer");
+            w.Attribute("Seconds", puz->GetTime());
             if (puz->IsTimerRunning())
-                timer.append_attribute("Running") = "true";
+                w.Attribute("Running", "true");
+            w.EndElement();
         }
     }
 
-    doc.save_file(filename.c_str());
+    w.EndElement(); // Puzzle
+    w.EndElement(); // Puzzles
+    w.Finish();
+    if (! WriteWholeFile(filename, output.data(), output.size()))
+        throw FileError(filename);
 }
 
 } // namespace puz
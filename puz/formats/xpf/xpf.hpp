@@ -33,6 +33,8 @@ public:
 };
 
 void LoadXPF(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadXPFBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeXPF(const char * data, size_t length);
 void SaveXPF(Puzzle * puz, const std::string & filename, void * /* dummy */);
 
 } // namespace puz
@@ -0,0 +1,69 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "xwa.hpp"
+#include "Archive.hpp"
+#include <cstring>
+
+namespace puz {
+
+int ProbeXwa(const char * data, size_t length)
+{
+    if (length >= 8 && memcmp(data, "XWARCHV\x1a", 8) == 0)
+        return 100;
+    return 0;
+}
+
+static void LoadLatest(Puzzle * puz, Archive & archive)
+{
+    const ArchiveEntry * entry = archive.GetLatest();
+    if (! entry)
+        throw LoadError("Archive is empty");
+    const char * data = archive.GetData(*entry);
+    // The puzzle is already being loaded, so call the handler for the
+    // puzzle's format directly instead of going through Puzzle::LoadBuffer.
+    const Puzzle::FileHandlerDesc * desc =
+        Puzzle::FindLoadHandler(entry->format);
+    if (! desc || ! desc->bufferHandler)
+        desc = Puzzle::DetectHandler(data, entry->length);
+    if (! desc || ! desc->bufferHandler || desc->bufferHandler == LoadXwaBuffer)
+        throw LoadError("Unknown puzzle format in archive");
+    try {
+        desc->bufferHandler(puz, data, entry->length, desc->data);
+    }
+    catch (FileTypeError & e) {
+        // This is an archive; the puzzle inside it is broken
+        throw LoadError(e.message);
+    }
+}
+
+void LoadXwa(Puzzle * puz, const std::string & filename, void * /* dummy */)
+{
+    Archive archive;
+    archive.Open(filename);
+    LoadLatest(puz, archive);
+}
+
+void LoadXwaBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    Archive archive;
+    archive.OpenBuffer(data, length);
+    LoadLatest(puz, archive);
+}
+
+} // namespace puz
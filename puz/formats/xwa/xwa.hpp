@@ -0,0 +1,35 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_FORMATS_XWA_H
+#define PUZ_FORMATS_XWA_H
+
+#include "Puzzle.hpp"
+#include <string>
+
+namespace puz {
+
+// Loading an archive as a puzzle loads its latest puzzle.
+// Use puz::Archive to load a specific puzzle.
+void LoadXwa(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadXwaBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeXwa(const char * data, size_t length);
+
+} // namespace puz
+
+#endif // PUZ_FORMATS_XWA_H
@@ -0,0 +1,155 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "xws.hpp"
+#include "utils/bufferreader.hpp"
+#include "utils/filemap.hpp"
+#include <cstring>
+#include <vector>
+
+namespace puz {
+
+int ProbeXws(const char * data, size_t length)
+{
+    if (length >= sizeof(XWS_MAGIC)
+        && memcmp(data, XWS_MAGIC, sizeof(XWS_MAGIC)) == 0)
+    {
+        return 100;
+    }
+    return 0;
+}
+
+struct XwsSquare
+{
+    unsigned short flag;
+    byte_span text;
+};
+
+struct XwsSnapshot
+{
+    unsigned short flags;
+    size_t width;
+    size_t height;
+    unsigned int time;
+    unsigned int hash;
+    std::vector<XwsSquare> squares;
+    byte_span puzzle;
+};
+
+// Read the whole snapshot before changing the puzzle, so that a damaged
+// snapshot doesn't leave the puzzle half restored.
+static void ReadXws(const char * data, size_t length, XwsSnapshot & xws)
+{
+    buffer_reader f(data, length);
+    const byte_span magic = f.Read(sizeof(XWS_MAGIC));
+    if (f.Fail() || memcmp(magic.data(), XWS_MAGIC, sizeof(XWS_MAGIC)) != 0)
+        throw FileTypeError("xws");
+    const unsigned short version = f.ReadShort();
+    xws.flags = f.ReadShort();
+    xws.width = f.ReadShort();
+    xws.height = f.ReadShort();
+    xws.time = f.ReadLong();
+    xws.hash = f.ReadLong();
+    if (f.Fail())
+        throw LoadError("Snapshot is truncated");
+    if (version != XWS_VERSION)
+        throw LoadError("Unsupported snapshot version");
+
+    // Each square takes at least 4 bytes
+    const size_t count = xws.width * xws.height;
+    if (count > f.Remaining() / 4)
+        throw LoadError("Snapshot is truncated");
+    xws.squares.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        XwsSquare & square = xws.squares[i];
+        square.flag = f.ReadShort();
+        square.text = f.Read(f.ReadShort());
+    }
+    if (xws.flags & XWS_HAS_PUZZLE)
+        xws.puzzle = f.Read(f.ReadLong());
+    if (f.Fail())
+        throw LoadError("Snapshot is truncated");
+}
+
+static bool RestoreXws(Puzzle * puz, const XwsSnapshot & xws)
+{
+    Grid & grid = puz->GetGrid();
+    if (grid.GetWidth() != xws.width || grid.GetHeight() != xws.height
+        || HashXwsGrid(grid) != xws.hash)
+    {
+        return false;
+    }
+    // Only touch squares that changed, so that the grid's change tracking
+    // sees what the snapshot restored.
+    std::vector<XwsSquare>::const_iterator it = xws.squares.begin();
+    for (Square * square = grid.First(); square != NULL; square = square->Next())
+    {
+        const string_t text = it->text.empty()
+            ? string_t() : decode_utf8(it->text.data(), it->text.size());
+        if (square->GetText() != text)
+            square->SetText(text, false);
+        if (square->GetFlag() != it->flag)
+            square->SetFlag(it->flag, false);
+        ++it;
+    }
+    puz->SetTime(xws.time);
+    puz->SetTimerRunning((xws.flags & XWS_TIMER_RUNNING) != 0);
+    return true;
+}
+
+bool LoadXwsState(Puzzle * puz, const char * data, size_t length)
+{
+    XwsSnapshot xws;
+    ReadXws(data, length, xws);
+    return RestoreXws(puz, xws);
+}
+
+void LoadXwsBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */)
+{
+    XwsSnapshot xws;
+    ReadXws(data, length, xws);
+    if ((xws.flags & XWS_HAS_PUZZLE) == 0)
+        throw LoadError("Snapshot does not include a puzzle");
+    // The puzzle is already being loaded, so call the handler for the
+    // puzzle's format directly instead of going through Puzzle::LoadBuffer.
+    const Puzzle::FileHandlerDesc * desc =
+        Puzzle::DetectHandler(xws.puzzle.data(), xws.puzzle.size());
+    if (! desc || ! desc->bufferHandler || desc->bufferHandler == LoadXwsBuffer)
+        throw LoadError("Unknown puzzle format in snapshot");
+    try {
+        desc->bufferHandler(puz, xws.puzzle.data(), xws.puzzle.size(),
+                            desc->data);
+    }
+    catch (FileTypeError & e) {
+        // This is a snapshot; the puzzle inside it is broken
+        throw LoadError(e.message);
+    }
+    if (! RestoreXws(puz, xws))
+        throw LoadError("Snapshot does not match its puzzle");
+}
+
+void LoadXws(Puzzle * puz, const std::string & filename, void * dummy)
+{
+    file_map file;
+    if (! file.Open(filename))
+        throw FileError(filename);
+    LoadXwsBuffer(puz, file.data(), file.size(), dummy);
+}
+
+} // namespace puz
@@ -0,0 +1,78 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "xws.hpp"
+
+namespace puz {
+
+// FNV-1a
+unsigned int HashXwsGrid(const Grid & grid)
+{
+    unsigned int hash = 2166136261u;
+    const unsigned int prime = 16777619u;
+    hash = (hash ^ (grid.GetWidth() & 0xffff)) * prime;
+    hash = (hash ^ (grid.GetHeight() & 0xffff)) * prime;
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        hash = (hash ^ static_cast<unsigned char>(square->GetPlainSolution()))
+               * prime;
+    }
+    return hash;
+}
+
+void SaveXwsBuffer(const Puzzle & puz, buffer_writer & out,
+                   const char * puzzle, size_t length)
+{
+    const Grid & grid = puz.GetGrid();
+    unsigned short flags = 0;
+    if (puz.IsTimerRunning())
+        flags |= XWS_TIMER_RUNNING;
+    if (puzzle)
+        flags |= XWS_HAS_PUZZLE;
+
+    out.Write(XWS_MAGIC, sizeof(XWS_MAGIC));
+    out.Write(XWS_VERSION);
+    out.Write(flags);
+    out.Write(static_cast<unsigned short>(grid.GetWidth()));
+    out.Write(static_cast<unsigned short>(grid.GetHeight()));
+    out.WriteLong(puz.GetTime() < 0 ? 0 : puz.GetTime());
+    out.WriteLong(HashXwsGrid(grid));
+
+    std::string text;
+    for (const Square * square = grid.First();
+         square != NULL;
+         square = square->Next())
+    {
+        out.Write(static_cast<unsigned short>(square->GetFlag()));
+        text = encode_utf8(square->GetText());
+        if (text.size() > 0xffff)
+            throw ConversionError("Square text is too long");
+        out.Write(static_cast<unsigned short>(text.size()));
+        out.Write(text);
+    }
+
+    if (puzzle)
+    {
+        out.WriteLong(length);
+        out.Write(puzzle, length);
+    }
+}
+
+} // namespace puz
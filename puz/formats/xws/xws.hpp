@@ -0,0 +1,74 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_FORMATS_XWS_H
+#define PUZ_FORMATS_XWS_H
+
+#include "Puzzle.hpp"
+#include "utils/bufferwriter.hpp"
+#include <string>
+
+// XWord snapshots (see Snapshot.hpp)
+//
+// Header (24 bytes)
+//     magic           8
+//     version         2   XWS_VERSION
+//     flags           2   XWS_TIMER_RUNNING, XWS_HAS_PUZZLE
+//     width           2
+//     height          2
+//     time            4
+//     grid hash       4   See HashXwsGrid
+//
+// Squares, in row-major order
+//     flag            2
+//     text length     2
+//     text                UTF-8
+//
+// Puzzle (if XWS_HAS_PUZZLE)
+//     length          4
+//     puzzle file
+
+namespace puz {
+
+static const char XWS_MAGIC[8] = { 'X', 'W', 'S', 'N', 'A', 'P', 'S', '\x1a' };
+static const unsigned short XWS_VERSION = 1;
+
+enum XwsFlag
+{
+    XWS_TIMER_RUNNING = 0x0001,
+    XWS_HAS_PUZZLE    = 0x0002
+};
+
+// A hash of the grid's size and solution, used to check that a snapshot
+// belongs to a puzzle.
+unsigned int HashXwsGrid(const Grid & grid);
+
+void SaveXwsBuffer(const Puzzle & puz, buffer_writer & out,
+                   const char * puzzle = NULL, size_t length = 0);
+// Restore a snapshot to a loaded puzzle.
+// Return false if the snapshot is for a different puzzle.
+bool LoadXwsState(Puzzle * puz, const char * data, size_t length);
+
+// Load a snapshot that includes its puzzle
+void LoadXws(Puzzle * puz, const std::string & filename, void * /* dummy */);
+void LoadXwsBuffer(Puzzle * puz, const char * data, size_t length, void * /* dummy */);
+int ProbeXws(const char * data, size_t length);
+
+} // namespace puz
+
+#endif // PUZ_FORMATS_XWS_H
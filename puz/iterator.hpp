@@ -19,161 +19,154 @@
 #define PUZ_ITERATOR_H
 
 #include "Square.hpp"
-#include <memory>
+#include <cstddef>
 
 namespace puz {
 
 // There is a basic deficiency in this iterator implementation in that
 // const iterators aren't really possible.
-// Storing a pointer to iterator_impl makes it so that Square is always
-// returned non-const.  I don't *really* think that is a problem given that
-// we don't ever use a const Grid (where the Squares are actually stored).
+// Square is always returned non-const.  I don't *really* think that is a
+// problem given that we don't ever use a const Grid (where the Squares are
+// actually stored).
 
 // Really this just opens up the big can of worms that is the entire
 // design of const-correctness in the puz library.
 
-// base class for iterator implementation
-class iterator_impl
-{
-public:
-    virtual iterator_impl * clone()=0;
-    virtual ~iterator_impl() {}
-    virtual void increment()=0;
-    virtual void decrement()=0;
-    virtual Square * ptr()=0;
-    virtual Square & ref()=0;
-};
-
-// A null iterator
-class null_iterator_impl : public iterator_impl
-{
-public:
-    null_iterator_impl() {}
-    null_iterator_impl * clone() { return new null_iterator_impl(); }
-    void increment() {}
-    void decrement() {}
-    Square * ptr() { return NULL; }
-    Square & ref() { throw std::exception(); }
-};
+// ----------------------------------------------------------------------------
+// The square iterator
+// ----------------------------------------------------------------------------
 
-// Basic iterator implementation
-// This is a drop-in replacement for the usual construction:
+// square_iterator is a small value type; copying or incrementing one never
+// allocates.  It can walk squares in three ways:
+//
+// Following the grid's linked-list.  This is a drop-in replacement for the
+// usual construction:
 // for (square = grid.First(); square != NULL; square = square->Next())
 // Instead you can use
-// for (square_iterator it = grid.begin(); it != grid.end(); ++it)
-class basic_iterator_impl : public iterator_impl
-{
-public:
-    basic_iterator_impl(Square * square = NULL, GridDirection dir = ACROSS)
-        : m_square(square),
-          m_direction(dir)
-    {}
-    virtual iterator_impl * clone()
-        { return new basic_iterator_impl(m_square, m_direction); }
-    virtual void increment() { m_square = m_square->Next(m_direction); }
-    virtual void decrement() { m_square = m_square->Prev(m_direction); }
-    virtual Square * ptr() { return m_square; }
-    virtual Square & ref() { return *m_square; }
-
-protected:
-    Square * m_square;
-    GridDirection m_direction;
-};
-
-// ----------------------------------------------------------------------------
-// The square iterator (wrapper for implementation classes)
-// ----------------------------------------------------------------------------
+// for (square_iterator it(grid.First()); it != square_iterator(); ++it)
+//
+// Along a straight Word, stepping through the grid's storage by a fixed
+// stride between the word's first and last squares.
+//
+// Along a list of squares (a Word that is not a straight line).  The list
+// has a NULL sentinel at each end.
+//
+// In each case the iterator becomes NULL after it leaves the end of the
+// squares, so end() iterators compare equal to a default-constructed one.
 template <typename Square_T, bool INC = true>
     class square_iterator_t
 {
 public:
     typedef square_iterator_t<Square_T, INC> self_t;
     // This allows conversion between square_iterator and const_square_iterator
-    friend class square_iterator_t<const Square, INC>;
+    template <typename S, bool I> friend class square_iterator_t;
 
-
-    square_iterator_t<Square_T, INC>()
-        : m_impl(new null_iterator_impl())
+    square_iterator_t()
+        : m_square(NULL), m_front(NULL), m_back(NULL), m_node(NULL),
+          m_stride(0), m_direction(ACROSS)
     {}
 
-    explicit square_iterator_t<Square_T, INC>(iterator_impl * it)
-        : m_impl(it)
+    explicit square_iterator_t(Square * square, GridDirection dir = ACROSS)
+        : m_square(square), m_front(NULL), m_back(NULL), m_node(NULL),
+          m_stride(0), m_direction(dir)
     {}
 
-    explicit square_iterator_t<Square_T, INC>(Square * square,
-                                              GridDirection dir = ACROSS)
-        : m_impl(new basic_iterator_impl(square, dir))
+    // A straight word from front to back; used by Word.
+    square_iterator_t(Square * square, Square * front, Square * back,
+                      ptrdiff_t stride)
+        : m_square(square), m_front(front), m_back(back), m_node(NULL),
+          m_stride(stride), m_direction(ACROSS)
     {}
 
-    // Copy constructor: make a copy of m_impl
-    template <typename OTHER>
-    square_iterator_t<Square_T, INC>(const OTHER & other)
-        : m_impl(other.m_impl->clone())
+    // A NULL-terminated list of squares; used by Word.
+    explicit square_iterator_t(Square * const * node)
+        : m_square(*node), m_front(NULL), m_back(NULL), m_node(node),
+          m_stride(0), m_direction(ACROSS)
     {}
 
-    // Assignment
-    template <typename OTHER>
-    self_t & operator=(const OTHER & other)
-    {
-        m_impl.reset(other.m_impl->clone());
-        return *this;
-    }
+    // Conversion from other iterator types
+    template <typename OTHER, bool OTHER_INC>
+    square_iterator_t(const square_iterator_t<OTHER, OTHER_INC> & other)
+        : m_square(other.m_square),
+          m_front(other.m_front),
+          m_back(other.m_back),
+          m_node(other.m_node),
+          m_stride(other.m_stride),
+          m_direction(other.m_direction)
+    {}
 
     // Comparison
-    template <typename OTHER>
-    bool operator==(const square_iterator_t<OTHER, INC> & other) const
+    template <typename OTHER, bool OTHER_INC>
+    bool operator==(const square_iterator_t<OTHER, OTHER_INC> & other) const
     {
-        return m_impl->ptr() == other.m_impl->ptr();
+        return m_square == other.m_square;
     }
 
-    template <typename OTHER>
-    bool operator!=(const square_iterator_t<OTHER, INC> & other) const
+    template <typename OTHER, bool OTHER_INC>
+    bool operator!=(const square_iterator_t<OTHER, OTHER_INC> & other) const
     {
-        return m_impl->ptr() != other.m_impl->ptr();
+        return m_square != other.m_square;
     }
 
     bool operator==(const Square * other) const
     {
-        return m_impl->ptr() == other;
+        return m_square == other;
     }
 
     bool operator!=(const Square * other) const
     {
-        return m_impl->ptr() != other;
+        return m_square != other;
     }
 
     // Prefix operators
-    self_t & operator++() { increment(); return *this; }
-    self_t & operator--() { decrement(); return *this; }
+    self_t & operator++() { if (INC) next(); else prev(); return *this; }
+    self_t & operator--() { if (INC) prev(); else next(); return *this; }
 
     // Postfix operators
-    self_t operator++(int) { self_t it = *this; increment(); return it; }
-    self_t operator--(int) { self_t it = *this; decrement(); return it; }
+    self_t operator++(int) { self_t it = *this; ++*this; return it; }
+    self_t operator--(int) { self_t it = *this; --*this; return it; }
 
     // Pointer operators
-    Square & operator*() const { return m_impl->ref(); }
-    Square * operator->() const { return &*m_impl->ptr(); }
+    Square & operator*() const { return *m_square; }
+    Square * operator->() const { return m_square; }
 
 protected:
-    std::auto_ptr<iterator_impl> m_impl;
+    Square * m_square;          // The current square (NULL at the end)
+    Square * m_front;           // First and last squares of a straight word
+    Square * m_back;
+    Square * const * m_node;    // The current node of a list of squares
+    ptrdiff_t m_stride;         // Distance between squares of a straight word
+    GridDirection m_direction;  // Direction of the linked-list
+
+    void next()
+    {
+        if (! m_square)
+            return;
+        else if (m_node)
+            m_square = *++m_node;
+        else if (m_back)
+            m_square = m_square == m_back ? NULL : m_square + m_stride;
+        else
+            m_square = m_square->Next(m_direction);
+    }
 
-    // Template-specific functions
-    void increment();
-    void decrement();
+    void prev()
+    {
+        if (! m_square)
+            return;
+        else if (m_node)
+            m_square = *--m_node;
+        else if (m_front)
+            m_square = m_square == m_front ? NULL : m_square - m_stride;
+        else
+            m_square = m_square->Prev(m_direction);
+    }
 };
 
 // Typedefs
 typedef square_iterator_t<Square, true> square_iterator;
 typedef square_iterator_t<Square, false> square_reverse_iterator;
 
-#ifdef _WINDOWS
-// Swap increment/decrement for reverse iterators
-inline void square_iterator::increment() { m_impl->increment(); }
-inline void square_iterator::decrement() { m_impl->decrement(); }
-inline void square_reverse_iterator::increment() { m_impl->decrement(); }
-inline void square_reverse_iterator::decrement() { m_impl->increment(); }
-#endif // _WINDOWS
-
 } // namespace puz
 
 #endif // PUZ_ITERATOR_H
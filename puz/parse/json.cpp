@@ -18,194 +18,323 @@
 #include "json.hpp"
 #include "puzstring.hpp"
 #include <yajl/yajl_parse.h>
-#include <stack>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <algorithm>
 
 namespace puz {
 namespace json {
 
-static const int BUFF_SIZE = 1024;
+// yajl copies anything it needs to keep between chunks, so large chunks
+// mean less copying.
+static const size_t BUFF_SIZE = 64 * 1024;
 
-class ParserData
+// ----------------------------------------------------------------------------
+// TreeBuilder
+// ----------------------------------------------------------------------------
+
+void TreeBuilder::AddValue(Value * val)
 {
-public:
-    ParserData() : root(NULL) {}
-    ~ParserData() { delete root; }
+    if (m_root == NULL)
+        m_root = val;
+    else if (m_stack.back().isMap)
+        m_entries.push_back(Map::value_type(m_key, val));
+    else
+        m_values.push_back(val);
+}
+
+void TreeBuilder::OnNull()
+{
+    AddValue(m_arena.create<Null>());
+}
+
+void TreeBuilder::OnBool(bool val)
+{
+    AddValue(m_arena.create<Bool>(val));
+}
+
+void TreeBuilder::OnNumber(const char * str, size_t len)
+{
+    AddValue(m_arena.create<Number>(Copy(str, len)));
+}
+
+void TreeBuilder::OnString(const char * str, size_t len)
+{
+    AddValue(m_arena.create<String>(Copy(str, len)));
+}
+
+void TreeBuilder::OnMapStart()
+{
+    Map * map = m_arena.create<Map>(m_arena);
+    AddValue(map);
+    Frame frame = { map, m_entries.size(), true };
+    m_stack.push_back(frame);
+}
+
+void TreeBuilder::OnMapKey(const char * str, size_t len)
+{
+    m_key = Copy(str, len);
+}
+
+void TreeBuilder::OnMapEnd()
+{
+    const Frame frame = m_stack.back();
+    m_stack.pop_back();
+    Map::value_type * first = m_entries.data() + frame.start;
+    Map::value_type * last = m_entries.data() + m_entries.size();
+    frame.container->AsMap()->assign(first, Map::SortEntries(first, last));
+    m_entries.resize(frame.start);
+}
+
+void TreeBuilder::OnArrayStart()
+{
+    Array * array = m_arena.create<Array>(m_arena);
+    AddValue(array);
+    Frame frame = { array, m_values.size(), false };
+    m_stack.push_back(frame);
+}
+
+void TreeBuilder::OnArrayEnd()
+{
+    const Frame frame = m_stack.back();
+    m_stack.pop_back();
+    frame.container->AsArray()->assign(m_values.data() + frame.start,
+                                       m_values.data() + m_values.size());
+    m_values.resize(frame.start);
+}
 
-    void AddValue(Value * val)
+// ----------------------------------------------------------------------------
+// Map
+// ----------------------------------------------------------------------------
+
+static bool EntryLess(const Map::value_type & a, const Map::value_type & b)
+{
+    return Map::KeyLess(a.first, b.first);
+}
+
+Map::value_type * Map::SortEntries(value_type * first, value_type * last)
+{
+    // Most maps are small, and insertion sort is stable too.
+    if (last - first <= 16)
     {
-        if (root == NULL)
-        {
-            root = val;
-        }
-        else if (key.empty())
-        {
-            valueStack.top()->AsArray()->push_back(val);
-        }
-        else
+        for (value_type * it = first + 1; it < last; ++it)
         {
-            valueStack.top()->AsMap()->Set(key, val);
-            key.clear();
+            const value_type entry = *it;
+            value_type * pos = it;
+            for (; pos != first && EntryLess(entry, pos[-1]); --pos)
+                *pos = pos[-1];
+            *pos = entry;
         }
-        if (val->IsObject())
-            valueStack.push(val);
     }
-
-    void OnContainerEnd()
+    else
     {
-        valueStack.pop();
+        std::stable_sort(first, last, EntryLess);
     }
-
-    void SetKey(const string_t & k)
+    // Remove duplicate keys.  The last value wins, as it would if the
+    // values were Set one at a time.
+    value_type * out = first;
+    for (value_type * it = first; it != last; ++it)
     {
-        key = k;
+        if (it + 1 != last && ! KeyLess(it->first, it[1].first))
+            continue;
+        *out++ = *it;
     }
-
-    Value * GetRoot() { return root; }
-    Value * ReleaseRoot() { Value * tmp = root; root = NULL; return tmp; }
-
-protected:
-    Value * root;
-    std::stack<Value *> valueStack;
-    string_t key;
-};
+    return out;
+}
 
 // ----------------------------------------------------------------------------
 // yajl Callback functions
 // ----------------------------------------------------------------------------
 
+// yajl is a C library, so exceptions can't be thrown through it.  They are
+// caught in the callbacks, which stop the parser, and rethrown after
+// yajl_parse returns.
+struct ParseContext
+{
+    ParseContext(Handler & h) : handler(h), started(false) {}
+
+    Handler & handler;
+    bool started; // Has any value been parsed?
+    std::exception_ptr error;
+};
+
 // Yeah, this macro makes things look a little funny, but I think
 // it also makes things more readable.
-#define obj ((ParserData*)ctx)
-
-#define make_string(val, len) decode_utf8(std::string((const char*)val, len))
+#define CALL_HANDLER(call)                                   \
+    ParseContext * obj = static_cast<ParseContext *>(ctx);   \
+    obj->started = true;                                     \
+    try                                                      \
+    {                                                        \
+        obj->handler.call;                                   \
+    }                                                        \
+    catch (...)                                              \
+    {                                                        \
+        obj->error = std::current_exception();               \
+        return 0;                                            \
+    }                                                        \
+    return 1
 
 int on_null(void * ctx)
 {
-    obj->AddValue(new Null);
-    return 1;
+    CALL_HANDLER(OnNull());
 }
 
 int on_bool(void * ctx, int boolVal)
 {
-    obj->AddValue(new Bool(boolVal != 0));
-    return 1;
+    CALL_HANDLER(OnBool(boolVal != 0));
 }
 
 int on_number(void * ctx, const char * numberVal, size_t numberLen)
 {
-    obj->AddValue(new Number(make_string(numberVal, numberLen)));
-    return 1;
+    CALL_HANDLER(OnNumber(numberVal, numberLen));
 }
 
 int on_string(void * ctx, const unsigned char * stringVal, size_t stringLen)
 {
-    obj->AddValue(new String(make_string(stringVal, stringLen)));
-    return 1;
+    CALL_HANDLER(OnString((const char *)stringVal, stringLen));
 }
 
 int on_map_start(void * ctx)
 {
-    obj->AddValue(new Map);
-    return 1;
+    CALL_HANDLER(OnMapStart());
 }
 
 int on_map_key(void * ctx, const unsigned char * key, size_t stringLen)
 {
-    obj->SetKey(make_string(key, stringLen));
-    return 1;
+    CALL_HANDLER(OnMapKey((const char *)key, stringLen));
 }
 
 int on_map_end(void * ctx)
 {
-    obj->OnContainerEnd();
-    return 1;
+    CALL_HANDLER(OnMapEnd());
 }
 
 int on_array_start(void * ctx)
 {
-    obj->AddValue(new Array);
-    return 1;
+    CALL_HANDLER(OnArrayStart());
 }
 
 int on_array_end(void * ctx)
 {
-    obj->OnContainerEnd();
-    return 1;
+    CALL_HANDLER(OnArrayEnd());
 }
 
-#undef make_string
-#undef obj
+#undef CALL_HANDLER
 
-Value * ParseJSON(std::istream & stream)
+// Parses a document in one or more chunks
+class ParserHandle
 {
-    // The callbacks array
-    yajl_callbacks cb = {
-        on_null,
-        on_bool,
-        NULL,
-        NULL,
-        on_number,
-        on_string,
-        on_map_start,
-        on_map_key,
-        on_map_end,
-        on_array_start,
-        on_array_end
-    };
+public:
+    ParserHandle(Handler & handler)
+        : m_context(handler)
+    {
+        // The callbacks array
+        static const yajl_callbacks cb = {
+            on_null,
+            on_bool,
+            NULL,
+            NULL,
+            on_number,
+            on_string,
+            on_map_start,
+            on_map_key,
+            on_map_end,
+            on_array_start,
+            on_array_end
+        };
+        m_handle = yajl_alloc(&cb, NULL, &m_context);
+        yajl_config(m_handle, yajl_allow_trailing_garbage, 1);
+    }
 
-    // Create the json parser
-    ParserData data;
-    yajl_handle p = yajl_alloc(&cb, NULL, &data);
-    yajl_config(p, yajl_allow_trailing_garbage, 1);
+    ~ParserHandle() { yajl_free(m_handle); }
 
-    try
+    void Parse(const unsigned char * data, size_t length)
     {
-        for (;;)
-        {
-            unsigned char buff[BUFF_SIZE];
-            stream.read((char*)(buff), BUFF_SIZE);
-            const int bytes_read = stream.gcount();
-            yajl_status status = yajl_parse(p, buff, bytes_read);
-            if (status != yajl_status_ok)
-            {
-                if (! data.GetRoot()) // We didn't parse anything
-                    throw FileTypeError("json");
-                else // This is json, but not well formed
-                    throw LoadError(
-                        (char *)yajl_get_error(p, 0, buff, BUFF_SIZE));
-            }
-            if (bytes_read == 0)
-            {
-                yajl_complete_parse(p);
-                break;
-            }
-        }
+        CheckStatus(yajl_parse(m_handle, data, length), data, length);
+    }
+
+    void Complete()
+    {
+        CheckStatus(yajl_complete_parse(m_handle), NULL, 0);
+        if (! m_context.started)
+            throw FileTypeError("json");
+    }
+
+private:
+    void CheckStatus(yajl_status status, const unsigned char * data, size_t length)
+    {
+        if (status == yajl_status_ok)
+            return;
+        if (m_context.error) // The handler threw an exception
+            std::rethrow_exception(m_context.error);
+        if (! m_context.started) // We didn't parse anything
+            throw FileTypeError("json");
+        // This is json, but not well formed
+        unsigned char * msg = yajl_get_error(m_handle, 0, data, length);
+        std::string error((char *)msg);
+        yajl_free_error(m_handle, msg);
+        throw LoadError(error);
     }
-    catch (...)
+
+    ParseContext m_context;
+    yajl_handle m_handle;
+};
+
+void Parse(std::istream & stream, Handler & handler)
+{
+    ParserHandle parser(handler);
+    std::vector<char> buff(BUFF_SIZE);
+    for (;;)
     {
-        yajl_free(p);
-        throw;
+        stream.read(&buff[0], BUFF_SIZE);
+        const size_t bytes_read = stream.gcount();
+        if (bytes_read == 0)
+            break;
+        parser.Parse((const unsigned char *)&buff[0], bytes_read);
     }
-    yajl_free(p);
-    // Release ownership of the root pointer and return it
-    if (! data.GetRoot())
+    parser.Complete();
+}
+
+void Parse(const char * data, size_t length, Handler & handler)
+{
+    ParserHandle parser(handler);
+    // yajl keeps its own copy of anything it needs between chunks, so the
+    // whole buffer can be parsed at once.
+    parser.Parse((const unsigned char *)data, length);
+    parser.Complete();
+}
+
+// ----------------------------------------------------------------------------
+// Document
+// ----------------------------------------------------------------------------
+
+void Document::Parse(std::istream & stream)
+{
+    TreeBuilder builder(*this);
+    json::Parse(stream, builder);
+    if (! builder.GetRoot())
+        throw FileTypeError("json");
+    m_root = builder.GetRoot();
+}
+
+void Document::Parse(const char * data, size_t length)
+{
+    TreeBuilder builder(*this);
+    json::Parse(data, length, builder);
+    if (! builder.GetRoot())
         throw FileTypeError("json");
-    return data.ReleaseRoot();
+    m_root = builder.GetRoot();
 }
 
 void Parser::LoadPuzzle(Puzzle * puz, std::istream & stream)
 {
-    std::auto_ptr<Value> root(ParseJSON(stream));
+    std::unique_ptr<Document> doc(new Document);
+    doc->Parse(stream);
     // JSON document errors will be LoadErrors
     try {
-        bool ptr_is_owned = DoLoadPuzzle(puz, root.get());
-        if (ptr_is_owned)
-        {
-            if (root->IsObject()) 
-                root->AsObject()->cleanup();
-            // The parser subclass owns the pointer
-            root.release();
-        }
+        if (DoLoadPuzzle(puz, doc->GetRoot()))
+            puz->SetFormatData(doc.release());
     }
     catch (BaseError & e) {
         throw LoadError(e.what());
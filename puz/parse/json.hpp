@@ -18,13 +18,16 @@
 #ifndef PUZ_JSON_H
 #define PUZ_JSON_H
 
-#include <map>
 #include <vector>
-#include <set>
+#include <algorithm>
 #include <fstream>
+#include <utility>
+#include <stdexcept>
 
 #include "Puzzle.hpp"
 #include "puzstring.hpp"
+#include "utils/arena.hpp"
+#include "utils/bufferreader.hpp"
 
 namespace puz {
 namespace json {
@@ -45,15 +48,47 @@ public:
     // Override this to load the actual puzzle given a json::Value.
     // Any values that are used by the puzzle should be pop'd so that
     // the remaining values can be stored as extra data in the puzzle object.
-    // Return true if your parser subclass will take responsibility for the
-    // root pointer (e.g. the pointer is stored as Puzzle::FormatData)
+    // Return true to keep the parsed Document (which owns every value) as
+    // the puzzle's FormatData.
     virtual bool DoLoadPuzzle(Puzzle * puz, Value * root) =0;
 };
 
+// ----------------------------------------------------------------------------
+// Streaming (SAX-style) parsing
+// ----------------------------------------------------------------------------
+
+// Receives parser events in document order.
+// Strings are UTF-8, and are only valid for the duration of the call.
+// Exceptions thrown by a handler stop the parser, and are rethrown by Parse.
+class Handler
+{
+public:
+    virtual ~Handler() {}
+
+    virtual void OnNull() {}
+    virtual void OnBool(bool /* val */) {}
+    virtual void OnNumber(const char * /* str */, size_t /* len */) {}
+    virtual void OnString(const char * /* str */, size_t /* len */) {}
+    virtual void OnMapStart() {}
+    virtual void OnMapKey(const char * /* str */, size_t /* len */) {}
+    virtual void OnMapEnd() {}
+    virtual void OnArrayStart() {}
+    virtual void OnArrayEnd() {}
+};
+
+// Parse a document, passing each value to handler.
+// Throws FileTypeError if nothing could be parsed, or LoadError if the
+// document is malformed.
+void Parse(std::istream & stream, Handler & handler);
+void Parse(const char * data, size_t length, Handler & handler);
+
 // ----------------------------------------------------------------------------
 // JSON object representation
 // ----------------------------------------------------------------------------
-// This is similar to yajl_tree
+// This is similar to yajl_tree, except that values live in an arena that
+// belongs to a Document.  Values are never deleted individually: they are
+// all freed with the Document.  Strings, numbers, and map keys are kept as
+// UTF-8, and only converted to string_t when they are asked for.
 enum json_t
 {
     j_string,
@@ -119,8 +154,10 @@ public:
     virtual bool IsSimple() const { return ! IsObject(); }
 
     // Getters
-    virtual const string_t & AsString() const { throw TypeError("string"); }
-    virtual const string_t & AsNumber()  const { throw TypeError("number"); }
+    virtual string_t AsString() const { throw TypeError("string"); }
+    virtual string_t AsNumber() const { throw TypeError("number"); }
+    // The UTF-8 text of a string or number
+    virtual byte_span AsUtf8() const { throw TypeError("string"); }
     virtual bool AsBool() const { throw TypeError("bool"); }
     virtual Map * AsMap() { throw TypeError("map"); }
     virtual Array * AsArray() { throw TypeError("array"); }
@@ -131,30 +168,31 @@ public:
 class String : public Value
 {
 public:
-    String(const string_t & str) : Value(), m_str(str) {}
+    String(const byte_span & str) : Value(), m_str(str) {}
     virtual ~String () {}
 
-    virtual const string_t & AsString() const { return m_str; }
+    virtual string_t AsString() const { return decode_utf8(m_str.data(), m_str.size()); }
+    virtual byte_span AsUtf8() const { return m_str; }
     bool IsString() const { return true; }
 
 protected:
-    string_t m_str;
+    byte_span m_str;
 };
 
 
 class Number : public Value
 {
 public:
-    Number(const string_t & num) : m_str(num) {}
-    Number(const int num) : m_str(ToString(num)) {}
+    Number(const byte_span & num) : m_str(num) {}
     virtual ~Number () {}
 
-    virtual const string_t & AsString() const { return m_str; }
-    virtual const string_t & AsNumber() const { return m_str; }
+    virtual string_t AsString() const { return decode_utf8(m_str.data(), m_str.size()); }
+    virtual string_t AsNumber() const { return decode_utf8(m_str.data(), m_str.size()); }
+    virtual byte_span AsUtf8() const { return m_str; }
     bool IsNumber() const { return true; }
 
 protected:
-    string_t m_str;
+    byte_span m_str;
 };
 
 
@@ -185,29 +223,10 @@ class Object : public Value
 {
 public:
     Object() {}
-    virtual ~Object ()
-    {
-        cleanup();
-    }
+    virtual ~Object () {}
 
     Object * AsObject() { return this; }
     bool IsObject() const { return true; }
-
-    virtual void cleanup()
-    {
-        std::set<Value *>::iterator it;
-        for (it = m_to_delete.begin(); it != m_to_delete.end(); ++it)
-            delete *it;
-        m_to_delete.clear();
-    }
-
-protected:
-    virtual void mark_for_deletion(Value * ptr)
-    {
-        m_to_delete.insert(ptr);
-    }
-    
-    std::set<Value *> m_to_delete;
 };
 
 
@@ -216,8 +235,8 @@ template <typename KEY, typename CONTAINER>
 class Object_Template : public Object
 {
 public:
-    Object_Template() {}
-    virtual ~Object_Template();
+    explicit Object_Template(arena & a) : m_container(a) {}
+    virtual ~Object_Template() {}
 
     typedef KEY key_t;
     typedef CONTAINER container_t;
@@ -233,31 +252,32 @@ public:
     Value * operator[](key_t key) { return Get(key); }
     bool Contains(key_t key) { return find(key) != end(); }
 
-    const string_t & GetString(key_t key) { return Get(key)->AsString(); }
-    const string_t & GetNumber(key_t key) { return Get(key)->AsNumber(); }
+    string_t GetString(key_t key) { return Get(key)->AsString(); }
+    string_t GetNumber(key_t key) { return Get(key)->AsNumber(); }
     bool GetBool(key_t key)     { return Get(key)->AsBool(); }
     bool GetNull(key_t key)     { return Get(key)->IsNull(); }
     Map * GetMap(key_t key)     { return Get(key)->AsMap(); }
     Array * GetArray(key_t key) { return Get(key)->AsArray(); }
 
-    const string_t & GetString(key_t key, const string_t & def);
-    const string_t & GetNumber(key_t key, const string_t & def);
+    string_t GetString(key_t key, const string_t & def);
+    string_t GetNumber(key_t key, const string_t & def);
     bool GetBool(key_t key, bool def);
 
-    // Return a value and relinquish ownership of it.
+    // Return a value and remove it from this object.
+    // The value still belongs to the Document, so Detach and Pop are the
+    // same.
     Value * Detach(key_t key);
-    // Return a value and mark it for later deletion.
-    Value * Pop(key_t key);
+    Value * Pop(key_t key) { return Detach(key); }
 
-    const string_t & PopString(key_t key) { return Pop(key)->AsString(); }
-    const string_t & PopNumber(key_t key) { return Pop(key)->AsNumber(); }
+    string_t PopString(key_t key) { return Pop(key)->AsString(); }
+    string_t PopNumber(key_t key) { return Pop(key)->AsNumber(); }
     bool PopBool(key_t key) { return Pop(key)->AsBool(); }
     bool PopNull(key_t key) { return Pop(key)->IsNull(); }
     Map * PopMap(key_t key) { return Pop(key)->AsMap(); }
     Array * PopArray(key_t key) { return Pop(key)->AsArray(); }
 
-    const string_t & PopString(key_t key, const string_t & def);
-    const string_t & PopNumber(key_t key, const string_t & def);
+    string_t PopString(key_t key, const string_t & def);
+    string_t PopNumber(key_t key, const string_t & def);
     bool PopBool(key_t key, bool def);
 
 protected:
@@ -280,27 +300,50 @@ protected:
 
 
 
-
+// Maps are kept sorted by key, and looked up with a binary search.
+// Keys are UTF-8.
 class Map
-    : public Object_Template< const string_t &, std::map<string_t, Value*> >
+    : public Object_Template< const string_t &,
+                              arena_vector< std::pair<byte_span, Value *> > >
 {
 public:
-    Map() {}
+    typedef container_t::value_type value_type;
+
+    explicit Map(arena & a) : Object_Template(a) {}
     virtual ~Map () {}
 
     Map * AsMap() { return this; }
     bool IsMap() const { return true; }
 
+    // Find a UTF-8 key
+    iterator find_utf8(const byte_span & key);
+
     // Setters
     void Set(key_t key, Value * val);
+
+    // Set the contents of the map, which must be sorted and have no
+    // duplicate keys (see SortEntries).
+    void assign(const value_type * first, const value_type * last)
+        { m_container.assign(first, last); }
+
+    // Sort map entries by key, and remove duplicate keys (keeping the last
+    // value for each key).  Return the new end.
+    static value_type * SortEntries(value_type * first, value_type * last);
+
+    // UTF-8 key comparison
+    static bool KeyLess(const byte_span & a, const byte_span & b)
+    {
+        const int cmp = memcmp(a.data(), b.data(), std::min(a.size(), b.size()));
+        return cmp < 0 || (cmp == 0 && a.size() < b.size());
+    }
 };
 
 
 
-class Array : public Object_Template< size_t, std::vector<Value*> >
+class Array : public Object_Template< size_t, arena_vector<Value*> >
 {
 public:
-    Array() {}
+    explicit Array(arena & a) : Object_Template(a) {}
     virtual ~Array () {}
 
     Array * AsArray() { return this; }
@@ -310,25 +353,96 @@ public:
     void reserve(size_t count) { m_container.reserve(count); }
 
     // Get and set
-    Value * at(size_t index) { return m_container.at(index); }
+    Value * at(size_t index)
+    {
+        if (index >= size())
+            throw std::out_of_range("json::Array::at");
+        return m_container[index];
+    }
     void push_back(Value * val) { m_container.push_back(val); }
+
+    // Set the contents of the array
+    void assign(Value * const * first, Value * const * last)
+        { m_container.assign(first, last); }
 };
 
 
 // --------------------------------------------------------------------------
-// Object_Template methods
+// Documents
 // --------------------------------------------------------------------------
 
-template <typename KEY, typename CONTAINER>
-inline Object_Template<KEY, CONTAINER>::~Object_Template()
+// Owns a tree of values, and the arena they are allocated from.
+class Document : public Puzzle::FormatData
 {
-    for (iterator it = begin(); it != end(); ++it)
-        delete get_value(it);
-}
+public:
+    Document() : m_arena(64 * 1024), m_root(NULL) {}
 
+    // Parse a document.  Throws the same exceptions as json::Parse.
+    void Parse(std::istream & stream);
+    void Parse(const char * data, size_t length);
+
+    Value * GetRoot() { return m_root; }
+    arena & GetArena() { return m_arena; }
+
+private:
+    arena m_arena;
+    Value * m_root;
+};
+
+// A Handler that builds a Value tree in a Document.
+// A TreeBuilder can also be given the events for a single value in the
+// middle of a document, in order to keep just that part.
+class TreeBuilder : public Handler
+{
+public:
+    explicit TreeBuilder(Document & doc)
+        : m_arena(doc.GetArena()), m_root(NULL)
+    {}
+
+    virtual void OnNull();
+    virtual void OnBool(bool val);
+    virtual void OnNumber(const char * str, size_t len);
+    virtual void OnString(const char * str, size_t len);
+    virtual void OnMapStart();
+    virtual void OnMapKey(const char * str, size_t len);
+    virtual void OnMapEnd();
+    virtual void OnArrayStart();
+    virtual void OnArrayEnd();
+
+    // Has a whole value been read?
+    bool IsComplete() const { return m_root != NULL && m_stack.empty(); }
+
+    Value * GetRoot() { return m_root; }
+
+protected:
+    void AddValue(Value * val);
+    byte_span Copy(const char * str, size_t len)
+        { return byte_span(m_arena.copy(str, len), len); }
+
+    // An open map or array.  Its members are kept in m_entries or m_values
+    // from index start, and are copied to the arena when it is closed.
+    struct Frame
+    {
+        Value * container;
+        size_t start;
+        bool isMap;
+    };
+
+    arena & m_arena;
+    Value * m_root;
+    std::vector<Frame> m_stack;
+    std::vector<Map::value_type> m_entries;
+    std::vector<Value *> m_values;
+    byte_span m_key;
+};
+
+
+// --------------------------------------------------------------------------
+// Object_Template methods
+// --------------------------------------------------------------------------
 
 template <typename KEY, typename CONTAINER>
-inline const string_t &
+inline string_t
 Object_Template<KEY, CONTAINER>::GetString(KEY key, const string_t & def)
 {
     iterator it = find(key);
@@ -342,7 +456,7 @@ Object_Template<KEY, CONTAINER>::GetString(KEY key, const string_t & def)
 }
 
 template <typename KEY, typename CONTAINER>
-inline const string_t &
+inline string_t
 Object_Template<KEY, CONTAINER>::GetNumber(KEY key, const string_t & def)
 {
     iterator it = find(key);
@@ -378,17 +492,8 @@ inline Value * Object_Template<KEY, CONTAINER>::Detach(KEY key)
     return val;
 }
 
-// Return a value and mark it for later deletion.
 template <typename KEY, typename CONTAINER>
-inline Value * Object_Template<KEY, CONTAINER>::Pop(KEY key)
-{
-    Value * val = Detach(key);
-    mark_for_deletion(val);
-    return val;
-}
-
-template <typename KEY, typename CONTAINER>
-inline const string_t &
+inline string_t
 Object_Template<KEY, CONTAINER>::PopString(KEY key, const string_t & def)
 {
     iterator it = find(key);
@@ -396,7 +501,6 @@ Object_Template<KEY, CONTAINER>::PopString(KEY key, const string_t & def)
     {
         Value * val = get_value(it);
         m_container.erase(it);
-        mark_for_deletion(val);
         if (! val->IsNull())
             return val->AsString();
     }
@@ -404,7 +508,7 @@ Object_Template<KEY, CONTAINER>::PopString(KEY key, const string_t & def)
 }
 
 template <typename KEY, typename CONTAINER>
-inline const string_t &
+inline string_t
 Object_Template<KEY, CONTAINER>::PopNumber(KEY key, const string_t & def)
 {
     iterator it = find(key);
@@ -412,7 +516,6 @@ Object_Template<KEY, CONTAINER>::PopNumber(KEY key, const string_t & def)
     {
         Value * val = get_value(it);
         m_container.erase(it);
-        mark_for_deletion(val);
         if (! val->IsNull())
             return val->AsNumber();
     }
@@ -428,7 +531,6 @@ Object_Template<KEY, CONTAINER>::PopBool(KEY key, bool def)
     {
         Value * val = get_value(it);
         m_container.erase(it);
-        mark_for_deletion(val);
         if (! val->IsNull())
             return val->AsBool();
     }
@@ -439,11 +541,22 @@ Object_Template<KEY, CONTAINER>::PopBool(KEY key, bool def)
 // Map methods
 // --------------------------------------------------------------------------
 
+inline Map::iterator Map::find_utf8(const byte_span & key)
+{
+    iterator it = std::lower_bound(begin(), end(), value_type(key, NULL),
+        [](const value_type & a, const value_type & b)
+            { return KeyLess(a.first, b.first); });
+    if (it != end() && ! KeyLess(key, it->first))
+        return it;
+    return end();
+}
+
 // template specialization for Object_Template:: find and get_value
 template<> inline Map::iterator
 Object_Template<Map::key_t, Map::container_t>::find(const string_t & key)
 {
-    return m_container.find(key);
+    const std::string utf8 = encode_utf8(key);
+    return static_cast<Map *>(this)->find_utf8(byte_span(utf8.data(), utf8.size()));
 }
 
 template<> inline Value *
@@ -466,8 +579,17 @@ inline void Map::Set(const string_t & key, Value * val)
 {
     iterator it = find(key);
     if (it != end())
-        mark_for_deletion(get_value(it));
-    m_container[key] = val;
+    {
+        it->second = val;
+        return;
+    }
+    const std::string utf8 = encode_utf8(key);
+    const byte_span copy(m_container.get_arena().copy(utf8.data(), utf8.size()),
+                         utf8.size());
+    it = std::lower_bound(begin(), end(), value_type(copy, NULL),
+        [](const value_type & a, const value_type & b)
+            { return KeyLess(a.first, b.first); });
+    m_container.insert(it, value_type(copy, val));
 }
 
 
@@ -498,4 +620,4 @@ Object_Template<Array::key_t, Array::container_t>::throw_out_of_range(size_t ind
 } // namespace json
 } // namespace puz
 
-#endif // PUZ_JSON_H
\ No newline at end of file
+#endif // PUZ_JSON_H
@@ -18,6 +18,11 @@
 #include "xml.hpp"
 #include <sstream>
 #include <fstream>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
 
 namespace puz {
 namespace xml {
@@ -81,6 +86,47 @@ std::string CamelCase(const string_t & name)
     return encode_utf8(str);
 }
 
+std::string GetRootName(const char * data, size_t length)
+{
+    const char * pos = data;
+    const char * end = data + length;
+    // UTF-8 BOM
+    if (length >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        pos += 3;
+    for (;;)
+    {
+        while (pos < end && ::isspace(static_cast<unsigned char>(*pos)))
+            ++pos;
+        if (pos == end || *pos != '<')
+            return std::string();
+        ++pos;
+        // Skip <?xml ... ?>, <!-- ... -->, and <!DOCTYPE ... >
+        const char * close = NULL;
+        if (pos < end && *pos == '?')
+            close = "?>";
+        else if (end - pos >= 3 && memcmp(pos, "!--", 3) == 0)
+            close = "-->";
+        else if (pos < end && *pos == '!')
+            close = ">";
+        if (! close)
+            break;
+        const char * found = std::search(pos, end, close, close + strlen(close));
+        if (found == end)
+            return std::string();
+        pos = found + strlen(close);
+    }
+    // The root element
+    const char * name = pos;
+    while (pos < end && ! ::isspace(static_cast<unsigned char>(*pos))
+           && *pos != '>' && *pos != '/')
+    {
+        ++pos;
+    }
+    if (pos == end)
+        return std::string();
+    return std::string(name, pos);
+}
+
 // Load functions
 void Parser::LoadFromFilename(Puzzle * puz, const std::string & filename)
 {
@@ -93,24 +139,69 @@ void Parser::LoadFromFilename(Puzzle * puz, const std::string & filename)
 
 void Parser::LoadFromString(Puzzle * puz, const char * str)
 {
-    std::auto_ptr<pugi::xml_document> doc(new pugi::xml_document);
-    pugi::xml_parse_result result = doc->load(str);
-
-    if (! result)
-        throw FileTypeError("xml");
+    LoadFromBuffer(puz, str, strlen(str));
+}
 
-    if (DoLoadPuzzle(puz, *doc))
-        doc.release();
+void Parser::LoadFromBuffer(Puzzle * puz, const char * data, size_t length)
+{
+    char * buffer = AllocateBuffer(length);
+    if (length > 0)
+        memcpy(buffer, data, length);
+    LoadInPlace(puz, buffer, length);
 }
 
 void Parser::LoadFromStream(Puzzle * puz, std::istream & stream)
 {
-    std::auto_ptr<pugi::xml_document> doc(new pugi::xml_document);
-    pugi::xml_parse_result result = doc->load(stream);
+    // Read seekable streams (i.e. files) straight into the buffer
+    const std::streampos start = stream.tellg();
+    if (start != std::streampos(-1) && stream.seekg(0, std::ios_base::end))
+    {
+        const std::streamoff length = stream.tellg() - start;
+        stream.seekg(start);
+        if (length >= 0 && stream)
+        {
+            char * buffer = AllocateBuffer(length);
+            stream.read(buffer, length);
+            LoadInPlace(puz, buffer, stream.gcount());
+            return;
+        }
+    }
+    stream.clear();
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    const std::string str = contents.str();
+    LoadFromBuffer(puz, str.data(), str.size());
+}
+
+char * Parser::AllocateBuffer(size_t length)
+{
+    // pugixml frees buffers that it owns with its own deallocation function
+    void * buffer = pugi::get_memory_allocation_function()(length > 0 ? length : 1);
+    if (! buffer)
+        throw std::bad_alloc();
+    return static_cast<char *>(buffer);
+}
+
+void Parser::LoadInPlace(Puzzle * puz, char * buffer, size_t length)
+{
+    std::unique_ptr<pugi::xml_document> doc(new pugi::xml_document);
+    // Compare addresses before the document owns (and might free) buffer
+    const char * begin = buffer;
+    const char * end = buffer + length;
+    pugi::xml_parse_result result = doc->load_buffer_inplace_own(buffer, length);
 
     if (! result)
         throw FileTypeError("xml");
 
+    // If pugixml converted the document to UTF-8, names won't be in the
+    // buffer.
+    m_begin = begin;
+    m_end = end;
+    if (! IsInBuffer(doc->document_element().name()))
+        m_begin = m_end = NULL;
+    m_visited.assign(m_end - m_begin, false);
+    m_visitedOther.clear();
+
     if (DoLoadPuzzle(puz, *doc))
         doc.release();
 }
@@ -174,5 +265,317 @@ void SetInnerXML(node n, const string_t & innerxml, void (*append_fn)(xml::node,
     }
 }
 
+// ----------------------------------------------------------------------------
+// Writer
+// ----------------------------------------------------------------------------
+
+static const size_t WRITER_BUFF_SIZE = 64 * 1024;
+
+Writer::Writer(pugi::xml_writer & out, const char * indent)
+    : m_out(out),
+      m_bufferWriter(m_buffer),
+      m_indent(indent),
+      m_isStartOpen(false),
+      m_flags(INDENT_INDENT)
+{
+    m_buffer.reserve(WRITER_BUFF_SIZE);
+    m_buffer.append("<?xml version=\"1.0\"?>\n");
+}
+
+void Writer::CloseStartTag()
+{
+    if (m_isStartOpen)
+    {
+        m_buffer.push_back('>');
+        m_isStartOpen = false;
+    }
+}
+
+void Writer::BeginLine()
+{
+    if (m_flags & INDENT_NEWLINE)
+        m_buffer.push_back('\n');
+    if ((m_flags & INDENT_INDENT) && ! m_indent.empty())
+        for (size_t i = 0; i < m_names.size(); ++i)
+            m_buffer.append(m_indent);
+}
+
+void Writer::Flush()
+{
+    if (! m_buffer.empty())
+        m_out.write(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+}
+
+void Writer::StartElement(const char * name)
+{
+    CloseStartTag();
+    BeginLine();
+    m_buffer.push_back('<');
+    m_buffer.append(name);
+    m_names.push_back(name);
+    m_isStartOpen = true;
+    m_flags = INDENT_NEWLINE | INDENT_INDENT;
+}
+
+void Writer::EndElement()
+{
+    std::string name;
+    name.swap(m_names.back());
+    m_names.pop_back();
+    if (m_isStartOpen)
+    {
+        m_buffer.append(" />");
+        m_isStartOpen = false;
+    }
+    else
+    {
+        BeginLine();
+        m_buffer.append("</").append(name).push_back('>');
+    }
+    m_flags = INDENT_NEWLINE | INDENT_INDENT;
+    if (m_buffer.size() >= WRITER_BUFF_SIZE)
+        Flush();
+}
+
+void Writer::Attribute(const char * name, const char * value)
+{
+    m_buffer.push_back(' ');
+    m_buffer.append(name).append("=\"");
+    WriteEscaped(value, true);
+    m_buffer.push_back('"');
+}
+
+void Writer::Attribute(const char * name, int value)
+{
+    char str[16];
+    snprintf(str, sizeof(str), "%d", value);
+    Attribute(name, str);
+}
+
+void Writer::Text(const char * text)
+{
+    CloseStartTag();
+    WriteEscaped(text, false);
+    m_flags = 0;
+}
+
+// Escape like pugixml: &, <, >, and control characters other than tab in
+// attributes; the same in text, except for quotes and line ends.
+enum
+{
+    ESCAPE_TEXT = 1,
+    ESCAPE_ATTRIBUTE = 2
+};
+
+static const unsigned char escapeTable[128] = {
+    3, 3, 3, 3, 3, 3, 3, 3,  3, 0, 2, 3, 3, 2, 3, 3, // 0-15
+    3, 3, 3, 3, 3, 3, 3, 3,  3, 3, 3, 3, 3, 3, 3, 3, // 16-31
+    0, 0, 2, 0, 0, 0, 3, 0,  0, 0, 0, 0, 0, 0, 0, 0, // 32-47
+    0, 0, 0, 0, 0, 0, 0, 0,  0, 0, 0, 0, 3, 0, 3, 0, // 48-63
+};
+
+static inline bool NeedsEscape(unsigned int ch, bool isAttribute)
+{
+    return ch < 128
+        && (escapeTable[ch] & (isAttribute ? ESCAPE_ATTRIBUTE : ESCAPE_TEXT));
+}
+
+static void AppendEscape(std::string & buffer, unsigned int ch)
+{
+    switch (ch)
+    {
+    case '&': buffer.append("&amp;"); break;
+    case '<': buffer.append("&lt;"); break;
+    case '>': buffer.append("&gt;"); break;
+    case '"': buffer.append("&quot;"); break;
+    default:
+        buffer.append("&#");
+        buffer.push_back(static_cast<char>('0' + ch / 10));
+        buffer.push_back(static_cast<char>('0' + ch % 10));
+        buffer.push_back(';');
+    }
+}
+
+void Writer::WriteEscaped(const char * text, bool isAttribute)
+{
+    const char * run = text;
+    const char * pos = text;
+    for (;; ++pos)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*pos);
+        if (ch == 0 || NeedsEscape(ch, isAttribute))
+        {
+            // Long runs (e.g. images) skip the buffer
+            if (static_cast<size_t>(pos - run) >= WRITER_BUFF_SIZE)
+            {
+                Flush();
+                m_out.write(run, pos - run);
+            }
+            else
+            {
+                m_buffer.append(run, pos);
+            }
+            if (ch == 0)
+                break;
+            AppendEscape(m_buffer, ch);
+            run = pos + 1;
+        }
+    }
+}
+
+#if PUZ_UNICODE
+
+void Writer::Attribute(const char * name, const string_t & value)
+{
+    m_buffer.push_back(' ');
+    m_buffer.append(name).append("=\"");
+    WriteEscaped(value, true);
+    m_buffer.push_back('"');
+}
+
+void Writer::Text(const string_t & text)
+{
+    CloseStartTag();
+    WriteEscaped(text, false);
+    m_flags = 0;
+}
+
+// Encode as UTF-8 while escaping, the same way as encode_utf8
+void Writer::WriteEscaped(const string_t & text, bool isAttribute)
+{
+    const size_t length = text.size();
+    for (size_t i = 0; i < length; ++i)
+    {
+        unsigned int ch = static_cast<unsigned int>(text[i]);
+        if (sizeof(char_t) == 2 && ch >= 0xD800 && ch < 0xE000)
+        {
+            // Surrogate pairs.  Unpaired surrogates are dropped.
+            if (ch >= 0xDC00 || i + 1 == length)
+                continue;
+            const unsigned int next = static_cast<unsigned int>(text[i+1]);
+            if (next < 0xDC00 || next >= 0xE000)
+                continue;
+            ch = 0x10000 + ((ch & 0x3ff) << 10) + (next & 0x3ff);
+            ++i;
+        }
+        if (ch < 0x80)
+        {
+            if (NeedsEscape(ch, isAttribute))
+                AppendEscape(m_buffer, ch);
+            else
+                m_buffer.push_back(static_cast<char>(ch));
+        }
+        else if (ch < 0x800)
+        {
+            m_buffer.push_back(static_cast<char>(0xC0 | (ch >> 6)));
+            m_buffer.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+        }
+        else if (ch < 0x10000)
+        {
+            m_buffer.push_back(static_cast<char>(0xE0 | (ch >> 12)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+        }
+        else
+        {
+            m_buffer.push_back(static_cast<char>(0xF0 | (ch >> 18)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((ch >> 12) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+        }
+    }
+}
+
+#endif // PUZ_UNICODE
+
+// Would pugixml parse this as exactly one text node with the same value?
+static bool IsPlainText(const std::string & str)
+{
+    bool hasText = false;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        const char ch = str[i];
+        if (ch == '<' || ch == '&' || ch == '\r' || ch == '\0')
+            return false;
+        if (ch != ' ' && ch != '\t' && ch != '\n')
+            hasText = true;
+    }
+    return hasText;
+}
+
+void Writer::InnerXML(const string_t & innerxml, bool wrapText)
+{
+    const std::string utf8 = encode_utf8(innerxml);
+    // Most text has no markup, and doesn't need to be parsed.
+    if (IsPlainText(utf8))
+    {
+        Text(utf8);
+        return;
+    }
+    // See SetInnerXML
+    pugi::xml_document doc;
+    std::string temp("<dummy>");
+    temp.append(utf8).append("</dummy>");
+    if (! doc.load_string(temp.c_str()))
+    {
+        Text(utf8);
+        return;
+    }
+    const node dummy = doc.first_child();
+    const bool wrap = wrapText && std::distance(dummy.begin(), dummy.end()) > 1;
+    for (node child = dummy.first_child(); child; child = child.next_sibling())
+    {
+        if (wrap && child.type() == pugi::node_pcdata)
+        {
+            StartElement("span");
+            Node(child);
+            EndElement();
+        }
+        else
+        {
+            Node(child);
+        }
+    }
+}
+
+void Writer::Node(node n)
+{
+    CloseStartTag();
+    switch (n.type())
+    {
+    case pugi::node_null:
+        return;
+    case pugi::node_pcdata:
+        Text(n.value());
+        return;
+    case pugi::node_cdata:
+        n.print(m_bufferWriter, "", pugi::format_default, pugi::encoding_utf8);
+        m_flags = 0;
+        return;
+    default:
+        break;
+    }
+    if (m_flags & INDENT_NEWLINE)
+        m_buffer.push_back('\n');
+    const size_t start = m_buffer.size();
+    const size_t depth = m_names.size();
+    n.print(m_bufferWriter, m_indent.c_str(), pugi::format_default,
+            pugi::encoding_utf8, static_cast<unsigned int>(depth));
+    // print always indents the node, and ends it with a newline.
+    if (! (m_flags & INDENT_INDENT))
+        m_buffer.erase(start, m_indent.size() * depth);
+    if (m_buffer.size() > start && m_buffer[m_buffer.size() - 1] == '\n')
+        m_buffer.resize(m_buffer.size() - 1);
+    m_flags = INDENT_NEWLINE | INDENT_INDENT;
+}
+
+void Writer::Finish()
+{
+    if (m_flags & INDENT_NEWLINE)
+        m_buffer.push_back('\n');
+    Flush();
+}
+
 } // namespace xml
 } // namespace puz
@@ -25,6 +25,7 @@
 
 #include <string>
 #include <set>
+#include <vector>
 
 namespace puz {
 namespace xml {
@@ -37,15 +38,22 @@ typedef pugi::xml_attribute attribute;
 string_t snake_case(const char * name);
 std::string CamelCase(const string_t & name);
 
+// Return the name of the root element, skipping the xml declaration,
+// comments, and doctype, without parsing the document.
+// Return an empty string if data doesn't start like an xml document, or
+// if the root element isn't within the first length bytes.
+std::string GetRootName(const char * data, size_t length);
+
 
 class Parser
 {
 public:
-    Parser() {}
+    Parser() : m_begin(NULL), m_end(NULL) {}
     virtual ~Parser() {}
 
     void LoadFromFilename(Puzzle * puz, const std::string & filename);
     void LoadFromString(Puzzle * puz, const char * str);
+    void LoadFromBuffer(Puzzle * puz, const char * data, size_t length);
     void LoadFromStream(Puzzle * puz, std::istream & stream);
 
     // Override this to load the actual puzzle given an xml::document.
@@ -59,9 +67,8 @@ public:
     //------------------
 
     // Keep track of visited nodes
-    std::set<size_t> m_visited;
-    node Visit(node n) { m_visited.insert(n.hash_value()); return n; }
-    bool HasVisited(node n) { return m_visited.find(n.hash_value()) != m_visited.end(); }
+    inline node Visit(node n);
+    inline bool HasVisited(node n);
 
     // Throw an exception if the child node does not exist.  Return the node
     node RequireChild(node n, const char * name);
@@ -82,8 +89,49 @@ public:
     // Child InnerXML
     string_t GetInnerXML(node n, const char * name)
         { return GetInnerXML(n.child(name)); }
+
+    // Parse buffer in place, and load the puzzle.
+    // buffer must come from AllocateBuffer.  The document takes ownership
+    // of it, even if loading fails.
+    void LoadInPlace(Puzzle * puz, char * buffer, size_t length);
+    static char * AllocateBuffer(size_t length);
+
+private:
+
+    // Documents are parsed in place, so each element's name is in the
+    // buffer, and no two elements have the same name pointer.  Visited
+    // elements are flagged in a bitmap indexed by the offset of the name.
+    // Any other nodes (text, or documents that pugixml had to convert to
+    // UTF-8) are kept in a set.
+    bool IsInBuffer(const char * name) const
+        { return name >= m_begin && name < m_end; }
+
+    const char * m_begin;
+    const char * m_end;
+    std::vector<bool> m_visited;
+    std::set<size_t> m_visitedOther;
 };
 
+inline node
+Parser::Visit(node n)
+{
+    const char * name = n.name();
+    if (IsInBuffer(name))
+        m_visited[name - m_begin] = true;
+    else
+        m_visitedOther.insert(n.hash_value());
+    return n;
+}
+
+inline bool
+Parser::HasVisited(node n)
+{
+    const char * name = n.name();
+    if (IsInBuffer(name))
+        return m_visited[name - m_begin];
+    return m_visitedOther.find(n.hash_value()) != m_visitedOther.end();
+}
+
 inline node
 Parser::RequireChild(node n, const char * name)
 {
@@ -127,6 +175,83 @@ inline void Append(node node, const char * name, const string_t & value)
 }
 
 
+// Writes a document element by element, without building an xml::document.
+// The output is the same as saving the equivalent document with pugixml's
+// default format (and the same indent).
+//
+// Output is buffered, and passed to out in large chunks.  Call Finish once
+// the root element has been closed.
+class Writer
+{
+public:
+    explicit Writer(pugi::xml_writer & out, const char * indent = "\t");
+
+    void StartElement(const char * name);
+    void EndElement();
+
+    // Attributes of the current element, before any content.
+    void Attribute(const char * name, const char * value);
+    void Attribute(const char * name, const std::string & value)
+        { Attribute(name, value.c_str()); }
+    void Attribute(const char * name, int value);
+    void Attribute(const char * name, bool value)
+        { Attribute(name, value ? "true" : "false"); }
+
+    // Content
+    void Text(const char * text);
+    void Text(const std::string & text) { Text(text.c_str()); }
+#if PUZ_UNICODE
+    void Attribute(const char * name, const string_t & value);
+    void Text(const string_t & text);
+#endif // PUZ_UNICODE
+
+    // Write innerxml as xml if it parses, or as text if it doesn't (like
+    // SetInnerXML).  If wrapText, text in mixed content is wrapped in a
+    // <span>.
+    void InnerXML(const string_t & innerxml, bool wrapText = false);
+
+    // Copy a node from another document as-is
+    void Node(node n);
+
+    void Finish();
+
+private:
+    // Collects the output of pugixml's print functions
+    class BufferWriter : public pugi::xml_writer
+    {
+    public:
+        explicit BufferWriter(std::string & buffer) : m_buffer(buffer) {}
+        virtual void write(const void * data, size_t size)
+            { m_buffer.append(static_cast<const char *>(data), size); }
+    private:
+        std::string & m_buffer;
+    };
+
+    // Whitespace before the next node, as in pugixml's node_output
+    enum
+    {
+        INDENT_NEWLINE = 1,
+        INDENT_INDENT = 2
+    };
+
+    void CloseStartTag();
+    void BeginLine();
+    void WriteEscaped(const char * text, bool isAttribute);
+#if PUZ_UNICODE
+    void WriteEscaped(const string_t & text, bool isAttribute);
+#endif // PUZ_UNICODE
+    void Flush();
+
+    pugi::xml_writer & m_out;
+    std::string m_buffer;
+    BufferWriter m_bufferWriter;
+    std::string m_indent;
+    std::vector<std::string> m_names; // Open elements
+    bool m_isStartOpen;               // The last start tag is missing its '>'
+    unsigned int m_flags;
+};
+
+
 } // namespace xml
 } // namespace puz
 
@@ -16,7 +16,6 @@
 // Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 
-#include "parse/pugixml/pugixml.hpp"
 #include "puzstring.hpp"
 #include "exceptions.hpp"
 #include <algorithm>
@@ -24,123 +23,436 @@
 #include <cstdio>
 #include <cassert>
 #include <set>
+#include <cstring>
+#include <cwctype>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define PUZ_USE_SSE2 1
+#   include <emmintrin.h>
+#else
+#   define PUZ_USE_SSE2 0
+#endif
 
 namespace puz {
 
 // ---------------------------------------------------------------------------
-// UTF-8
+// ASCII blocks
 // ---------------------------------------------------------------------------
 
-static unsigned int get_continuation(std::string::const_iterator & it)
+// Most text in a puzzle is ASCII, which reads the same in every encoding
+// we use.  These functions handle it a block at a time: 16 characters
+// with SSE2, otherwise 8.  Each one stops at the first block that has a
+// non-ASCII character (or is past the end of the string), and returns
+// the number of characters it handled.
+//
+// The converters below alternate between whole blocks and up to a block
+// of single characters, so short strings (most clues) and strings with
+// a few accented letters don't pay for a failed block test on every
+// character.
+
+#if PUZ_USE_SSE2
+static const size_t ASCII_BLOCK = 16;
+#else
+static const size_t ASCII_BLOCK = 8;
+#endif
+
+// The end of the next block, or the end of the string
+template <typename T>
+static const T * next_block(const T * it, const T * end)
 {
-    unsigned char ch = static_cast<unsigned char>(*it);
-    if (! (ch > 127 && ch < 192))
-        throw InvalidEncoding();
-    return ch;
+    return static_cast<size_t>(end - it) > ASCII_BLOCK ? it + ASCII_BLOCK : end;
 }
 
+#if PUZ_USE_SSE2
 
-static unsigned int utf8_to_unicode(std::string::const_iterator & it,
-                                    std::string::const_iterator & end)
+#if ! PUZ_UNICODE // Only decode_puz uses this
+static size_t count_ascii(const char * str, size_t size)
 {
-    // Translate the next code point
-    const unsigned char b1 = static_cast<unsigned char>(*it);
-    if (b1 < 128) // Ascii
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
     {
-        return b1;
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
     }
-    else if (b1 < 192) // Continuation character
+    return i;
+}
+#endif // ! PUZ_UNICODE
+
+// Bytes -> wchar_t, zero-extended
+static size_t widen_ascii(const char * str, size_t size, wchar_t * out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
     {
-        throw InvalidEncoding();
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i * dest = reinterpret_cast<__m128i *>(out + i);
+        if (sizeof(wchar_t) == 2)
+        {
+            _mm_storeu_si128(dest,     lo);
+            _mm_storeu_si128(dest + 1, hi);
+        }
+        else
+        {
+            _mm_storeu_si128(dest,     _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(hi, zero));
+        }
+    }
+    return i;
+}
+
+// Load 16 wchar_t, and return true if they are all ASCII.
+// If out is not NULL, the characters are also stored as bytes.
+static bool narrow_ascii_block(const wchar_t * str, char * out)
+{
+    const __m128i * src = reinterpret_cast<const __m128i *>(str);
+    __m128i bytes;
+    if (sizeof(wchar_t) == 2)
+    {
+        const __m128i a = _mm_loadu_si128(src);
+        const __m128i b = _mm_loadu_si128(src + 1);
+        const __m128i high = _mm_and_si128(_mm_or_si128(a, b),
+                                           _mm_set1_epi16(~0x7f));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xffff)
+            return false;
+        if (! out)
+            return true;
+        bytes = _mm_packus_epi16(a, b);
     }
-    else if (b1 < 224) // 2-byte sequence
+    else
     {
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b2 = get_continuation(it);
-        return (b1 - 192) * 64 + b2 - 128;
+        const __m128i a = _mm_loadu_si128(src);
+        const __m128i b = _mm_loadu_si128(src + 1);
+        const __m128i c = _mm_loadu_si128(src + 2);
+        const __m128i d = _mm_loadu_si128(src + 3);
+        const __m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        const __m128i high = _mm_and_si128(all, _mm_set1_epi32(~0x7f));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xffff)
+            return false;
+        if (! out)
+            return true;
+        // Everything is < 128, so packing doesn't saturate
+        bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
     }
-    else if (b1 < 240) // 3-byte sequence
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), bytes);
+    return true;
+}
+
+static size_t count_ascii(const wchar_t * str, size_t size)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        if (! narrow_ascii_block(str + i, NULL))
+            break;
+    return i;
+}
+
+// wchar_t -> bytes
+static size_t narrow_ascii(const wchar_t * str, size_t size, char * out)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        if (! narrow_ascii_block(str + i, out + i))
+            break;
+    return i;
+}
+
+#else // ! PUZ_USE_SSE2
+
+static size_t count_ascii(const char * str, size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
     {
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b2 = get_continuation(it);
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b3 = get_continuation(it);
-        return ((b1 - 224) * 64 + (b2 - 128)) * 64 + b3 - 128;
+        unsigned long long word;
+        memcpy(&word, str + i, 8);
+        if ((word & 0x8080808080808080ULL) != 0)
+            break;
     }
-    else if (b1 < 244) // 4-byte sequence
+    return i;
+}
+
+static size_t widen_ascii(const char * str, size_t size, wchar_t * out)
+{
+    const size_t length = count_ascii(str, size);
+    for (size_t i = 0; i < length; ++i)
+        out[i] = static_cast<wchar_t>(str[i]);
+    return length;
+}
+
+static size_t count_ascii(const wchar_t * str, size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
     {
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b2 = get_continuation(it);
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b3 = get_continuation(it);
-        if (++it == end) throw InvalidEncoding();
-        unsigned int b4 = get_continuation(it);
-        return (((b1 - 240) * 64 + (b2 - 128)) * 64 + (b3 - 128)) * 64 + b4 - 128;
+        unsigned int bits = 0;
+        for (size_t j = 0; j < 8; ++j)
+            bits |= static_cast<unsigned int>(str[i + j]);
+        if (bits >= 128)
+            break;
     }
+    return i;
+}
 
-    throw InvalidEncoding();
+static size_t narrow_ascii(const wchar_t * str, size_t size, char * out)
+{
+    const size_t length = count_ascii(str, size);
+    for (size_t i = 0; i < length; ++i)
+        out[i] = static_cast<char>(str[i]);
+    return length;
 }
 
+#endif // PUZ_USE_SSE2
 
-static void unicode_to_utf8(unsigned int cp, std::string & str)
+
+
+// ---------------------------------------------------------------------------
+// UTF-8
+// ---------------------------------------------------------------------------
+
+// Returned for invalid sequences
+static const unsigned int INVALID_CODE_POINT = 0xffffffff;
+
+// Decode the next code point and advance it past it.
+// Invalid sequences (including overlong sequences, surrogates, and code
+// points past U+10FFFF) return INVALID_CODE_POINT and skip one byte.
+static unsigned int utf8_to_unicode(const unsigned char * & it,
+                                    const unsigned char * end)
 {
-    // These conversions would be more elegant with bitshifts and
-    // bit ands, but this works, so whatever.
-    if (cp < 128)
+    const unsigned int b1 = *it++;
+    if (b1 < 0x80) // Ascii
+        return b1;
+    // Continuation bytes, and leads that could only start an overlong
+    // 2-byte sequence or a code point past U+10FFFF.
+    if (b1 < 0xc2 || b1 > 0xf4)
+        return INVALID_CODE_POINT;
+    const size_t length = b1 < 0xe0 ? 2 : b1 < 0xf0 ? 3 : 4;
+    if (static_cast<size_t>(end - it) < length - 1)
+        return INVALID_CODE_POINT;
+    unsigned int cp = b1 & (0x7f >> length);
+    for (size_t i = 0; i < length - 1; ++i)
+    {
+        const unsigned int b = it[i];
+        if ((b & 0xc0) != 0x80)
+            return INVALID_CODE_POINT;
+        cp = (cp << 6) | (b & 0x3f);
+    }
+    if ((length == 3 && cp < 0x800) ||
+        (length == 4 && (cp < 0x10000 || cp > 0x10ffff)) ||
+        (cp >= 0xd800 && cp <= 0xdfff))
     {
-        str.push_back(static_cast<char>(cp));
+        return INVALID_CODE_POINT;
     }
-    else if (cp < 2048) // 2-byte sequence
+    it += length - 1;
+    return cp;
+}
+
+static size_t utf8_length(unsigned int cp)
+{
+    return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+// Write a code point <= U+10FFFF and return the end of the sequence
+static char * unicode_to_utf8(unsigned int cp, char * out)
+{
+    if (cp < 0x80)
     {
-        int b1 = cp / 64;  cp -= b1 * 64;
-        int b2 = cp;
-        str.push_back(static_cast<char>(b1 + 192));
-        str.push_back(static_cast<char>(b2 + 128));
+        *out++ = static_cast<char>(cp);
     }
-    else if (cp < 0xffff) // 3-byte sequence
+    else if (cp < 0x800) // 2-byte sequence
     {
-        int b1 = cp / 64 / 64;  cp -= b1 * 64 * 64;
-        int b2 = cp / 64;       cp -= b2 * 64;
-        int b3 = cp;
-        str.push_back(static_cast<char>(b1 + 224));
-        str.push_back(static_cast<char>(b2 + 128));
-        str.push_back(static_cast<char>(b3 + 128));
+        *out++ = static_cast<char>(0xc0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
     }
-    else if (cp < 0xfffff) // 4-byte sequence
+    else if (cp < 0x10000) // 3-byte sequence
     {
-        int b1 = cp / 64 / 64 / 64;  cp -= b1 * 64 * 64 * 64;
-        int b2 = cp / 64 / 64;       cp -= b2 * 64 * 64;
-        int b3 = cp / 64;            cp -= b3 * 64;
-        int b4 = cp;
-        str.push_back(static_cast<char>(b1 + 240));
-        str.push_back(static_cast<char>(b2 + 128));
-        str.push_back(static_cast<char>(b3 + 128));
-        str.push_back(static_cast<char>(b4 + 128));
+        *out++ = static_cast<char>(0xe0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
     }
-    else
+    else // 4-byte sequence
     {
+        *out++ = static_cast<char>(0xf0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    return out;
+}
+
+#if ! PUZ_UNICODE // Only the narrow string converters use this
+static void unicode_to_utf8(unsigned int cp, std::string & str)
+{
+    if (cp > 0x10ffff)
         throw InvalidEncoding();
+    char buf[4];
+    str.append(buf, unicode_to_utf8(cp, buf));
+}
+#endif // ! PUZ_UNICODE
+
+// Decode the next code point from a wide string.  wchar_t is UTF-16 on
+// Windows and UTF-32 elsewhere.  Unpaired surrogates and code points past
+// U+10FFFF return INVALID_CODE_POINT.
+static unsigned int wide_to_unicode(const wchar_t * & it, const wchar_t * end)
+{
+    const unsigned int lead = static_cast<unsigned int>(*it++);
+    if (lead < 0xd800 || (lead > 0xdfff && lead <= 0x10ffff))
+        return lead;
+    if (lead < 0xdc00 && it != end)
+    {
+        const unsigned int trail = static_cast<unsigned int>(*it);
+        if (trail >= 0xdc00 && trail <= 0xdfff)
+        {
+            ++it;
+            return 0x10000 + ((lead - 0xd800) << 10) + (trail - 0xdc00);
+        }
     }
+    return INVALID_CODE_POINT;
+}
+
+static wchar_t * unicode_to_wide(unsigned int cp, wchar_t * out)
+{
+    if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+    {
+        cp -= 0x10000;
+        *out++ = static_cast<wchar_t>(0xd800 + (cp >> 10));
+        *out++ = static_cast<wchar_t>(0xdc00 + (cp & 0x3ff));
+    }
+    else
+    {
+        *out++ = static_cast<wchar_t>(cp);
+    }
+    return out;
+}
+
+// Write UTF-8 as a wide string, and return the end of the output.
+// There are never more wchar_t than bytes.  Invalid sequences are dropped.
+static wchar_t * utf8_to_wide(const char * data, size_t size, wchar_t * out)
+{
+    const unsigned char * it = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char * end = it + size;
+    for (;;)
+    {
+        const size_t ascii = widen_ascii(reinterpret_cast<const char *>(it),
+                                         end - it, out);
+        it += ascii;
+        out += ascii;
+        for (const unsigned char * stop = next_block(it, end); it < stop; )
+        {
+            const unsigned int cp = utf8_to_unicode(it, end);
+            if (cp != INVALID_CODE_POINT)
+                out = unicode_to_wide(cp, out);
+        }
+        if (it == end)
+            return out;
+    }
+}
+
+static std::wstring utf8_to_wide(const char * data, size_t size)
+{
+    // Short strings are converted on the stack and copied once
+    wchar_t buf[128];
+    if (size <= sizeof(buf) / sizeof(wchar_t))
+        return std::wstring(buf, utf8_to_wide(data, size, buf));
+    std::wstring ret(size, L'\0');
+    ret.resize(utf8_to_wide(data, size, &ret[0]) - ret.data());
+    return ret;
 }
 
 
 #if PUZ_UNICODE
+string_t decode_utf8(const char * data, size_t length)
+{
+    return utf8_to_wide(data, length);
+}
+
 string_t decode_utf8(const std::string & str)
 {
-#else
-std::wstring to_unicode(const std::string & str)
+    return utf8_to_wide(str.data(), str.size());
+}
+
+// The length of a wide string in UTF-8
+static size_t utf8_length(const wchar_t * it, const wchar_t * end)
 {
-#endif // PUZ_UNICODE
-    return pugi::as_wide(str);
+    size_t length = 0;
+    for (;;)
+    {
+        const size_t ascii = count_ascii(it, end - it);
+        it += ascii;
+        length += ascii;
+        for (const wchar_t * stop = next_block(it, end); it < stop; )
+        {
+            const unsigned int cp = wide_to_unicode(it, end);
+            if (cp != INVALID_CODE_POINT)
+                length += utf8_length(cp);
+        }
+        if (it == end)
+            return length;
+    }
 }
 
+// Write a wide string as UTF-8, and return the end of the output.
+// Invalid characters are dropped.
+static char * wide_to_utf8(const wchar_t * it, const wchar_t * end, char * out)
+{
+    for (;;)
+    {
+        const size_t ascii = narrow_ascii(it, end - it, out);
+        it += ascii;
+        out += ascii;
+        for (const wchar_t * stop = next_block(it, end); it < stop; )
+        {
+            const unsigned int cp = wide_to_unicode(it, end);
+            if (cp != INVALID_CODE_POINT)
+                out = unicode_to_utf8(cp, out);
+        }
+        if (it == end)
+            return out;
+    }
+}
 
-#if PUZ_UNICODE
 std::string encode_utf8(const string_t & str)
 {
-    return pugi::as_utf8(str);
+    const wchar_t * begin = str.data();
+    const wchar_t * end = begin + str.size();
+    // Short strings are converted on the stack and copied once.  Longer
+    // strings are measured first, so they are only allocated once.
+    char buf[256];
+    if (str.size() <= sizeof(buf) / 4)
+        return std::string(buf, wide_to_utf8(begin, end, buf));
+    std::string ret(utf8_length(begin, end), '\0');
+    if (! ret.empty())
+        wide_to_utf8(begin, end, &ret[0]);
+    return ret;
 }
 
+#else // ! PUZ_UNICODE
+
+std::wstring to_unicode(const std::string & str)
+{
+    return utf8_to_wide(str.data(), str.size());
+}
+
+// Decode the next code point, and throw if it is invalid.
+static unsigned int utf8_to_unicode(std::string::const_iterator & it,
+                                    std::string::const_iterator end)
+{
+    const unsigned char * begin = reinterpret_cast<const unsigned char *>(&*it);
+    const unsigned char * next = begin;
+    const unsigned int cp =
+        utf8_to_unicode(next, begin + (end - it));
+    if (cp == INVALID_CODE_POINT)
+        throw InvalidEncoding();
+    it += (next - begin) - 1; // The caller advances past the last byte
+    return cp;
+}
 
 #endif // PUZ_UNICODE
 
@@ -151,69 +463,125 @@ std::string encode_utf8(const string_t & str)
 // ---------------------------------------------------------------------------
 
 // Conversion for 127 < ch < 160 (all others < 256 translate the same)
-static unsigned int windowsTable [] = {
+static const unsigned int windowsTable [] = {
     0x20ac,      0, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
     0x02c6, 0x2030, 0x0160, 0x2039, 0x0152,      0, 0x017d,      0,
          0, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
     0x02dc, 0x2122, 0x0161, 0x203a, 0x0153,      0, 0x017e, 0x0178,
 };
 
-static char unicode_to_puz(unsigned int cp)
+static const unsigned int * const windowsTableEnd =
+    windowsTable + sizeof(windowsTable) / sizeof(windowsTable[0]);
+
+// Return the windows-1252 character for a code point, or -1
+static int find_puz_char(unsigned int cp)
 {
     if (cp < 128 || (cp >= 160 && cp <= 255))
-        return static_cast<char>(cp);
+        return static_cast<int>(cp);
+    // Search for the code point in the replacement table
+    const unsigned int * result = std::find(windowsTable, windowsTableEnd, cp);
+    if (result == windowsTableEnd)
+        return -1;
+    return static_cast<int>(result - windowsTable) + 128;
+}
+
+static char unicode_to_puz(unsigned int cp)
+{
+    const int ch = find_puz_char(cp);
+    if (ch < 0)
+        throw InvalidEncoding();
+    return static_cast<char>(ch);
+}
+
+static unsigned int puz_to_unicode(unsigned char ch)
+{
+    if (ch < 128 || ch >= 160)
+        return static_cast<unsigned int>(ch);
     else
+        return windowsTable[ch-128];
+}
+
+#if PUZ_UNICODE
+
+bool can_encode_puz(const string_t & str)
+{
+    const wchar_t * it = str.data();
+    const wchar_t * end = it + str.size();
+    for (;;)
     {
-        // Search for the code point in the replacement table
-        unsigned int * result =
-            std::find(windowsTable,
-                      windowsTable + sizeof(windowsTable),
-                      cp);
-        if (result == windowsTable + sizeof(windowsTable))
-            throw InvalidEncoding();
-        return static_cast<char>(result - windowsTable) + 128;
+        it += count_ascii(it, end - it);
+        for (const wchar_t * stop = next_block(it, end); it < stop; ++it)
+            if (find_puz_char(static_cast<unsigned int>(*it)) < 0)
+                return false;
+        if (it == end)
+            return true;
     }
 }
 
-static bool can_encode_puz(unsigned int cp)
+std::string encode_puz(const string_t & str)
 {
-    if (cp < 128 || (cp >= 160 && cp <= 255))
-        return true;
-    else
+    // Every character is one byte
+    std::string ret(str.size(), '\0');
+    if (str.empty())
+        return ret;
+    char * out = &ret[0];
+    const wchar_t * it = str.data();
+    const wchar_t * end = it + str.size();
+    for (;;)
     {
-        // Search for the code point in the replacement table
-        unsigned int * result =
-            std::find(windowsTable,
-                windowsTable + sizeof(windowsTable),
-                cp);
-        return result != windowsTable + sizeof(windowsTable);
+        const size_t ascii = narrow_ascii(it, end - it, out);
+        it += ascii;
+        out += ascii;
+        for (const wchar_t * stop = next_block(it, end); it < stop; ++it)
+            *out++ = unicode_to_puz(static_cast<unsigned int>(*it));
+        if (it == end)
+            break;
     }
+    return ret;
+}
+
+string_t decode_puz(const char * data, size_t length)
+{
+    string_t ret(length, L'\0');
+    if (length == 0)
+        return ret;
+    wchar_t * out = &ret[0];
+    const char * it = data;
+    const char * end = data + length;
+    for (;;)
+    {
+        const size_t ascii = widen_ascii(it, end - it, out);
+        it += ascii;
+        out += ascii;
+        for (const char * stop = next_block(it, end); it < stop; ++it)
+            *out++ = static_cast<wchar_t>(
+                puz_to_unicode(static_cast<unsigned char>(*it)));
+        if (it == end)
+            break;
+    }
+    return ret;
 }
 
-PUZ_API bool puz::can_encode_puz(const string_t & str) {
+#else // ! PUZ_UNICODE
+
+bool can_encode_puz(const string_t & str)
+{
     string_t::const_iterator it;
     string_t::const_iterator begin = str.begin();
     string_t::const_iterator end = str.end();
     for (it = begin; it != end; ++it)
     {
-#if PUZ_UNICODE
-        if (!can_encode_puz(static_cast<unsigned int>(*it)))
-#else
-        if (!can_encode_puz(utf8_to_unicode(it, end)))
-#endif // PUZ_UNICODE
+        try {
+            if (find_puz_char(utf8_to_unicode(it, end)) < 0)
+                return false;
+        }
+        catch (InvalidEncoding &) {
             return false;
+        }
     }
     return true;
 }
 
-static unsigned int puz_to_unicode(unsigned char ch)
-{
-    if (ch < 128 || ch >= 160)
-        return static_cast<unsigned int>(ch);
-    else
-        return windowsTable[ch-128];
-}
-
 std::string encode_puz(const string_t & str)
 {
     std::string ret;
@@ -223,35 +591,36 @@ std::string encode_puz(const string_t & str)
     string_t::const_iterator begin = str.begin();
     string_t::const_iterator end = str.end();
     for (it = begin; it != end; ++it)
-    {
-#if PUZ_UNICODE
-        ret.push_back(unicode_to_puz(static_cast<unsigned int>(*it)));
-#else
         ret.push_back(unicode_to_puz(utf8_to_unicode(it, end)));
-#endif // PUZ_UNICODE
-    }
     return ret;
 }
 
-string_t decode_puz(const std::string & str)
+string_t decode_puz(const char * data, size_t length)
 {
     string_t ret;
-    ret.reserve(str.size());
-
-    std::string::const_iterator it;
-    std::string::const_iterator begin = str.begin();
-    std::string::const_iterator end = str.end();
-    for (it = begin; it != end; ++it)
+    ret.reserve(length);
+    const char * it = data;
+    const char * end = data + length;
+    for (;;)
     {
-#if PUZ_UNICODE
-        ret.push_back(puz_to_unicode(static_cast<unsigned char>(*it)));
-#else
-        unicode_to_utf8(puz_to_unicode(static_cast<unsigned char>(*it)), ret);
-#endif // PUZ_UNICODE
+        const size_t ascii = count_ascii(it, end - it);
+        ret.append(it, ascii);
+        it += ascii;
+        for (const char * stop = next_block(it, end); it < stop; ++it)
+            unicode_to_utf8(puz_to_unicode(static_cast<unsigned char>(*it)), ret);
+        if (it == end)
+            break;
     }
     return ret;
 }
 
+#endif // PUZ_UNICODE
+
+string_t decode_puz(const std::string & str)
+{
+    return decode_puz(str.data(), str.size());
+}
+
 
 
 // ---------------------------------------------------------------------------
@@ -381,21 +750,24 @@ bool CaseInsensitiveEquals(const string_t& a, const string_t& b)
 //----------------------------------------------------------------------------
 // Convert between formatted / unformatted
 //----------------------------------------------------------------------------
-static size_t GetBrTag(const string_t & str, size_t index);
+static const char_t * GetBrTag(const char_t * it, const char_t * end);
 
 // Puz can take anything that is unformatted, or only
 // has <br /> tags.
 static bool IsOkForPuz(const string_t & str)
 {
-    size_t index = str.find_first_of(puzT("<>"));
-    while (index != string_t::npos)
+    const char_t * it = str.data();
+    const char_t * end = it + str.size();
+    for (; it != end; ++it)
     {
-        if (str[index] == puzT('>'))
-            return false;
-        size_t end = GetBrTag(str, index);
-        if (end == string_t::npos) // Not a <br /> tag.
+        if (*it == puzT('>'))
             return false;
-        index = str.find_first_of(puzT("<>"), end+1);
+        if (*it == puzT('<'))
+        {
+            it = GetBrTag(it, end);
+            if (! it) // Not a <br /> tag.
+                return false;
+        }
     }
     return true;
 }
@@ -405,88 +777,184 @@ std::string GetPuzText(const string_t & str, std::string(*encode_text)(const str
 {
     if (! IsOkForPuz(str))
         throw ConversionError("Puz format does not support XHTML formatting.");
-    return encode_text(unescape_xml(str, UNESCAPE_ALL));
+    string_t buffer;
+    return encode_text(unescape_xml(str, buffer, UNESCAPE_ALL));
 }
 
 //----------------------------------------------------------------------------
 // Escape / unescape XML
 //----------------------------------------------------------------------------
 
-string_t escape_xml(const string_t & str)
+enum
+{
+    XML_ESCAPE    = 1, // Replaced by escape_xml
+    XML_REFERENCE = 2, // Starts a character reference
+    XML_TAG       = 4, // Starts a tag
+    XML_NAME      = 8  // Can appear in a character reference
+};
+
+// Flags for ASCII characters.  Everything else has no flags.
+static const unsigned char xmlCharTable[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0,  // 0-15: \n, \r
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 16-31
+    0, 0, 0, 8, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 32-47: #, &
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 0, 0, 5, 0, 1, 0,  // 48-63: 0-9, <, >
+    0, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,  // 64-79: A-O
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 0, 0, 0, 0, 8,  // 80-95: P-Z, _
+    0, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,  // 96-111: a-o
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 0, 0, 0, 0, 0   // 112-127: p-z
+};
+
+static inline bool IsXmlChar(char_t ch, int flag)
+{
+#if PUZ_UNICODE
+    const unsigned int index = static_cast<unsigned int>(ch);
+#else
+    const unsigned int index = static_cast<unsigned char>(ch);
+#endif
+    return index < 128 && (xmlCharTable[index] & flag) != 0;
+}
+
+// Escape str into out.  Return false if there is nothing to escape.
+static bool EscapeXml(const string_t & str, string_t & out)
 {
     // Replace & with &amp;
     // Replace < with &lt;
     // Replace > with &gt;
     // Replace \r\n | \r | \n with <br />
-    size_t start = 0;
-    size_t index = str.find_first_of(puzT("&<>\r\n"), start);
-    if (index == string_t::npos)
-        return str; // Shortcut if we don't have anything to replace.
-    string_t ret;
-    ret.reserve(int(str.size() * 1.2));
-    while (index != string_t::npos)
+    const char_t * it = str.data();
+    const char_t * end = it + str.size();
+    while (it != end && ! IsXmlChar(*it, XML_ESCAPE))
+        ++it;
+    if (it == end)
+        return false;
+
+    out.clear();
+    out.reserve(str.size() + str.size() / 4 + 8);
+    const char_t * start = str.data();
+    for (; it != end; ++it)
     {
-        ret.append(str.substr(start, index-start));
-        switch (str[index])
+        if (! IsXmlChar(*it, XML_ESCAPE))
+            continue;
+        out.append(start, it);
+        switch (*it)
         {
             case puzT('&'):
-                ret.append(puzT("&amp;"));
+                out.append(puzT("&amp;"));
                 break;
             case puzT('<'):
-                ret.append(puzT("&lt;"));
+                out.append(puzT("&lt;"));
                 break;
             case puzT('>'):
-                ret.append(puzT("&gt;"));
+                out.append(puzT("&gt;"));
                 break;
             // Line breaks
             case puzT('\r'):
-                if (str.substr(index, 2) == puzT("\r\n"))
-                    ++index;
+                if (it + 1 != end && it[1] == puzT('\n'))
+                    ++it;
+                // Fall through
             case puzT('\n'):
-                ret.append(puzT("<br />"));
+                out.append(puzT("<br />"));
                 break;
         }
-        start = index+1;
-        index = str.find_first_of(puzT("&<>\r\n"), start);
+        start = it + 1;
     }
-    ret.append(str.substr(start));
+    out.append(start, end);
+    return true;
+}
+
+string_t escape_xml(const string_t & str)
+{
+    string_t ret;
+    if (! EscapeXml(str, ret))
+        return str;
     return ret;
 }
 
+const string_t & escape_xml(const string_t & str, string_t & buffer)
+{
+    return EscapeXml(str, buffer) ? buffer : str;
+}
 
-// Return the end of the tag or string_t::npos
-size_t GetBrTag(const string_t & str, size_t index)
+
+// it points to a '<'.  If this is a <br> tag, return its '>'.
+// The tag is <br>, or <br/> with whitespace around the slash.  Whitespace
+// without a slash (<br >) is not a tag, as it never has been.
+static const char_t * GetBrTag(const char_t * it, const char_t * end)
 {
-    if (str.substr(index, 3) != puzT("<br"))
-        return string_t::npos;
-    index+=3;
-    size_t end = str.find(puzT('>'), index);
-    if (end == string_t::npos)
-        return string_t::npos;
-    string_t slash = TrimWhitespace(str.substr(index, end - index));
-    if (slash.empty() || slash == puzT("/"))
-        return end;
-    return string_t::npos;
+    if (end - it < 3 || it[1] != puzT('b') || it[2] != puzT('r'))
+        return NULL;
+    const char_t * start = it + 3;
+    bool hasSlash = false;
+    for (it = start; it != end; ++it)
+    {
+        switch (*it)
+        {
+            case puzT('>'):
+                return hasSlash || it == start ? it : NULL;
+            case puzT('/'):
+                if (hasSlash)
+                    return NULL;
+                hasSlash = true;
+                break;
+            case puzT('\n'): case puzT('\f'): case puzT('\r'):
+            case puzT(' '): case puzT('\t'):
+                break;
+            default:
+                return NULL;
+        }
+    }
+    return NULL;
 }
 
 
-unsigned int get_entity_char(const string_t & entity, bool unescape_entities)
+// Named entities, stored by EntityHash.  The hash is perfect for this
+// set of names, so a lookup is one string comparison.
+struct NamedEntity
+{
+    const char * name;
+    size_t length;
+    unsigned int code;
+    bool always; // Safe to unescape without UNESCAPE_ENTITIES
+};
+
+static const NamedEntity namedEntities[8] = {
+    { "lt",   2, '<',  false },
+    { "apos", 4, '\'', true },
+    { "amp",  3, '&',  false },
+    { "gt",   2, '>',  false },
+    { NULL,   0, 0,    false },
+    { NULL,   0, 0,    false },
+    { "quot", 4, '"',  true },
+    { NULL,   0, 0,    false }
+};
+
+static inline size_t EntityHash(const char_t * name, size_t length)
+{
+    return (static_cast<size_t>(name[0]) + static_cast<size_t>(name[1])
+            + length * 4) & 7;
+}
+
+// Return the code point for an entity (without the '&' and ';'), or 0
+static unsigned int get_entity_char(const char_t * name, size_t length,
+                                    bool unescape_entities)
 {
-    size_t length = entity.size();
     if (length < 2)
         return 0;
-    if (entity[0] == puzT('#')) // code point
+    if (name[0] == puzT('#')) // code point
     {
         unsigned int code = 0;
         // Hex
-        if (entity[1] == puzT('x') || entity[1] == puzT('X'))
+        if (name[1] == puzT('x') || name[1] == puzT('X'))
         {
             for (size_t i = 2; i < length; ++i)
             {
-                char_t c = tolower(entity[i]);
+                char_t c = tolower(name[i]);
                 if (! isxdigit(c))
                     return 0;
                 code = code * 16 + (isdigit(c) ? c - 48 : c - 87);
+                if (code > 0x10ffff)
+                    return 0;
             }
         }
         // Decimal
@@ -494,117 +962,124 @@ unsigned int get_entity_char(const string_t & entity, bool unescape_entities)
         {
             for (size_t i = 1; i < length; ++i)
             {
-                char_t c = entity[i];
+                char_t c = name[i];
                 if (! isdigit(c))
                     return 0;
                 code = code * 10 + c - 48;
+                if (code > 0x10ffff)
+                    return 0;
             }
         }
+        // Surrogates aren't characters
+        if (code >= 0xd800 && code <= 0xdfff)
+            return 0;
         return code;
     }
-    // Quotes are always safe to unescape
-    else if (entity == puzT("apos"))
-        return '\'';
-    else if (entity == puzT("quot"))
-        return '"';
-    // These entities could cause problems
-    else if (unescape_entities)
-    {
-        if (entity == puzT("amp"))
-            return '&';
-        else if (entity == puzT("lt"))
-            return '<';
-        else if (entity == puzT("gt"))
-            return '>';
-    }
-    return 0;
+    const NamedEntity & entity = namedEntities[EntityHash(name, length)];
+    if (entity.length != length || ! (entity.always || unescape_entities))
+        return 0;
+    for (size_t i = 0; i < length; ++i)
+        if (name[i] != static_cast<char_t>(entity.name[i]))
+            return 0;
+    return entity.code;
 }
 
-string_t unescape_xml(const string_t & str, int options)
+// Unescape str into out.  Return false if there is nothing to unescape.
+static bool UnescapeXml(const string_t & str, string_t & out, int options)
 {
     // Replace <br /> with \n
     // Replace character references
-    string_t find_chars((options & UNESCAPE_BR) ? puzT("<&") : puzT("&"));
+    const int find_flags = XML_REFERENCE | ((options & UNESCAPE_BR) ? XML_TAG : 0);
     const bool unescape_entities = (options & UNESCAPE_ENTITIES) != 0;
 
-    size_t start = 0;
-    size_t index = str.find_first_of(find_chars, start);
-    if (index == string_t::npos)
-        return str; // Shortcut if we don't have anything to replace.
-    string_t ret;
-    ret.reserve(int(str.size() * 1.2));
-    while (index != string_t::npos)
+    const char_t * it = str.data();
+    const char_t * end = it + str.size();
+    while (it != end && ! IsXmlChar(*it, find_flags))
+        ++it;
+    if (it == end)
+        return false;
+
+    out.clear();
+    out.reserve(str.size());
+    const char_t * start = str.data();
+    while (it != end)
     {
-        ret.append(str.substr(start, index-start));
-        switch (str[index])
+        if (! IsXmlChar(*it, find_flags))
         {
-            // <br />
-            case puzT('<'):
+            ++it;
+            continue;
+        }
+        out.append(start, it);
+        // <br />
+        if (*it == puzT('<'))
+        {
+            const char_t * tag_end = GetBrTag(it, end);
+            if (tag_end)
             {
-                size_t end = GetBrTag(str, index);
-                if (end != string_t::npos)
-                {
-                    // We're using windows line breaks, here's why:
-                    // Across Lite only displays a line break
-                    // on windows if it is \r\n.  I can only
-                    // assume that Across Lite on Linux / Mac
-                    // would display this as one or two line breaks.
-                    // One or two line breaks is better than
-                    // one or *no* line breaks.
-                    ret.append(puzT("\r\n"));
-                    start = end+1;
-                }
-                else
-                {
-                    start = index+1;
-                }
+                // We're using windows line breaks, here's why:
+                // Across Lite only displays a line break
+                // on windows if it is \r\n.  I can only
+                // assume that Across Lite on Linux / Mac
+                // would display this as one or two line breaks.
+                // One or two line breaks is better than
+                // one or *no* line breaks.
+                out.append(puzT("\r\n"));
+                it = start = tag_end + 1;
             }
-                break;
-            // Character references
-            case puzT('&'):
+            else
             {
-                // Scan to the semicolon
-                const char_t * c = str.c_str() + index + 1;
-                for (; (*c >= puzT('a') && *c <= puzT('z')) ||
-                       (*c >= puzT('A') && *c <= puzT('Z')) ||
-                       (*c >= puzT('0') && *c <= puzT('9')) ||
-                       *c == puzT('_') || *c == puzT('#'); c++) {}
-                // Entity must end with a semicolon
-                if (*c != puzT(';'))
-                {
-                    ret.append(1, puzT('&'));
-                    start = index + 1;
-                    break;
-                }
-                // Decode the entity and advance the scan pointer
-                size_t nchars = c - (str.c_str() + index + 1) + 2;
-                // Chop off the '&' and the ';'
-                string_t entity = str.substr(index + 1, nchars - 2);
-                unsigned int entity_char = get_entity_char(entity, unescape_entities);
-                if (entity_char == 0)
-                    ret.append(str.substr(index, nchars));
-                else
-                {
-                    // Depending on the platform, entity_char may or may not be encoded as a single
-                    // character. So we first encode it as UTF-8, and then decode it as a string_t.
-                    std::string entity_str;
-                    unicode_to_utf8(entity_char, entity_str);
+                // Not a <br /> tag: drop the '<'
+                start = ++it;
+            }
+            continue;
+        }
+        // Character references
+        // Scan to the semicolon
+        const char_t * name = it + 1;
+        const char_t * name_end = name;
+        while (name_end != end && IsXmlChar(*name_end, XML_NAME))
+            ++name_end;
+        // Entity must end with a semicolon
+        if (name_end == end || *name_end != puzT(';'))
+        {
+            out.push_back(puzT('&'));
+            start = ++it;
+            continue;
+        }
+        const unsigned int entity_char =
+            get_entity_char(name, name_end - name, unescape_entities);
+        if (entity_char == 0)
+        {
+            out.append(it, name_end + 1);
+        }
+        else
+        {
 #if PUZ_UNICODE
-                    ret.append(decode_utf8(entity_str));
+            wchar_t buf[2];
+            out.append(buf, unicode_to_wide(entity_char, buf));
 #else
-                    ret.append(entity_str);
+            unicode_to_utf8(entity_char, out);
 #endif
-                }
-                start = index + nchars;
-            }
-                break;
         }
-        index = str.find_first_of(find_chars, start);
+        it = start = name_end + 1;
     }
-    ret.append(str.substr(start));
+    out.append(start, end);
+    return true;
+}
+
+string_t unescape_xml(const string_t & str, int options)
+{
+    string_t ret;
+    if (! UnescapeXml(str, ret, options))
+        return str;
     return ret;
 }
 
+const string_t & unescape_xml(const string_t & str, string_t & buffer, int options)
+{
+    return UnescapeXml(str, buffer, options) ? buffer : str;
+}
+
 
 string_t escape_character_references(const string_t & str);
 string_t unescape_character_references(const string_t & str);
@@ -39,6 +39,7 @@ namespace puz {
 
     PUZ_API std::string encode_utf8(const string_t & str);
     PUZ_API string_t decode_utf8(const std::string & str);
+    PUZ_API string_t decode_utf8(const char * data, size_t length);
 
     PUZ_API inline const std::wstring & to_unicode(const string_t & str) { return str; }
 
@@ -59,6 +60,7 @@ namespace puz {
 
     PUZ_API inline const std::string & encode_utf8(const string_t & str) { return str; }
     PUZ_API inline const string_t & decode_utf8(const std::string & str) { return str; }
+    PUZ_API inline string_t decode_utf8(const char * data, size_t length) { return string_t(data, length); }
 
     PUZ_API std::wstring to_unicode(const string_t & str);
 
@@ -71,6 +73,7 @@ namespace puz {
 // puz uses windows-1252 encoding
 PUZ_API std::string encode_puz(const string_t & str);
 PUZ_API string_t decode_puz(const std::string & str);
+PUZ_API string_t decode_puz(const char * data, size_t length);
 
 // Whether the given string can be encoded with windows-1252.
 PUZ_API bool can_encode_puz(const string_t & str);
@@ -103,6 +106,12 @@ enum {
 string_t escape_xml(const string_t & str);
 string_t unescape_xml(const string_t & str, int options = 0);
 
+// Return str if there is nothing to replace, without copying it.
+// Otherwise replace the contents of buffer, and return buffer.
+const string_t & escape_xml(const string_t & str, string_t & buffer);
+const string_t & unescape_xml(const string_t & str, string_t & buffer,
+                              int options = 0);
+
 std::string GetPuzText(const string_t & str, std::string(*encode_text)(const string_t&));
 } // namespace puz
 
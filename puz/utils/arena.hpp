@@ -0,0 +1,188 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_ARENA_H
+#define PUZ_ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace puz {
+
+// A bump allocator.  Memory is allocated from large blocks, and is only
+// freed (all at once) when the arena is destroyed.
+//
+// Destructors of objects created in an arena are never called, so only
+// objects that don't own any resources should be created here.
+class arena
+{
+public:
+    explicit arena(size_t blockSize = 4096)
+        : m_pos(NULL), m_end(NULL), m_blockSize(blockSize)
+    {}
+
+    ~arena()
+    {
+        for (size_t i = 0; i < m_blocks.size(); ++i)
+            delete [] m_blocks[i];
+    }
+
+    void * allocate(size_t size, size_t align = sizeof(void *))
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(m_pos) % align) % align;
+        if (m_pos == NULL || size + pad > static_cast<size_t>(m_end - m_pos))
+        {
+            NewBlock(size + align);
+            pad = (align - reinterpret_cast<size_t>(m_pos) % align) % align;
+        }
+        char * ret = m_pos + pad;
+        m_pos = ret + size;
+        return ret;
+    }
+
+    // Construct an object in the arena
+    template <typename T, typename... Args>
+    T * create(Args &&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T * allocate_array(size_t count)
+    {
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Copy a string into the arena
+    const char * copy(const char * data, size_t size)
+    {
+        char * ret = static_cast<char *>(allocate(size, 1));
+        if (size > 0)
+            memcpy(ret, data, size);
+        return ret;
+    }
+
+private:
+    // Not copyable
+    arena(const arena &);
+    arena & operator=(const arena &);
+
+    // Blocks double in size (up to 1 MB), so the number of blocks grows
+    // slowly with the amount allocated.
+    void NewBlock(size_t minSize)
+    {
+        size_t size = m_blockSize;
+        if (m_blockSize < 1024 * 1024)
+            m_blockSize *= 2;
+        if (size < minSize)
+            size = minSize;
+        m_blocks.push_back(new char[size]);
+        m_pos = m_blocks.back();
+        m_end = m_pos + size;
+    }
+
+    char * m_pos;
+    char * m_end;
+    size_t m_blockSize;
+    std::vector<char *> m_blocks;
+};
+
+
+// A vector whose memory comes from an arena.  Only for types that can be
+// copied with memcpy.  Memory is not reused when the vector grows.
+template <typename T>
+class arena_vector
+{
+public:
+    typedef T value_type;
+    typedef T * iterator;
+    typedef const T * const_iterator;
+
+    explicit arena_vector(arena & a)
+        : m_arena(a), m_data(NULL), m_size(0), m_capacity(0)
+    {}
+
+    iterator begin() { return m_data; }
+    iterator end()   { return m_data + m_size; }
+    const_iterator begin() const { return m_data; }
+    const_iterator end()   const { return m_data + m_size; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T & operator[](size_t i) { return m_data[i]; }
+    const T & operator[](size_t i) const { return m_data[i]; }
+
+    arena & get_arena() { return m_arena; }
+
+    void reserve(size_t count)
+    {
+        if (count <= m_capacity)
+            return;
+        T * data = m_arena.allocate_array<T>(count);
+        if (m_size > 0)
+            memcpy(static_cast<void *>(data), m_data, m_size * sizeof(T));
+        m_data = data;
+        m_capacity = count;
+    }
+
+    void push_back(const T & val)
+    {
+        if (m_size == m_capacity)
+            reserve(m_capacity == 0 ? 4 : m_capacity * 2);
+        m_data[m_size++] = val;
+    }
+
+    iterator insert(iterator pos, const T & val)
+    {
+        const size_t index = pos - m_data;
+        if (m_size == m_capacity)
+            reserve(m_capacity == 0 ? 4 : m_capacity * 2);
+        memmove(static_cast<void *>(m_data + index + 1), m_data + index,
+                (m_size - index) * sizeof(T));
+        m_data[index] = val;
+        ++m_size;
+        return m_data + index;
+    }
+
+    void erase(iterator pos)
+    {
+        memmove(static_cast<void *>(pos), pos + 1, (end() - pos - 1) * sizeof(T));
+        --m_size;
+    }
+
+    // Replace the contents with exactly [first, last)
+    void assign(const T * first, const T * last)
+    {
+        m_size = m_capacity = last - first;
+        m_data = m_size == 0 ? NULL : m_arena.allocate_array<T>(m_size);
+        if (m_size > 0)
+            memcpy(static_cast<void *>(m_data), first, m_size * sizeof(T));
+    }
+
+private:
+    arena & m_arena;
+    T * m_data;
+    size_t m_size;
+    size_t m_capacity;
+};
+
+} // namespace puz
+
+#endif // PUZ_ARENA_H
@@ -0,0 +1,142 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PUZ_BUFFER_READER_H
+#define PUZ_BUFFER_READER_H
+
+#include <string>
+#include <cstring>
+
+namespace puz {
+
+// A range of bytes in a buffer.  Spans don't own their data.
+class byte_span
+{
+public:
+    byte_span() : m_data(NULL), m_size(0) {}
+    byte_span(const char * data, size_t size) : m_data(data), m_size(size) {}
+
+    const char * data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const char * begin() const { return m_data; }
+    const char * end() const { return m_data + m_size; }
+    char operator[](size_t i) const { return m_data[i]; }
+
+    std::string str() const { return std::string(m_data, m_size); }
+
+private:
+    const char * m_data;
+    size_t m_size;
+};
+
+
+// Reads little-endian binary data from a buffer without copying.
+//
+// Reading past the end of the buffer doesn't throw: it returns 0 (or an
+// empty span) and sets the fail flag, which stays set.  Check Fail() after
+// a group of reads.
+class buffer_reader
+{
+public:
+    buffer_reader(const char * data, size_t size)
+        : m_pos(data), m_end(data + size), m_fail(false)
+    {}
+
+    explicit buffer_reader(const byte_span & span)
+        : m_pos(span.data()), m_end(span.data() + span.size()), m_fail(false)
+    {}
+
+    bool Fail() const { return m_fail; }
+    bool Eof() const { return m_pos == m_end; }
+    size_t Remaining() const { return m_end - m_pos; }
+
+    void Skip(size_t bytes)
+    {
+        Read(bytes);
+    }
+
+    unsigned char ReadChar()
+    {
+        if (m_pos == m_end)
+        {
+            m_fail = true;
+            return 0;
+        }
+        return static_cast<unsigned char>(*m_pos++);
+    }
+
+    unsigned short ReadShort()
+    {
+        // Always little-endian
+        const unsigned short lo_byte = ReadChar();
+        const unsigned short hi_byte = ReadChar();
+        return (hi_byte << 8) + lo_byte;
+    }
+
+    unsigned int ReadLong()
+    {
+        const unsigned int lo_short = ReadShort();
+        const unsigned int hi_short = ReadShort();
+        return (hi_short << 16) + lo_short;
+    }
+
+    // Read exactly length bytes
+    byte_span Read(size_t length)
+    {
+        if (length > Remaining())
+        {
+            m_fail = true;
+            m_pos = m_end;
+            return byte_span();
+        }
+        byte_span span(m_pos, length);
+        m_pos += length;
+        return span;
+    }
+
+    byte_span ReadRest()
+    {
+        return Read(Remaining());
+    }
+
+    // Read up to delim, and skip the delim.
+    // If there is no delim, return the rest of the buffer and set Fail().
+    byte_span ReadString(char delim = '\0')
+    {
+        const char * found = Eof() ? NULL : static_cast<const char *>(
+            std::memchr(m_pos, delim, Remaining()));
+        if (! found)
+        {
+            m_fail = true;
+            return ReadRest();
+        }
+        byte_span span(m_pos, found - m_pos);
+        m_pos = found + 1;
+        return span;
+    }
+
+private:
+    const char * m_pos;
+    const char * m_end;
+    bool m_fail;
+};
+
+} // namespace puz
+
+#endif // PUZ_BUFFER_READER_H
@@ -0,0 +1,119 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_BUFFER_WRITER_H
+#define PUZ_BUFFER_WRITER_H
+
+#include <string>
+#include <cstring>
+
+namespace puz {
+
+// Writes little-endian binary data into a growing buffer.
+//
+// Everything is written to memory, so values that depend on later data
+// (lengths, checksums) can be left blank and filled in with WriteAt.
+class buffer_writer
+{
+public:
+    buffer_writer() {}
+    explicit buffer_writer(size_t reserve) { m_buffer.reserve(reserve); }
+
+    const char * data() const { return m_buffer.data(); }
+    size_t size() const { return m_buffer.size(); }
+    const std::string & str() const { return m_buffer; }
+
+    void Skip(size_t bytes)
+    {
+        m_buffer.append(bytes, '\0');
+    }
+
+    void Put(unsigned char ch)
+    {
+        m_buffer.push_back(static_cast<char>(ch));
+    }
+
+    void Write(const char * chars, size_t size)
+    {
+        m_buffer.append(chars, size);
+    }
+
+    void Write(const unsigned char * chars, size_t size)
+    {
+        m_buffer.append(reinterpret_cast<const char*>(chars), size);
+    }
+
+    void Write(unsigned short num)
+    {
+        // Always little-endian
+        Put(num & 0x00ff);
+        Put((num & 0xff00) >> 8);
+    }
+
+    void WriteLong(unsigned int num)
+    {
+        Write(static_cast<unsigned short>(num & 0xffff));
+        Write(static_cast<unsigned short>(num >> 16));
+    }
+
+    void Write(const std::string & str)
+    {
+        m_buffer.append(str);
+    }
+
+    void WriteNulTerminated(const std::string & str)
+    {
+        m_buffer.append(str.c_str(), str.size() + 1);
+    }
+
+    // Overwrite data that has already been written
+    void WriteAt(size_t pos, const char * chars, size_t size)
+    {
+        std::memcpy(&m_buffer[pos], chars, size);
+    }
+
+    void WriteAt(size_t pos, const unsigned char * chars, size_t size)
+    {
+        std::memcpy(&m_buffer[pos], chars, size);
+    }
+
+    void WriteAt(size_t pos, unsigned short num)
+    {
+        m_buffer[pos] = static_cast<char>(num & 0x00ff);
+        m_buffer[pos + 1] = static_cast<char>((num & 0xff00) >> 8);
+    }
+
+    void WriteLongAt(size_t pos, unsigned int num)
+    {
+        WriteAt(pos, static_cast<unsigned short>(num & 0xffff));
+        WriteAt(pos + 2, static_cast<unsigned short>(num >> 16));
+    }
+
+    // Discard everything after size
+    void Truncate(size_t size)
+    {
+        m_buffer.resize(size);
+    }
+
+private:
+    std::string m_buffer;
+};
+
+} // namespace puz
+
+#endif // PUZ_BUFFER_WRITER_H
@@ -0,0 +1,164 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "filemap.hpp"
+#include <fstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace puz {
+
+file_map::file_map()
+    : m_data(NULL),
+      m_size(0),
+      m_isMapped(false)
+#ifdef _WIN32
+      , m_mapping(NULL)
+#endif
+{
+}
+
+file_map::~file_map()
+{
+    Close();
+}
+
+void
+file_map::Close()
+{
+    if (m_isMapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+#else
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_isMapped = false;
+    std::vector<char>().swap(m_buffer);
+}
+
+// Read the file into memory
+static bool ReadWholeFile(const std::string & filename, std::vector<char> & buffer)
+{
+    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+    if (stream.fail())
+        return false;
+    char chunk[4096];
+    while (stream.read(chunk, sizeof(chunk)) || stream.gcount() > 0)
+        buffer.insert(buffer.end(), chunk, chunk + stream.gcount());
+    return ! stream.bad();
+}
+
+bool
+file_map::Open(const std::string & filename)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY,
+                                            0, 0, NULL);
+        if (mapping)
+        {
+            void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (data)
+            {
+                CloseHandle(file);
+                m_mapping = mapping;
+                m_data = static_cast<const char *>(data);
+                m_size = static_cast<size_t>(size.QuadPart);
+                m_isMapped = true;
+                return true;
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void * data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            close(fd);
+            m_data = static_cast<const char *>(data);
+            m_size = st.st_size;
+            m_isMapped = true;
+            return true;
+        }
+    }
+    close(fd);
+#endif
+    // Empty files and files that can't be mapped
+    if (! ReadWholeFile(filename, m_buffer))
+        return false;
+    m_data = m_buffer.empty() ? NULL : &m_buffer[0];
+    m_size = m_buffer.size();
+    return true;
+}
+
+bool
+WriteWholeFile(const std::string & filename, const char * data, size_t size)
+{
+    const std::string temp = filename + ".tmp";
+    {
+        std::ofstream stream(temp.c_str(), std::ios::out | std::ios::binary);
+        if (stream.fail())
+            return false;
+        stream.write(data, size);
+        stream.close();
+        if (stream.fail())
+        {
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename won't replace an existing file on Windows
+    const bool ok = MoveFileExA(temp.c_str(), filename.c_str(),
+                                MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool ok = std::rename(temp.c_str(), filename.c_str()) == 0;
+#endif
+    if (! ok)
+        std::remove(temp.c_str());
+    return ok;
+}
+
+} // namespace puz
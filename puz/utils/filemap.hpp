@@ -0,0 +1,65 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#ifndef PUZ_FILE_MAP_H
+#define PUZ_FILE_MAP_H
+
+#include <string>
+#include <vector>
+
+namespace puz {
+
+// A read-only view of a whole file.
+// The file is memory-mapped if possible, otherwise it is read into memory.
+class file_map
+{
+public:
+    file_map();
+    ~file_map();
+
+    // Return false if the file can't be opened
+    bool Open(const std::string & filename);
+    void Close();
+
+    const char * data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    // Not copyable
+    file_map(const file_map &);
+    file_map & operator=(const file_map &);
+
+    const char * m_data;
+    size_t m_size;
+    bool m_isMapped;
+    // Used if the file can't be mapped
+    std::vector<char> m_buffer;
+#ifdef _WIN32
+    void * m_mapping; // HANDLE
+#endif
+};
+
+// Replace the contents of a file.
+// The data is written to a temporary file, which is then renamed over
+// filename, so the file is never left half-written.
+// Return false if the file can't be written.
+bool WriteWholeFile(const std::string & filename,
+                    const char * data, size_t size);
+
+} // namespace puz
+
+#endif // PUZ_FILE_MAP_H
@@ -0,0 +1,82 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#ifndef PUZ_MEMORY_STREAM_H
+#define PUZ_MEMORY_STREAM_H
+
+#include <istream>
+#include <streambuf>
+
+namespace puz {
+
+// A read-only streambuf over a block of memory.  The data is not copied,
+// so it must outlive the streambuf.
+class memory_streambuf : public std::streambuf
+{
+public:
+    memory_streambuf(const char * data, size_t size)
+    {
+        char * begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                             std::ios_base::openmode which = std::ios_base::in)
+    {
+        if (! (which & std::ios_base::in))
+            return pos_type(off_type(-1));
+        char * pos;
+        if (dir == std::ios_base::beg)
+            pos = eback() + off;
+        else if (dir == std::ios_base::cur)
+            pos = gptr() + off;
+        else
+            pos = egptr() + off;
+        if (pos < eback() || pos > egptr())
+            return pos_type(off_type(-1));
+        setg(eback(), pos, egptr());
+        return pos_type(pos - eback());
+    }
+
+    virtual pos_type seekpos(pos_type pos,
+                             std::ios_base::openmode which = std::ios_base::in)
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+
+// An istream that reads from memory
+class memory_istream : public std::istream
+{
+public:
+    memory_istream(const char * data, size_t size)
+        : std::istream(NULL),
+          m_buf(data, size)
+    {
+        rdbuf(&m_buf);
+    }
+
+private:
+    memory_streambuf m_buf;
+};
+
+} // namespace puz
+
+#endif // PUZ_MEMORY_STREAM_H
@@ -16,6 +16,7 @@
 // Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 #include "minizip.hpp"
+#include <cstring>
 
 // ---------------------------------------------------------------------------
 // UNZIP
@@ -47,6 +48,14 @@ std::string File::GetName()
     return std::string(name);
 }
 
+size_t File::GetSize()
+{
+    unz_file_info info;
+    if (unzGetCurrentFileInfo(m_archive, &info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+        return 0;
+    return info.uncompressed_size;
+}
+
 bool File::First()
 {
     Close();
@@ -80,7 +89,89 @@ void File::SetArchive(unzFile archive)
 bool Archive::Open(const std::string & filename)
 {
     Close();
-    m_handle = unzOpen(filename.c_str());
+    return SetHandle(unzOpen(filename.c_str()));
+}
+
+// minizip io functions for archives in memory
+static voidpf ZCALLBACK mem_open(voidpf opaque, const char *, int mode)
+{
+    if (mode & ZLIB_FILEFUNC_MODE_WRITE)
+        return NULL;
+    Archive::MemoryFile * file = static_cast<Archive::MemoryFile *>(opaque);
+    file->pos = 0;
+    return file;
+}
+
+static uLong ZCALLBACK mem_read(voidpf, voidpf stream, void * buf, uLong size)
+{
+    Archive::MemoryFile * file = static_cast<Archive::MemoryFile *>(stream);
+    const size_t remaining = file->size - file->pos;
+    if (size > remaining)
+        size = remaining;
+    if (size > 0)
+        memcpy(buf, file->data + file->pos, size);
+    file->pos += size;
+    return size;
+}
+
+static uLong ZCALLBACK mem_write(voidpf, voidpf, const void *, uLong)
+{
+    return 0;
+}
+
+static long ZCALLBACK mem_tell(voidpf, voidpf stream)
+{
+    return static_cast<long>(static_cast<Archive::MemoryFile *>(stream)->pos);
+}
+
+static long ZCALLBACK mem_seek(voidpf, voidpf stream, uLong offset, int origin)
+{
+    Archive::MemoryFile * file = static_cast<Archive::MemoryFile *>(stream);
+    size_t pos;
+    switch (origin)
+    {
+        case ZLIB_FILEFUNC_SEEK_SET: pos = offset; break;
+        case ZLIB_FILEFUNC_SEEK_CUR: pos = file->pos + offset; break;
+        case ZLIB_FILEFUNC_SEEK_END: pos = file->size + offset; break;
+        default: return -1;
+    }
+    if (pos > file->size)
+        return -1;
+    file->pos = pos;
+    return 0;
+}
+
+static int ZCALLBACK mem_close(voidpf, voidpf)
+{
+    return 0;
+}
+
+static int ZCALLBACK mem_error(voidpf, voidpf)
+{
+    return 0;
+}
+
+bool Archive::Open(const char * data, size_t size)
+{
+    Close();
+    m_memory.data = data;
+    m_memory.size = size;
+    m_memory.pos = 0;
+    zlib_filefunc_def funcs;
+    funcs.zopen_file = mem_open;
+    funcs.zread_file = mem_read;
+    funcs.zwrite_file = mem_write;
+    funcs.ztell_file = mem_tell;
+    funcs.zseek_file = mem_seek;
+    funcs.zclose_file = mem_close;
+    funcs.zerror_file = mem_error;
+    funcs.opaque = &m_memory;
+    return SetHandle(unzOpen2(NULL, &funcs));
+}
+
+bool Archive::SetHandle(unzFile handle)
+{
+    m_handle = handle;
     if (m_handle)
     {
         m_currentFile.SetArchive(m_handle);
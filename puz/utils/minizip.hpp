@@ -121,6 +121,8 @@ public:
     bool Open();
     bool Close();
     std::string GetName();
+    // Uncompressed size
+    size_t GetSize();
 
     bool First();
     bool Next();
@@ -157,6 +159,9 @@ public:
     ~Archive() { Close(); }
 
     bool Open(const std::string & filename);
+    // Open an archive in memory.  The data is not copied, so it must stay
+    // valid until the archive is closed.
+    bool Open(const char * data, size_t size);
     int GetFileCount();
     bool Close();
 
@@ -164,10 +169,21 @@ public:
 
     operator void * () const { return m_isOk ? m_handle : NULL; }
 
+    // The "file" used by the minizip io functions for archives in memory
+    struct MemoryFile
+    {
+        const char * data;
+        size_t size;
+        size_t pos;
+    };
+
 protected:
     unzFile m_handle;
     File m_currentFile;
     bool m_isOk;
+    MemoryFile m_memory;
+
+    bool SetHandle(unzFile handle);
 };
 
 } // namespace unzip
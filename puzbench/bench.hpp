@@ -0,0 +1,95 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// puzbench: timings for the puz library.
+//
+// Usage: puzbench [name ...]
+//
+// Runs every benchmark, or only the ones named, and prints the average
+// time per call (or per item, e.g. per square).  Compare the output of a
+// build before and after a change on the same machine.
+
+#ifndef PUZBENCH_BENCH_H
+#define PUZBENCH_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace puz {
+    class Grid;
+    class Puzzle;
+}
+
+namespace puzbench {
+
+typedef void (*bench_func)();
+
+// Adds a benchmark to the list that main() runs
+struct Register
+{
+    Register(const char * name, bench_func func);
+};
+
+#define PUZBENCH(name) \
+    static void bench_##name(); \
+    static puzbench::Register register_##name(#name, bench_##name); \
+    static void bench_##name()
+
+// Benchmarks add their results here so that the work isn't optimized away
+extern volatile size_t sink;
+
+void Report(const std::string & label, double seconds,
+            size_t calls, size_t items);
+
+// Call func repeatedly for at least 0.2 seconds, and print the average
+// time per call, or per item if each call handles more than one.
+template <typename FUNC>
+void Time(const std::string & label, FUNC func, size_t items = 1)
+{
+    typedef std::chrono::steady_clock clock_type;
+    func(); // Warm up
+    size_t calls = 0;
+    size_t batch = 1;
+    double seconds = 0;
+    const clock_type::time_point start = clock_type::now();
+    do {
+        for (size_t i = 0; i < batch; ++i)
+            func();
+        calls += batch;
+        batch *= 2;
+        seconds = std::chrono::duration<double>(
+            clock_type::now() - start).count();
+    } while (seconds < 0.2);
+    Report(label, seconds, calls, items);
+}
+
+// Set up a width x height grid with a regular pattern of black squares and
+// a solution of repeating letters.  Every other white square is filled in,
+// and every seventh filled square is wrong.
+void FillGrid(puz::Grid & grid, size_t width, size_t height);
+
+// A puzzle with a FillGrid grid, numbered, with a clue for every word
+void MakePuzzle(puz::Puzzle * puz, size_t width, size_t height);
+
+// "label WxH"
+std::string Label(const std::string & label, size_t width, size_t height);
+
+} // namespace puzbench
+
+#endif // PUZBENCH_BENCH_H
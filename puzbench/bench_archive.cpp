@@ -0,0 +1,90 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Archives: opening an archive reads only its index, compared to opening
+// each puzzle file.
+
+#include "bench.hpp"
+#include "puz/Archive.hpp"
+#include "puz/Puzzle.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace puzbench;
+
+static std::string ReadFile(const std::string & filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+}
+
+PUZBENCH(archive)
+{
+    const char * filename = "puzbench_archive.xwa";
+    const char * puzfile = "puzbench_archive.puz";
+    const unsigned int count = 250;
+
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 15, 15);
+    puz.Save(puzfile);
+    const std::string data = ReadFile(puzfile);
+
+    remove(filename);
+    {
+        puz::Archive archive;
+        archive.Open(filename, true);
+        for (unsigned int i = 0; i < count; ++i)
+            archive.Append("bench", 20200101 + i, "puz", data.data(), data.size());
+    }
+
+    Time("Open, GetEntries", [&]() {
+        puz::Archive archive;
+        archive.Open(filename);
+        sink += archive.GetEntries().size();
+    }, count);
+
+    // What the archive replaces: loading one file per puzzle
+    Time("Puzzle::Load, one file", [&]() {
+        puz::Puzzle loaded(puzfile);
+        sink += loaded.GetGrid().GetWidth();
+    });
+
+    puz::Archive archive;
+    archive.Open(filename);
+    Time("Find", [&]() {
+        size_t n = 0;
+        for (unsigned int i = 0; i < count; ++i)
+            n += archive.Find("bench", 20200101 + i) != NULL;
+        sink += n;
+    }, count);
+
+    Time("Find, Load", [&]() {
+        puz::Puzzle loaded;
+        archive.Load(&loaded, *archive.Find("bench", 20200101 + count / 2));
+        sink += loaded.GetGrid().GetWidth();
+    });
+    archive.Close();
+
+    remove(filename);
+    remove(puzfile);
+}
@@ -0,0 +1,59 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Checking the grid: Square::Check on every square (as XGridCtrl used to)
+// compared with the packed Grid::CheckGrid.
+
+#include "bench.hpp"
+#include "puz/Grid.hpp"
+
+#include <vector>
+
+using namespace puzbench;
+
+static const size_t sizes[][2] = { { 15, 15 }, { 25, 25 }, { 100, 100 } };
+
+PUZBENCH(check_grid)
+{
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const size_t width = sizes[i][0];
+        const size_t height = sizes[i][1];
+        puz::Grid grid;
+        FillGrid(grid, width, height);
+        const puz::Grid & cgrid = grid;
+
+        Time(Label("Square::Check, every square", width, height), [&]() {
+            size_t n = 0;
+            for (const puz::Square * square = cgrid.First(); square; square = square->Next())
+                n += ! square->Check();
+            sink += n;
+        }, width * height);
+
+        std::vector<unsigned char> incorrect;
+        Time(Label("Grid::CheckGrid", width, height), [&]() {
+            cgrid.CheckGrid(&incorrect);
+            sink += incorrect[0];
+        }, width * height);
+
+        Time(Label("Grid::CheckGrid, strict, check blank", width, height), [&]() {
+            cgrid.CheckGrid(&incorrect, true, true);
+            sink += incorrect[0];
+        }, width * height);
+    }
+}
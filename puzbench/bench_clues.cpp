@@ -0,0 +1,64 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// ClueList::Find on an acrostic-sized list.  XGridDrawer looks up the clue
+// for every numbered square, and most of those lookups miss.
+
+#include "bench.hpp"
+#include "puz/Clue.hpp"
+
+using namespace puzbench;
+
+PUZBENCH(clue_index)
+{
+    const int count = 250;
+    puz::ClueList clues;
+    for (int i = 1; i <= count; ++i)
+        clues.push_back(puz::Clue(i, puzT("Clue")));
+    const puz::ClueList & cclues = clues;
+
+    Time("Find(int), hit", [&]() {
+        size_t n = 0;
+        for (int i = 1; i <= count; ++i)
+            n += cclues.Find(i) != NULL;
+        sink += n;
+    }, count);
+
+    Time("Find(int), miss", [&]() {
+        size_t n = 0;
+        for (int i = count + 1; i <= 2 * count; ++i)
+            n += cclues.Find(i) != NULL;
+        sink += n;
+    }, count);
+
+    const puz::string_t number = puzT("125");
+    Time("Find(string), hit", [&]() {
+        sink += cclues.Find(number) != NULL;
+    });
+
+    const puz::string_t missing = puzT("A");
+    Time("Find(string), miss", [&]() {
+        sink += cclues.Find(missing) != NULL;
+    });
+
+    // Renumbering forces a rebuild on the next lookup
+    Time("SetNumber, Find(int)", [&]() {
+        clues[0].SetNumber(1);
+        sink += cclues.Find(1) != NULL;
+    });
+}
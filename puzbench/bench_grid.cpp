@@ -0,0 +1,71 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Full-grid scans: the access pattern of drawing, checking, and saving.
+
+#include "bench.hpp"
+#include "puz/Grid.hpp"
+
+using namespace puzbench;
+
+static const size_t sizes[][2] = { { 15, 15 }, { 25, 25 }, { 100, 100 } };
+
+PUZBENCH(grid_scan)
+{
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const size_t width = sizes[i][0];
+        const size_t height = sizes[i][1];
+        puz::Grid grid;
+        FillGrid(grid, width, height);
+
+        // Linked-list walk
+        Time(Label("First/Next, IsWhite", width, height), [&]() {
+            size_t n = 0;
+            for (puz::Square * square = grid.First(); square; square = square->Next())
+                n += square->IsWhite();
+            sink += n;
+        }, width * height);
+
+        // Row-major indexing
+        Time(Label("At(col, row), IsWhite", width, height), [&]() {
+            size_t n = 0;
+            for (size_t row = 0; row < height; ++row)
+                for (size_t col = 0; col < width; ++col)
+                    n += grid.At(col, row).IsWhite();
+            sink += n;
+        }, width * height);
+
+        // Column-major indexing (down words)
+        Time(Label("At(col, row) by column", width, height), [&]() {
+            size_t n = 0;
+            for (size_t col = 0; col < width; ++col)
+                for (size_t row = 0; row < height; ++row)
+                    n += grid.At(col, row).IsWhite();
+            sink += n;
+        }, width * height);
+
+        // Text and solution comparison
+        Time(Label("First/Next, Check", width, height), [&]() {
+            size_t n = 0;
+            for (puz::Square * square = grid.First(); square; square = square->Next())
+                n += square->IsWhite() && square->Check();
+            sink += n;
+        }, width * height);
+    }
+}
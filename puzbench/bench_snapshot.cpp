@@ -0,0 +1,61 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// AutoSave: writing and restoring a snapshot, compared to saving the
+// puzzle in its own format.
+
+#include "bench.hpp"
+#include "puz/Snapshot.hpp"
+#include "puz/Puzzle.hpp"
+
+#include <cstdio>
+
+using namespace puzbench;
+
+static const size_t sizes[][2] = { { 15, 15 }, { 25, 25 } };
+
+PUZBENCH(snapshot)
+{
+    const char * snapshot = "puzbench_snapshot.xws";
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const size_t width = sizes[i][0];
+        const size_t height = sizes[i][1];
+        puz::Puzzle puz;
+        MakePuzzle(&puz, width, height);
+
+        Time(Label("SaveSnapshot", width, height), [&]() {
+            puz::SaveSnapshot(puz, snapshot);
+        });
+
+        Time(Label("LoadSnapshot", width, height), [&]() {
+            sink += puz::LoadSnapshot(&puz, snapshot);
+        });
+
+        Time(Label("Save jpz", width, height), [&]() {
+            puz.Save("puzbench_snapshot.jpz");
+        });
+
+        Time(Label("Save puz", width, height), [&]() {
+            puz.Save("puzbench_snapshot.puz");
+        });
+    }
+    remove(snapshot);
+    remove("puzbench_snapshot.jpz");
+    remove("puzbench_snapshot.puz");
+}
@@ -0,0 +1,62 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Puzzle::FindWord and FindClue: called for every square when drawing the
+// grid and whenever the focus moves.
+
+#include "bench.hpp"
+#include "puz/Puzzle.hpp"
+
+using namespace puzbench;
+
+static const size_t sizes[][2] = { { 15, 15 }, { 25, 25 }, { 100, 100 } };
+
+PUZBENCH(word_index)
+{
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const size_t width = sizes[i][0];
+        const size_t height = sizes[i][1];
+        puz::Puzzle puz;
+        MakePuzzle(&puz, width, height);
+        const puz::Puzzle & cpuz = puz;
+        const puz::Grid & grid = puz.GetGrid();
+
+        Time(Label("FindWord, every square", width, height), [&]() {
+            size_t n = 0;
+            for (const puz::Square * square = grid.First(); square; square = square->Next())
+                n += cpuz.FindWord(square, puz::ACROSS) != NULL;
+            sink += n;
+        }, width * height);
+
+        Time(Label("FindClue, every square", width, height), [&]() {
+            size_t n = 0;
+            for (const puz::Square * square = grid.First(); square; square = square->Next())
+                n += cpuz.FindClue(square) != NULL;
+            sink += n;
+        }, width * height);
+
+        // A word change forces a rebuild on the next lookup
+        puz::Clue & clue = puz.GetClues().GetAcross().front();
+        const puz::Word word = clue.GetWord();
+        Time(Label("SetWord, FindClue", width, height), [&]() {
+            clue.SetWord(word);
+            sink += cpuz.FindClue(grid.First()) != NULL;
+        });
+    }
+}
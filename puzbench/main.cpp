@@ -0,0 +1,115 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "bench.hpp"
+#include "puz/Puzzle.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace puzbench {
+
+volatile size_t sink = 0;
+
+typedef std::pair<const char *, bench_func> bench_t;
+
+static std::vector<bench_t> & GetBenchmarks()
+{
+    static std::vector<bench_t> benchmarks;
+    return benchmarks;
+}
+
+Register::Register(const char * name, bench_func func)
+{
+    GetBenchmarks().push_back(bench_t(name, func));
+}
+
+void Report(const std::string & label, double seconds,
+            size_t calls, size_t items)
+{
+    const double ns = seconds * 1e9 / calls / items;
+    printf("  %-44s %12.1f ns%s\n", label.c_str(), ns,
+           items > 1 ? " per item" : "");
+    fflush(stdout);
+}
+
+std::string Label(const std::string & label, size_t width, size_t height)
+{
+    char size[32];
+    sprintf(size, " %dx%d", static_cast<int>(width), static_cast<int>(height));
+    return label + size;
+}
+
+void FillGrid(puz::Grid & grid, size_t width, size_t height)
+{
+    grid.SetSize(width, height);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        const int col = square->GetCol();
+        const int row = square->GetRow();
+        // Isolated black squares, so every white square is in two words
+        if (col % 4 == 3 && row % 4 == 3)
+        {
+            square->SetSolution(puz::Square::Black);
+            continue;
+        }
+        const puz::char_t letter = puzT('A') + i % 26;
+        square->SetSolution(puz::string_t(1, letter));
+        if (i % 2 == 0)
+        {
+            const bool wrong = i % 14 == 0;
+            square->SetText(puz::string_t(1, wrong ? puzT('A') + (i + 1) % 26
+                                                   : letter));
+        }
+    }
+}
+
+void MakePuzzle(puz::Puzzle * puz, size_t width, size_t height)
+{
+    FillGrid(puz->GetGrid(), width, height);
+    std::vector<puz::string_t> clues;
+    for (puz::Square * square = puz->GetGrid().First(); square; square = square->Next())
+    {
+        if (square->SolutionWantsClue(puz::ACROSS))
+            clues.push_back(puzT("Across clue"));
+        if (square->SolutionWantsClue(puz::DOWN))
+            clues.push_back(puzT("Down clue"));
+    }
+    puz->SetAllClues(clues);
+}
+
+} // namespace puzbench
+
+int main(int argc, char * argv[])
+{
+    using namespace puzbench;
+    const std::vector<bench_t> & benchmarks = GetBenchmarks();
+    for (size_t i = 0; i < benchmarks.size(); ++i)
+    {
+        bool run = argc < 2;
+        for (int arg = 1; arg < argc && ! run; ++arg)
+            run = strcmp(argv[arg], benchmarks[i].first) == 0;
+        if (! run)
+            continue;
+        printf("%s\n", benchmarks[i].first);
+        benchmarks[i].second();
+    }
+    return 0;
+}
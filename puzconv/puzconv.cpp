@@ -0,0 +1,480 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// puzconv: convert or validate many puzzles at once.
+//
+// Usage: puzconv [options] <file or glob> ...
+//
+// Each file is reported on its own line as a JSON object, followed by a
+// summary line with the totals and throughput.
+//
+// Puzzles can also be packed into an archive (see puz/Archive.hpp), using
+// the download manager's file names (e.g. nyt20120101.puz) for the source
+// and date, and archives can be compacted.
+
+#include "puz/Puzzle.hpp"
+#include "puz/Scan.hpp"
+#include "puz/Archive.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <glob.h>
+#endif
+
+typedef std::chrono::steady_clock clock_type;
+
+struct Options
+{
+    Options()
+        : validate(false), verifyChecksums(false), compact(false), jobs(0)
+    {}
+
+    std::string format;    // Output extension
+    std::string outputDir; // Defaults to the input file's directory
+    std::string archive;   // Add files to this archive instead of converting
+    bool validate;         // Load only
+    bool verifyChecksums;  // Test .puz checksums
+    bool compact;          // The files are archives to compact
+    unsigned int jobs;
+    std::vector<std::string> files;
+};
+
+// The result of one file
+struct Result
+{
+    Result() : ok(false), bytes(0), ms(0) {}
+
+    std::string file;
+    std::string output;
+    std::string error;
+    bool ok;
+    size_t bytes;
+    double ms;
+};
+
+// Each thread reuses one buffer for reading files
+struct Worker
+{
+    std::vector<char> buffer;
+};
+
+// Puzzles are scanned in parallel, but added to the archive one at a time
+struct ArchiveWriter
+{
+    puz::Archive archive;
+    std::mutex mutex;
+};
+
+
+//------------------------------------------------------------------------------
+// Files
+//------------------------------------------------------------------------------
+
+// Add files matching pattern.  Patterns that don't match anything are added
+// as is, so that they are reported as errors.
+static void ExpandGlob(const std::string & pattern, std::vector<std::string> & files)
+{
+#ifdef _WIN32
+    // Wildcards are only expanded in the last path component
+    const size_t slash = pattern.find_last_of("\\/");
+    const std::string dir =
+        slash == std::string::npos ? "" : pattern.substr(0, slash + 1);
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern.c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        files.push_back(pattern);
+        return;
+    }
+    do {
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            files.push_back(dir + data.cFileName);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    glob_t result;
+    if (glob(pattern.c_str(), GLOB_NOCHECK, NULL, &result) != 0)
+    {
+        files.push_back(pattern);
+        return;
+    }
+    for (size_t i = 0; i < result.gl_pathc; ++i)
+        files.push_back(result.gl_pathv[i]);
+    globfree(&result);
+#endif
+}
+
+// Read a whole file into buffer, reusing its memory
+static bool ReadFile(const std::string & filename, std::vector<char> & buffer)
+{
+    FILE * f = fopen(filename.c_str(), "rb");
+    if (! f)
+        return false;
+    buffer.clear();
+    bool ok = fseek(f, 0, SEEK_END) == 0;
+    const long size = ok ? ftell(f) : -1;
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0)
+    {
+        buffer.resize(size);
+        ok = fread(&buffer[0], 1, size, f) == static_cast<size_t>(size);
+    }
+    else if (size < 0)
+    {
+        ok = false;
+    }
+    fclose(f);
+    return ok;
+}
+
+// Split a download manager file name (e.g. nyt20120101.puz) into the
+// puzzle's source and date.  Return false if the name doesn't end in a date.
+static bool ParseArchiveKey(const std::string & filename,
+                            std::string & source, unsigned int & date)
+{
+    const size_t slash = filename.find_last_of("\\/");
+    std::string name =
+        slash == std::string::npos ? filename : filename.substr(slash + 1);
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos)
+        name.erase(dot);
+    if (name.size() <= 8)
+        return false;
+    const size_t split = name.size() - 8;
+    date = 0;
+    for (size_t i = split; i < name.size(); ++i)
+    {
+        if (name[i] < '0' || name[i] > '9')
+            return false;
+        date = date * 10 + (name[i] - '0');
+    }
+    source = name.substr(0, split);
+    return true;
+}
+
+// Replace the directory and extension of filename
+static std::string GetOutputName(const std::string & filename, const Options & opts)
+{
+    const size_t slash = filename.find_last_of("\\/");
+    std::string name =
+        slash == std::string::npos ? filename : filename.substr(slash + 1);
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos)
+        name.erase(dot);
+    name += "." + opts.format;
+    if (! opts.outputDir.empty())
+        return opts.outputDir + "/" + name;
+    if (slash != std::string::npos)
+        return filename.substr(0, slash + 1) + name;
+    return name;
+}
+
+
+//------------------------------------------------------------------------------
+// Conversion
+//------------------------------------------------------------------------------
+
+static void CompactArchive(const std::string & filename, Result & result)
+{
+    try
+    {
+        puz::Archive archive;
+        archive.Open(filename);
+        result.bytes = archive.GetSize();
+        archive.Compact();
+        result.ok = true;
+    }
+    catch (std::exception & e)
+    {
+        result.error = e.what();
+    }
+}
+
+static void ProcessFile(const std::string & filename, const Options & opts,
+                        Worker & worker, ArchiveWriter * writer,
+                        Result & result)
+{
+    result.file = filename;
+    if (opts.compact)
+    {
+        CompactArchive(filename, result);
+        return;
+    }
+    std::string source;
+    unsigned int date = 0;
+    if (writer && ! ParseArchiveKey(filename, source, date))
+    {
+        result.error = "File name does not end with a date: " + filename;
+        return;
+    }
+    if (! ReadFile(filename, worker.buffer))
+    {
+        result.error = "Unable to open file: " + filename;
+        return;
+    }
+    result.bytes = worker.buffer.size();
+    const char * data = worker.buffer.empty() ? "" : &worker.buffer[0];
+    try
+    {
+        if (opts.verifyChecksums && ! puz::VerifyChecksums(data, result.bytes))
+        {
+            result.error = "Checksums do not match";
+            return;
+        }
+        if (writer)
+        {
+            const puz::ScanInfo info = puz::Scan(data, result.bytes);
+            std::lock_guard<std::mutex> lock(writer->mutex);
+            writer->archive.Append(source, date, "", data, result.bytes, info);
+            result.output = opts.archive;
+            result.ok = true;
+            return;
+        }
+        puz::Puzzle puzzle;
+        puzzle.LoadBuffer(data, result.bytes);
+        if (! opts.validate)
+        {
+            result.output = GetOutputName(filename, opts);
+            puzzle.Save(result.output);
+        }
+        result.ok = true;
+    }
+    catch (std::exception & e)
+    {
+        result.error = e.what();
+    }
+    catch (...)
+    {
+        result.error = "Unknown error";
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Output
+//------------------------------------------------------------------------------
+
+// Append a JSON string.  Strings are passed through as UTF-8.
+static void WriteJsonString(std::ostream & out, const std::string & str)
+{
+    out << '"';
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*it);
+        switch (ch)
+        {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (ch < 0x20)
+                {
+                    char escape[8];
+                    sprintf(escape, "\\u%04x", ch);
+                    out << escape;
+                }
+                else
+                {
+                    out << *it;
+                }
+        }
+    }
+    out << '"';
+}
+
+static std::string FormatResult(const Result & result)
+{
+    std::ostringstream out;
+    out << "{\"file\":";
+    WriteJsonString(out, result.file);
+    out << ",\"ok\":" << (result.ok ? "true" : "false");
+    if (! result.output.empty() && result.ok)
+    {
+        out << ",\"output\":";
+        WriteJsonString(out, result.output);
+    }
+    if (! result.ok)
+    {
+        out << ",\"error\":";
+        WriteJsonString(out, result.error);
+    }
+    out << ",\"bytes\":" << result.bytes
+        << ",\"ms\":" << result.ms << "}\n";
+    return out.str();
+}
+
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+
+static void Usage()
+{
+    std::cerr <<
+        "Usage: puzconv [options] <file or glob> ...\n"
+        "\n"
+        "Options:\n"
+        "  -f, --format EXT       Convert to EXT (puz, jpz, or xml)\n"
+        "  -o, --output DIR       Write converted files to DIR\n"
+        "  -a, --archive FILE     Add files to archive FILE (created if needed)\n"
+        "      --compact          Compact archives, dropping replaced puzzles\n"
+        "      --validate         Load files without converting them\n"
+        "      --verify-checksums Fail .puz files with bad checksums\n"
+        "  -j, --jobs N           Number of threads (default: all cores)\n";
+}
+
+// Return false if the arguments are invalid
+static bool ParseArgs(int argc, char ** argv, Options & opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if ((arg == "-f" || arg == "--format") && hasValue)
+            opts.format = argv[++i];
+        else if ((arg == "-o" || arg == "--output") && hasValue)
+            opts.outputDir = argv[++i];
+        else if ((arg == "-a" || arg == "--archive") && hasValue)
+            opts.archive = argv[++i];
+        else if ((arg == "-j" || arg == "--jobs") && hasValue)
+            opts.jobs = atoi(argv[++i]);
+        else if (arg == "--validate")
+            opts.validate = true;
+        else if (arg == "--verify-checksums")
+            opts.verifyChecksums = true;
+        else if (arg == "--compact")
+            opts.compact = true;
+        else if (arg == "-h" || arg == "--help")
+            return false;
+        else if (! arg.empty() && arg[0] == '-')
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+        else
+            ExpandGlob(arg, opts.files);
+    }
+    if (opts.files.empty())
+        return false;
+    const int modes = (! opts.format.empty() || opts.validate)
+                    + ! opts.archive.empty() + opts.compact;
+    if (modes != 1)
+    {
+        std::cerr << "One of --format, --validate, --archive, "
+                     "or --compact is required\n";
+        return false;
+    }
+    if (! opts.format.empty() && ! puz::Puzzle::FindSaveHandler(opts.format))
+    {
+        std::cerr << "Unknown output format: " << opts.format << "\n";
+        return false;
+    }
+    if (opts.jobs == 0)
+        opts.jobs = std::thread::hardware_concurrency();
+    if (opts.jobs == 0)
+        opts.jobs = 1;
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    Options opts;
+    if (! ParseArgs(argc, argv, opts))
+    {
+        Usage();
+        return 2;
+    }
+
+    const size_t count = opts.files.size();
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> failed(0);
+    std::atomic<size_t> totalBytes(0);
+    std::mutex outputMutex;
+
+    ArchiveWriter writer;
+    if (! opts.archive.empty())
+    {
+        try
+        {
+            writer.archive.Open(opts.archive, true);
+        }
+        catch (std::exception & e)
+        {
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+    }
+    ArchiveWriter * archive = opts.archive.empty() ? NULL : &writer;
+
+    const clock_type::time_point start = clock_type::now();
+
+    // Each thread takes the next file until there are none left
+    std::vector<std::thread> threads;
+    const unsigned int jobs = std::min<size_t>(opts.jobs, count);
+    for (unsigned int i = 0; i < jobs; ++i)
+    {
+        threads.push_back(std::thread([&]() {
+            Worker worker;
+            for (size_t n = next++; n < count; n = next++)
+            {
+                Result result;
+                const clock_type::time_point fileStart = clock_type::now();
+                ProcessFile(opts.files[n], opts, worker, archive, result);
+                result.ms = std::chrono::duration<double, std::milli>(
+                    clock_type::now() - fileStart).count();
+                totalBytes += result.bytes;
+                if (! result.ok)
+                    ++failed;
+                const std::string line = FormatResult(result);
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << line << std::flush;
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    const double seconds = std::chrono::duration<double>(
+        clock_type::now() - start).count();
+    const double rate = seconds > 0 ? 1 / seconds : 0;
+    std::cout << "{\"summary\":true"
+              << ",\"files\":" << count
+              << ",\"failed\":" << failed
+              << ",\"bytes\":" << totalBytes
+              << ",\"threads\":" << jobs
+              << ",\"seconds\":" << seconds
+              << ",\"files_per_sec\":" << count * rate
+              << ",\"mb_per_sec\":" << totalBytes / (1024.0 * 1024.0) * rate
+              << "}" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+#include "test.hpp"
+#include "puz/Puzzle.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace puztest {
+
+typedef std::pair<const char *, test_func> test_t;
+
+static std::vector<test_t> & GetTests()
+{
+    static std::vector<test_t> tests;
+    return tests;
+}
+
+static int s_failures = 0;
+
+Register::Register(const char * name, test_func func)
+{
+    GetTests().push_back(test_t(name, func));
+}
+
+bool Fail(const char * file, int line, const char * expr)
+{
+    printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+    ++s_failures;
+    return false;
+}
+
+void MakePuzzle(puz::Puzzle * puz, size_t width, size_t height)
+{
+    puz::Grid & grid = puz->GetGrid();
+    grid.SetSize(width, height);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        if (square->GetCol() % 4 == 3 && square->GetRow() % 4 == 3)
+            square->SetSolution(puz::Square::Black);
+        else
+            square->SetSolution(puz::string_t(1, puzT('A') + i % 26));
+    }
+    std::vector<puz::string_t> clues;
+    for (puz::Square * square = grid.First(); square; square = square->Next())
+    {
+        if (square->SolutionWantsClue(puz::ACROSS))
+            clues.push_back(puzT("Across clue"));
+        if (square->SolutionWantsClue(puz::DOWN))
+            clues.push_back(puzT("Down clue"));
+    }
+    puz->SetAllClues(clues);
+}
+
+} // namespace puztest
+
+int main(int argc, char * argv[])
+{
+    using namespace puztest;
+    const std::vector<test_t> & tests = GetTests();
+    int failed = 0;
+    for (size_t i = 0; i < tests.size(); ++i)
+    {
+        bool run = argc < 2;
+        for (int arg = 1; arg < argc && ! run; ++arg)
+            run = strcmp(argv[arg], tests[i].first) == 0;
+        if (! run)
+            continue;
+        printf("%s\n", tests[i].first);
+        const int failures = s_failures;
+        try {
+            tests[i].second();
+        }
+        catch (std::exception & e) {
+            printf("  exception: %s\n", e.what());
+            ++s_failures;
+        }
+        if (s_failures != failures)
+            ++failed;
+    }
+    printf("%d test(s) failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
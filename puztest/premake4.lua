@@ -0,0 +1,36 @@
+project "puztest"
+    -- --------------------------------------------------------------------
+    -- General
+    -- --------------------------------------------------------------------
+    kind "ConsoleApp"
+    language "C++"
+
+    files { "*.hpp", "*.cpp" }
+
+    -- --------------------------------------------------------------------
+    -- puz
+    -- --------------------------------------------------------------------
+    includedirs { "../" }
+    links { "puz" }
+
+    configuration "windows"
+        defines { "PUZ_API=__declspec(dllimport)" }
+
+    configuration "linux"
+        defines { [[PUZ_API=""]] }
+
+    configuration "macosx"
+        defines { "PUZ_API=" }
+
+    -- Put the executable next to XWord, so that it finds libpuz in
+    -- XWord.app/Contents/Frameworks
+    configuration { "macosx", "Debug" }
+        targetdir "../bin/Debug/XWord.app/Contents/MacOS"
+    configuration { "macosx", "Release" }
+        targetdir "../bin/Release/XWord.app/Contents/MacOS"
+
+    -- Disable some warnings
+    configuration "vs*"
+        buildoptions {
+            "/wd4251", -- DLL Exports
+        }
@@ -0,0 +1,63 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// puztest: tests for the puz library.
+//
+// Usage: puztest [name ...]
+//
+// Runs every test, or only the ones named.  Exits with a non-zero status
+// if any check fails.
+
+#ifndef PUZTEST_TEST_H
+#define PUZTEST_TEST_H
+
+#include <cstddef>
+
+namespace puz {
+    class Puzzle;
+}
+
+namespace puztest {
+
+typedef void (*test_func)();
+
+// Adds a test to the list that main() runs
+struct Register
+{
+    Register(const char * name, test_func func);
+};
+
+#define PUZTEST(name) \
+    static void test_##name(); \
+    static puztest::Register register_##name(#name, test_##name); \
+    static void test_##name()
+
+// Report a failed check; returns false.
+bool Fail(const char * file, int line, const char * expr);
+
+#define CHECK(expr) \
+    ((expr) ? true : puztest::Fail(__FILE__, __LINE__, #expr))
+
+// A numbered puzzle with a clue for every word.  Every fourth square in
+// every fourth row is black, so each white square is in an across and a
+// down word.  The solution is the alphabet, repeated.
+void MakePuzzle(puz::Puzzle * puz, size_t width, size_t height);
+
+} // namespace puztest
+
+#endif // PUZTEST_TEST_H
@@ -0,0 +1,248 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Archive: appending, replacing, removing, compacting, and reading an
+// archive back after an interrupted change.
+
+#include "test.hpp"
+#include "puz/Archive.hpp"
+#include "puz/Puzzle.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace puztest;
+
+static const char * ARCHIVE_FILE = "puztest_archive.xwa";
+
+static std::string ReadFile(const std::string & filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string & filename, const std::string & data)
+{
+    std::ofstream f(filename.c_str(), std::ios::binary | std::ios::trunc);
+    f.write(data.data(), data.size());
+}
+
+// A .puz file of the given size
+static std::string MakePuzFile(size_t width, size_t height)
+{
+    const char * filename = "puztest_archive.puz";
+    puz::Puzzle puz;
+    MakePuzzle(&puz, width, height);
+    puz.Save(filename);
+    const std::string data = ReadFile(filename);
+    remove(filename);
+    return data;
+}
+
+static std::string GetData(puz::Archive & archive, const puz::ArchiveEntry * entry)
+{
+    if (! entry)
+        return std::string();
+    return std::string(archive.GetData(*entry), entry->length);
+}
+
+PUZTEST(archive_round_trip)
+{
+    remove(ARCHIVE_FILE);
+    std::vector<std::string> files;
+    for (size_t i = 0; i < 5; ++i)
+        files.push_back(MakePuzFile(5 + i, 5 + i));
+    // More than one index block
+    const unsigned int count = 150;
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE, true);
+        CHECK(archive.GetEntries().empty());
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const std::string & data = files[i % files.size()];
+            archive.Append("test", 20200101 + i, "", data.data(), data.size());
+        }
+        CHECK(archive.GetEntries().size() == count);
+    }
+    puz::Archive archive;
+    archive.Open(ARCHIVE_FILE);
+    CHECK(archive.GetEntries().size() == count);
+    CHECK(archive.GetUnusedSize() == 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const puz::ArchiveEntry & entry = archive.GetEntries()[i];
+        CHECK(entry.date == 20200101 + i);
+        CHECK(entry.format == "puz");
+        CHECK(entry.info.width == static_cast<int>(5 + i % files.size()));
+        CHECK(archive.Find("test", entry.date) == &entry);
+        CHECK(GetData(archive, &entry) == files[i % files.size()]);
+    }
+    CHECK(archive.Find("test", 20200101 + count) == NULL);
+    CHECK(archive.Find("other", 20200101) == NULL);
+    CHECK(archive.GetLatest()->date == 20200101 + count - 1);
+
+    puz::Puzzle puz;
+    archive.Load(&puz, archive.GetEntries()[2]);
+    CHECK(puz.GetGrid().GetWidth() == 7);
+    archive.Close();
+    remove(ARCHIVE_FILE);
+}
+
+PUZTEST(archive_replace_remove_compact)
+{
+    remove(ARCHIVE_FILE);
+    const std::string small = MakePuzFile(5, 5);
+    const std::string large = MakePuzFile(15, 15);
+    puz::Archive archive;
+    archive.Open(ARCHIVE_FILE, true);
+    archive.Append("a", 1, "puz", small.data(), small.size());
+    archive.Append("b", 2, "puz", small.data(), small.size());
+    archive.Append("c", 3, "puz", small.data(), small.size());
+
+    // Replacing moves the puzzle to the end
+    archive.Append("a", 1, "puz", large.data(), large.size());
+    CHECK(archive.GetEntries().size() == 3);
+    CHECK(archive.GetEntries().back().source == "a");
+    CHECK(GetData(archive, archive.Find("a", 1)) == large);
+    CHECK(archive.GetUnusedSize() == small.size());
+
+    CHECK(archive.Remove("b", 2));
+    CHECK(! archive.Remove("b", 2));
+    CHECK(archive.Find("b", 2) == NULL);
+    CHECK(archive.GetUnusedSize() == 2 * small.size());
+
+    // The same after reopening
+    const size_t size = archive.GetSize();
+    archive.Close();
+    archive.Open(ARCHIVE_FILE);
+    CHECK(archive.GetEntries().size() == 2);
+    CHECK(archive.GetEntries()[0].source == "c");
+    CHECK(archive.GetEntries()[1].source == "a");
+    CHECK(archive.Find("b", 2) == NULL);
+    CHECK(GetData(archive, archive.Find("a", 1)) == large);
+    CHECK(GetData(archive, archive.Find("c", 3)) == small);
+    CHECK(archive.GetUnusedSize() == 2 * small.size());
+    CHECK(archive.GetSize() == size);
+
+    archive.Compact();
+    CHECK(archive.GetUnusedSize() == 0);
+    CHECK(archive.GetSize() == size - 2 * small.size());
+    CHECK(ReadFile(ARCHIVE_FILE).size() == archive.GetSize());
+    CHECK(archive.GetEntries().size() == 2);
+    CHECK(GetData(archive, archive.Find("a", 1)) == large);
+    CHECK(GetData(archive, archive.Find("c", 3)) == small);
+
+    // And after compacting
+    archive.Append("d", 4, "puz", small.data(), small.size());
+    archive.Close();
+    archive.Open(ARCHIVE_FILE);
+    CHECK(archive.GetEntries().size() == 3);
+    CHECK(GetData(archive, archive.Find("d", 4)) == small);
+    archive.Close();
+    remove(ARCHIVE_FILE);
+}
+
+PUZTEST(archive_interrupted)
+{
+    remove(ARCHIVE_FILE);
+    const std::string small = MakePuzFile(5, 5);
+    const std::string large = MakePuzFile(15, 15);
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE, true);
+        archive.Append("a", 1, "puz", small.data(), small.size());
+        archive.Append("b", 2, "puz", small.data(), small.size());
+    }
+    const std::string before = ReadFile(ARCHIVE_FILE);
+
+    // Data written past the end, but the header was never updated
+    WriteFile(ARCHIVE_FILE, before + large);
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE);
+        CHECK(archive.GetEntries().size() == 2);
+        CHECK(archive.GetUnusedSize() == 0);
+        archive.Append("c", 3, "puz", small.data(), small.size());
+        CHECK(archive.GetSize() == before.size() + small.size());
+    }
+
+    // A replacement that stopped before the old entry was removed
+    WriteFile(ARCHIVE_FILE, before);
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE);
+        archive.Append("a", 1, "puz", large.data(), large.size());
+    }
+    std::string after = ReadFile(ARCHIVE_FILE);
+    // Put back the first entry in the first index block
+    const size_t entry = 32 + 8;
+    after.replace(entry, 128, before, entry, 128);
+    WriteFile(ARCHIVE_FILE, after);
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE);
+        CHECK(archive.GetEntries().size() == 2);
+        CHECK(GetData(archive, archive.Find("a", 1)) == large);
+        CHECK(archive.GetUnusedSize() == small.size());
+        // The old entry doesn't come back after removing the new one
+        CHECK(archive.Remove("a", 1));
+    }
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE);
+        CHECK(archive.GetEntries().size() == 1);
+        CHECK(archive.Find("a", 1) == NULL);
+    }
+    remove(ARCHIVE_FILE);
+}
+
+PUZTEST(archive_damaged)
+{
+    remove(ARCHIVE_FILE);
+    const std::string small = MakePuzFile(5, 5);
+    {
+        puz::Archive archive;
+        archive.Open(ARCHIVE_FILE, true);
+        for (unsigned int i = 0; i < 10; ++i)
+            archive.Append("a", i, "puz", small.data(), small.size());
+    }
+    const std::string data = ReadFile(ARCHIVE_FILE);
+    remove(ARCHIVE_FILE);
+    // Truncated archives throw instead of reading past the end
+    for (size_t length = 0; length < data.size(); length += 97)
+    {
+        bool ok = false;
+        try {
+            puz::Archive archive;
+            archive.OpenBuffer(data.data(), length);
+        }
+        catch (puz::Exception &) {
+            ok = true;
+        }
+        CHECK(ok);
+    }
+    puz::Archive archive;
+    archive.OpenBuffer(data.data(), data.size());
+    CHECK(archive.GetEntries().size() == 10);
+    CHECK(archive.IsReadOnly());
+}
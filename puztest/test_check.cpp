@@ -0,0 +1,96 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Grid::CheckGrid and CheckWord give the same answers as Square::Check
+
+#include "test.hpp"
+#include "puz/Grid.hpp"
+#include "puz/Word.hpp"
+
+#include <vector>
+
+using namespace puztest;
+
+// A grid with every kind of square: correct, incorrect, blank, blank
+// solutions, black squares, and rebus entries.
+static void FillGrid(puz::Grid & grid, size_t width, size_t height)
+{
+    grid.SetSize(width, height);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        const puz::string_t letter(1, puzT('A') + i % 26);
+        switch (i % 9)
+        {
+        case 0: square->SetSolution(puz::Square::Black); break;
+        case 1: square->SetSolution(letter); break;
+        case 2: square->SetSolution(letter); square->SetText(letter); break;
+        case 3: square->SetSolution(letter); square->SetText(puzT("Q")); break;
+        case 4: square->SetSolution(puzT("")); break;
+        case 5: square->SetSolution(puzT("")); square->SetText(letter); break;
+        case 6: square->SetSolution(puzT("HEART"), 'H'); square->SetText(puzT("H")); break;
+        case 7: square->SetSolution(puzT("HEART"), 'H'); square->SetText(puzT("HEART")); break;
+        case 8: square->SetSolution(letter); square->SetText(puz::Square::Black); break;
+        }
+    }
+}
+
+static bool CheckGridMatches(const puz::Grid & grid, bool checkBlank, bool strictRebus)
+{
+    std::vector<unsigned char> incorrect;
+    grid.CheckGrid(&incorrect, checkBlank, strictRebus);
+    if (incorrect.size() != grid.GetWidth() * grid.GetHeight())
+        return false;
+    size_t i = 0;
+    for (const puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+        if ((incorrect[i] != 0) == square->Check(checkBlank, strictRebus))
+            return false;
+    return true;
+}
+
+PUZTEST(check_grid)
+{
+    // Sizes that do and don't fill whole SSE2 blocks
+    const size_t sizes[][2] = { { 1, 1 }, { 4, 4 }, { 15, 15 }, { 17, 3 }, { 100, 100 } };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        puz::Grid grid;
+        FillGrid(grid, sizes[i][0], sizes[i][1]);
+        CHECK(CheckGridMatches(grid, false, false));
+        CHECK(CheckGridMatches(grid, false, true));
+        CHECK(CheckGridMatches(grid, true, false));
+        CHECK(CheckGridMatches(grid, true, true));
+    }
+}
+
+PUZTEST(check_word)
+{
+    puz::Grid grid;
+    FillGrid(grid, 15, 15);
+    puz::Word word(&grid.At(0, 2), &grid.At(14, 2));
+    std::vector<unsigned char> incorrect;
+    grid.CheckWord(&incorrect, &word, true);
+    size_t i = 0;
+    for (const puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        if (square->GetRow() == 2)
+            CHECK((incorrect[i] != 0) == ! square->Check(true));
+        else
+            CHECK(incorrect[i] == 0);
+    }
+}
@@ -0,0 +1,112 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// ClueList::Find by number and by word, after the clues change in place
+
+#include "test.hpp"
+#include "puz/Clue.hpp"
+
+#include <algorithm>
+
+using namespace puztest;
+
+// An acrostic-sized list: clues 1 through count
+static puz::ClueList MakeClues(int count)
+{
+    puz::ClueList clues(puzT("Across"));
+    for (int i = 1; i <= count; ++i)
+        clues.push_back(puz::Clue(i, puzT("Clue")));
+    return clues;
+}
+
+PUZTEST(clue_index_find)
+{
+    puz::ClueList clues = MakeClues(250);
+    CHECK(clues.Find(1) == &clues[0]);
+    CHECK(clues.Find(250) == &clues[249]);
+    CHECK(clues.Find(puzT("125")) == &clues[124]);
+    CHECK(clues.Find(&clues[10].GetWord()) == &clues[10]);
+    CHECK(clues.Find(0) == NULL);
+    CHECK(clues.Find(251) == NULL);
+    CHECK(clues.Find(puzT("A")) == NULL);
+}
+
+PUZTEST(clue_index_renumber)
+{
+    puz::ClueList clues = MakeClues(250);
+    CHECK(clues.Find(100) == &clues[99]);
+    clues[99].SetNumber(1000);
+    CHECK(clues.Find(100) == NULL);
+    CHECK(clues.Find(1000) == &clues[99]);
+    CHECK(clues.Find(puzT("1000")) == &clues[99]);
+
+    // A number that was missing before
+    clues[0].SetNumber(puzT("100"));
+    CHECK(clues.Find(100) == &clues[0]);
+    CHECK(clues.Find(1) == NULL);
+}
+
+PUZTEST(clue_index_reorder)
+{
+    puz::ClueList clues = MakeClues(250);
+    CHECK(clues.Find(1) == &clues[0]);
+    std::reverse(clues.begin(), clues.end());
+    CHECK(clues.Find(1) == &clues[249]);
+    CHECK(clues.Find(250) == &clues[0]);
+    std::sort(clues.begin(), clues.end());
+    CHECK(clues.Find(1) == &clues[0]);
+    CHECK(clues.Find(250) == &clues[249]);
+}
+
+PUZTEST(clue_index_add_remove)
+{
+    puz::ClueList clues = MakeClues(250);
+    CHECK(clues.Find(1) == &clues[0]);
+    clues.erase(clues.begin());
+    CHECK(clues.Find(1) == NULL);
+    CHECK(clues.Find(2) == &clues[0]);
+    clues.push_back(puz::Clue(1, puzT("Clue")));
+    CHECK(clues.Find(1) == &clues.back());
+
+    // Assigning a list of the same size
+    puz::ClueList other = MakeClues(250);
+    other[0].SetNumber(puzT("Other"));
+    clues = other;
+    CHECK(clues.Find(puzT("Other")) == &clues[0]);
+    CHECK(clues.Find(1) == NULL);
+
+    // Moving a list
+    puz::ClueList moved(std::move(clues));
+    CHECK(moved.Find(puzT("Other")) == &moved[0]);
+    moved[1].SetNumber(puzT("Moved"));
+    CHECK(moved.Find(puzT("Moved")) == &moved[1]);
+}
+
+PUZTEST(clue_index_invalidate)
+{
+    puz::ClueList clues = MakeClues(250);
+    CHECK(clues.Find(puzT("5")) == &clues[4]);
+
+    // A stale hit is caught without InvalidateIndex
+    clues[4].number = puzT("Five");
+    CHECK(clues.Find(puzT("5")) == NULL);
+
+    // A new number needs InvalidateIndex
+    clues.InvalidateIndex();
+    CHECK(clues.Find(puzT("Five")) == &clues[4]);
+}
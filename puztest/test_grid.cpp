@@ -0,0 +1,110 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Grid copying and moving
+
+#include "test.hpp"
+#include "puz/Grid.hpp"
+
+#include <cstdlib>
+#include <new>
+
+using namespace puztest;
+
+// Count heap allocations.  Replacing operator new only affects the puz
+// library when it is linked statically or as an ELF/Mach-O shared library.
+#ifndef _WIN32
+static size_t s_allocations = 0;
+
+void * operator new(std::size_t size)
+{
+    ++s_allocations;
+    void * ptr = malloc(size ? size : 1);
+    if (! ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) throw()
+{
+    ++s_allocations;
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void * ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) throw()
+{
+    free(ptr);
+}
+#endif // _WIN32
+
+static void FillGrid(puz::Grid & grid)
+{
+    grid.SetSize(5, 4);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        square->SetSolution(puz::string_t(1, puzT('A') + i));
+        if (i % 2 == 0)
+            square->SetText(square->GetSolution());
+    }
+}
+
+PUZTEST(grid_move)
+{
+    puz::Grid grid;
+    FillGrid(grid);
+    const puz::Square * first = grid.First();
+
+#ifndef _WIN32
+    const size_t allocations = s_allocations;
+#endif
+    puz::Grid moved(std::move(grid));
+#ifndef _WIN32
+    CHECK(s_allocations == allocations);
+#endif
+
+    // The squares didn't move
+    CHECK(moved.First() == first);
+    CHECK(moved.GetWidth() == 5 && moved.GetHeight() == 4);
+    CHECK(moved.At(1, 0).IsBlank());
+    CHECK(moved.At(2, 0).GetText() == puzT("C"));
+    CHECK(moved.GetStats().blank == 10);
+
+    // The moved-from grid can be reused
+    CHECK(grid.First() == NULL);
+    CHECK(grid.GetWidth() == 0 && grid.GetHeight() == 0);
+    FillGrid(grid);
+    CHECK(grid.At(4, 3).GetSolution() == puzT("T"));
+    CHECK(grid.GetStats().blank == 10);
+    grid = std::move(moved);
+    CHECK(grid.First() == first);
+    moved.Clear();
+    CHECK(moved.First() == NULL);
+
+    // A copy has its own squares
+    puz::Grid copy(grid);
+    CHECK(copy.First() != first);
+    copy.At(1, 0).SetText(puzT("X"));
+    CHECK(grid.At(1, 0).IsBlank());
+    CHECK(copy.GetStats().blank == grid.GetStats().blank - 1);
+}
@@ -0,0 +1,174 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Snapshots: restoring the solving state, and refusing snapshots from a
+// different puzzle.
+
+#include "test.hpp"
+#include "puz/Snapshot.hpp"
+#include "puz/Puzzle.hpp"
+#include "puz/exceptions.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace puztest;
+
+static const char * SNAPSHOT_FILE = "puztest_snapshot.xws";
+
+static std::string ReadFile(const std::string & filename)
+{
+    std::ifstream f(filename.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+}
+
+// Fill in some of the grid
+static void Solve(puz::Puzzle * puz)
+{
+    int i = 0;
+    for (puz::Square * square = puz->GetGrid().First(); square; square = square->Next())
+    {
+        if (! square->IsWhite())
+            continue;
+        switch (i++ % 5)
+        {
+            case 0: square->SetText(puzT("A")); break;
+            case 1: square->SetText(puzT("REBUS")); break;
+            case 2: square->SetText(puzT("Q"));
+                    square->AddFlag(puz::FLAG_PENCIL | puz::FLAG_X); break;
+            case 3: square->AddFlag(puz::FLAG_REVEALED); break;
+            default: break;
+        }
+    }
+    puz->SetTime(1234);
+    puz->SetTimerRunning(true);
+}
+
+static bool SameState(const puz::Puzzle & a, const puz::Puzzle & b)
+{
+    if (a.GetTime() != b.GetTime() || a.IsTimerRunning() != b.IsTimerRunning())
+        return false;
+    const puz::Square * x = a.GetGrid().First();
+    const puz::Square * y = b.GetGrid().First();
+    for (; x && y; x = x->Next(), y = y->Next())
+        if (x->GetText() != y->GetText() || x->GetFlag() != y->GetFlag())
+            return false;
+    return x == NULL && y == NULL;
+}
+
+PUZTEST(snapshot_restore)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 15, 15);
+    Solve(&puz);
+    puz::SaveSnapshot(puz, SNAPSHOT_FILE);
+
+    puz::Puzzle restored;
+    MakePuzzle(&restored, 15, 15);
+    CHECK(! SameState(puz, restored));
+    CHECK(puz::LoadSnapshot(&restored, SNAPSHOT_FILE));
+    CHECK(SameState(puz, restored));
+
+    // Squares that were filled in are cleared
+    for (puz::Square * square = puz.GetGrid().First(); square; square = square->Next())
+        if (square->IsWhite())
+            square->SetText(puzT(""));
+    CHECK(puz::LoadSnapshot(&puz, SNAPSHOT_FILE));
+    CHECK(SameState(puz, restored));
+    remove(SNAPSHOT_FILE);
+}
+
+PUZTEST(snapshot_mismatch)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 15, 15);
+    Solve(&puz);
+    puz::SaveSnapshot(puz, SNAPSHOT_FILE);
+    const std::string data = ReadFile(SNAPSHOT_FILE);
+    remove(SNAPSHOT_FILE);
+
+    // A different solution
+    puz::Puzzle other;
+    MakePuzzle(&other, 15, 15);
+    other.GetGrid().At(6, 7).SetSolution(puzT("Z"));
+    puz::Puzzle clean;
+    MakePuzzle(&clean, 15, 15);
+    CHECK(! puz::LoadSnapshotBuffer(&other, data.data(), data.size()));
+    other.GetGrid().At(6, 7).SetSolution(clean.GetGrid().At(6, 7).GetSolution());
+    CHECK(SameState(other, clean)); // Nothing was changed
+
+    // A different size
+    puz::Puzzle smaller;
+    MakePuzzle(&smaller, 13, 15);
+    CHECK(! puz::LoadSnapshotBuffer(&smaller, data.data(), data.size()));
+
+    // The same solution again
+    CHECK(puz::LoadSnapshotBuffer(&other, data.data(), data.size()));
+    CHECK(SameState(puz, other));
+}
+
+PUZTEST(snapshot_embedded)
+{
+    const char * puzfile = "puztest_snapshot.puz";
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 15, 15);
+    puz.Save(puzfile);
+    const std::string original = ReadFile(puzfile);
+    remove(puzfile);
+
+    Solve(&puz);
+    puz::SaveSnapshot(puz, SNAPSHOT_FILE, original.data(), original.size());
+    const std::string data = ReadFile(SNAPSHOT_FILE);
+
+    puz::Puzzle loaded(SNAPSHOT_FILE);
+    remove(SNAPSHOT_FILE);
+    CHECK(loaded.IsOk());
+    CHECK(SameState(puz, loaded));
+    CHECK(loaded.GetClues().GetAcross().size() == puz.GetClues().GetAcross().size());
+
+    // Truncated snapshots throw without changing the puzzle
+    puz::Puzzle clean;
+    MakePuzzle(&clean, 15, 15);
+    for (size_t length = 0; length < data.size(); length += 61)
+    {
+        bool threw = false;
+        try {
+            puz::Puzzle truncated;
+            truncated.LoadBuffer(data.data(), length);
+        }
+        catch (puz::Exception &) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        threw = false;
+        puz::Puzzle target;
+        MakePuzzle(&target, 15, 15);
+        try {
+            puz::LoadSnapshotBuffer(&target, data.data(), length);
+        }
+        catch (puz::Exception &) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(SameState(target, clean));
+    }
+}
@@ -0,0 +1,111 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Grid::GetStats, kept up to date as squares change
+
+#include "test.hpp"
+#include "puz/Grid.hpp"
+
+using namespace puztest;
+
+// Count the stats the slow way, as Square::Check does
+static bool CheckStats(const puz::Grid & grid)
+{
+    int white = 0, black = 0, blank = 0, correct = 0, incorrect = 0;
+    for (const puz::Square * square = grid.First(); square; square = square->Next())
+    {
+        if (square->IsMissing())
+            continue;
+        if (square->IsBlack() && square->IsSolutionBlack())
+        {
+            ++black;
+            continue;
+        }
+        ++white;
+        if (square->IsBlank())
+            ++blank;
+        else if (square->Check())
+            ++correct;
+        else
+            ++incorrect;
+    }
+    const puz::SolveStats & stats = grid.GetStats();
+    return stats.white == white && stats.black == black
+        && stats.blank == blank && stats.correct == correct
+        && stats.incorrect == incorrect;
+}
+
+PUZTEST(solve_stats)
+{
+    puz::Grid grid(3, 3);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+    {
+        if (i == 4)
+            square->SetSolution(puz::Square::Black);
+        else
+            square->SetSolution(puz::string_t(1, puzT('A') + i));
+    }
+    // Setting a black solution sets black text
+    CHECK(grid.GetStats().white == 8);
+    CHECK(grid.GetStats().black == 1);
+    CHECK(grid.GetStats().blank == 8);
+    CHECK(CheckStats(grid));
+
+    grid.At(0, 0).SetText(puzT("A"));
+    grid.At(1, 0).SetText(puzT("X"));
+    CHECK(grid.GetStats().correct == 1);
+    CHECK(grid.GetStats().incorrect == 1);
+    CHECK(grid.GetStats().blank == 6);
+    CHECK(CheckStats(grid));
+
+    grid.At(1, 0).SetText(puzT("B"));
+    CHECK(grid.GetStats().correct == 2);
+    CHECK(grid.GetStats().incorrect == 0);
+    CHECK(CheckStats(grid));
+}
+
+PUZTEST(solve_stats_diagramless)
+{
+    puz::Grid grid(3, 3);
+    size_t i = 0;
+    for (puz::Square * square = grid.First(); square; square = square->Next(), ++i)
+        square->SetSolution(puz::string_t(1, puzT('A') + i));
+
+    // Filling in a black square where the solution has a letter
+    puz::Square & square = grid.At(2, 2);
+    square.SetText(puz::Square::Black);
+    CHECK(! square.Check());
+    CHECK(grid.GetStats().white == 9);
+    CHECK(grid.GetStats().black == 0);
+    CHECK(grid.GetStats().incorrect == 1);
+    CHECK(grid.GetStats().strictIncorrect == 1);
+    CHECK(grid.GetStats().blank == 8);
+    CHECK(CheckStats(grid));
+
+    // And the other way around
+    grid.At(0, 0).SetSolution(puz::Square::Black);
+    grid.At(0, 0).SetText(puzT("A"));
+    CHECK(grid.GetStats().incorrect == 2);
+    CHECK(CheckStats(grid));
+
+    square.SetText(puzT("I"));
+    CHECK(grid.GetStats().incorrect == 1);
+    CHECK(grid.GetStats().correct == 1);
+    CHECK(CheckStats(grid));
+}
@@ -0,0 +1,66 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Text conversions
+
+#include "test.hpp"
+#include "puz/Puzzle.hpp"
+#include "puz/exceptions.hpp"
+
+#include <cstdio>
+
+using namespace puztest;
+
+// Save a clue to .puz, and return the text that loads back, or "THROW" if
+// the clue can't be saved.
+static puz::string_t PuzRoundTrip(const puz::string_t & text)
+{
+    const char * filename = "puztest_strings.puz";
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 3, 3);
+    puz.GetClues().GetAcross().front().SetText(text, true);
+    try {
+        puz.Save(filename);
+    }
+    catch (puz::ConversionError &) {
+        remove(filename);
+        return puzT("THROW");
+    }
+    puz::Puzzle loaded(filename);
+    remove(filename);
+    return loaded.GetClues().GetAcross().front().GetText();
+}
+
+PUZTEST(puz_br_tags)
+{
+    const puz::string_t lineBreak = PuzRoundTrip(puzT("a<br>b"));
+    CHECK(lineBreak != puzT("THROW"));
+    CHECK(lineBreak != puzT("ab"));
+    CHECK(PuzRoundTrip(puzT("a<br/>b")) == lineBreak);
+    CHECK(PuzRoundTrip(puzT("a<br />b")) == lineBreak);
+    CHECK(PuzRoundTrip(puzT("a<br/ >b")) == lineBreak);
+    CHECK(PuzRoundTrip(puzT("a<br\n/>b")) == lineBreak);
+
+    // Not <br> tags, so this is formatting that .puz can't hold
+    CHECK(PuzRoundTrip(puzT("a<br >b")) == puzT("THROW"));
+    CHECK(PuzRoundTrip(puzT("a<br\t>b")) == puzT("THROW"));
+    CHECK(PuzRoundTrip(puzT("a< br>b")) == puzT("THROW"));
+    CHECK(PuzRoundTrip(puzT("a<br//>b")) == puzT("THROW"));
+    CHECK(PuzRoundTrip(puzT("a<brx>b")) == puzT("THROW"));
+    CHECK(PuzRoundTrip(puzT("a<i>b</i>")) == puzT("THROW"));
+}
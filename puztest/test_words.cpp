@@ -0,0 +1,132 @@
+// This file is part of XWord
+// Copyright (C) 2011 Mike Richards ( mrichards42@gmx.com )
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+// Puzzle::FindWord and FindClue, after the clues change in place
+
+#include "test.hpp"
+#include "puz/Puzzle.hpp"
+
+using namespace puztest;
+
+// The first clue list with a clue containing square, searched the slow way
+static const puz::Clue * SlowFindClue(const puz::Puzzle & puz,
+                                      const puz::Square * square)
+{
+    const puz::Clues & clues = puz.GetClues();
+    puz::Clues::const_iterator it;
+    for (it = clues.begin(); it != clues.end(); ++it)
+    {
+        const puz::Clue * clue = it->second.Find(square);
+        if (clue)
+            return clue;
+    }
+    return NULL;
+}
+
+// Check FindClue against SlowFindClue for every square
+static bool CheckAllClues(const puz::Puzzle & puz)
+{
+    const puz::Grid & grid = puz.GetGrid();
+    for (const puz::Square * square = grid.First(); square; square = square->Next())
+        if (puz.FindClue(square) != SlowFindClue(puz, square))
+            return false;
+    return true;
+}
+
+PUZTEST(word_index_set_word)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 9, 9);
+    puz::Grid & grid = puz.GetGrid();
+    puz::Clue * across1 = puz.GetClues().GetAcross().Find(1);
+    CHECK(across1 && across1->GetWord().back() == &grid.At(8, 0));
+    CHECK(puz.FindClue(&grid.At(2, 0)) == across1);
+    CHECK(puz.FindWord(&grid.At(2, 0), puz::ACROSS) == &across1->GetWord());
+
+    // Shorten the word
+    across1->SetWord(puz::Word(&grid.At(0, 0), &grid.At(1, 0)));
+    CHECK(puz.FindClue(&grid.At(2, 0)) == puz.GetClues().GetDown().Find(3));
+    CHECK(puz.FindWord(&grid.At(2, 0), puz::ACROSS) == NULL);
+    CHECK(CheckAllClues(puz));
+
+    // Same ends, different middle
+    puz::Word word;
+    word.push_back(&grid.At(0, 0));
+    word.push_back(&grid.At(4, 4));
+    word.push_back(&grid.At(1, 0));
+    across1->SetWord(word);
+    CHECK(puz.FindClue(&grid.At(4, 4)) == across1);
+    CHECK(CheckAllClues(puz));
+}
+
+PUZTEST(word_index_assign_list)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 9, 9);
+    puz::Grid & grid = puz.GetGrid();
+    CHECK(CheckAllClues(puz));
+
+    // Assigning a list of the same size reuses the clues in place
+    puz::ClueList & across = puz.GetClues().GetAcross();
+    const puz::Clue * data = &across.front();
+    puz::ClueList reversed(across);
+    for (size_t i = 0; i < reversed.size(); ++i)
+        reversed[i].SetWord(across[across.size() - 1 - i].GetWord());
+    across = reversed;
+    CHECK(&across.front() == data);
+    CHECK(puz.FindClue(&grid.At(0, 0)) == &across.back());
+    CHECK(CheckAllClues(puz));
+
+    // Reordering the clues
+    std::swap(across.front(), across.back());
+    CHECK(puz.FindClue(&grid.At(0, 0)) == &across.front());
+    CHECK(CheckAllClues(puz));
+}
+
+PUZTEST(word_index_add_remove)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 9, 9);
+    puz::Grid & grid = puz.GetGrid();
+    puz::ClueList & across = puz.GetClues().GetAcross();
+    CHECK(CheckAllClues(puz));
+
+    across.erase(across.begin());
+    CHECK(puz.FindClue(&grid.At(0, 0)) == puz.GetClues().GetDown().Find(1));
+    CHECK(CheckAllClues(puz));
+
+    across.push_back(puz::Clue(puzT("1"), puzT("Again"),
+                               puz::Word(&grid.At(0, 0), &grid.At(8, 0))));
+    CHECK(puz.FindClue(&grid.At(0, 0)) == &across.back());
+    CHECK(CheckAllClues(puz));
+}
+
+PUZTEST(word_index_invalidate)
+{
+    puz::Puzzle puz;
+    MakePuzzle(&puz, 9, 9);
+    puz::Grid & grid = puz.GetGrid();
+    puz::Clue * across1 = puz.GetClues().GetAcross().Find(1);
+    CHECK(puz.FindClue(&grid.At(2, 0)) == across1);
+
+    // Writing the word directly needs InvalidateWordIndex
+    across1->word = puz::Word(&grid.At(0, 0), &grid.At(1, 0));
+    puz.InvalidateWordIndex();
+    CHECK(puz.FindClue(&grid.At(2, 0)) == puz.GetClues().GetDown().Find(3));
+    CHECK(CheckAllClues(puz));
+}
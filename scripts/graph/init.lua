@@ -84,30 +84,16 @@ end
 
 -- Return a table of data for the current time
 function graph.make_point()
-    local point = {
+    -- The grid keeps these counts up to date
+    local stats = xword.frame.Puzzle.Grid:GetStats()
+    return {
         time = get_time(),
         timestamp = os.time(),
-        correct = 0,
-        incorrect = 0,
-        blank = 0,
-        black = 0,
+        correct = stats.correct,
+        incorrect = stats.incorrect,
+        blank = stats.blank,
+        black = stats.black,
     }
-    -- Check the grid
-    square = xword.frame.Puzzle.Grid:First()
-    while (square) do
-        if square:IsMissing() then
-        elseif square:IsBlack() then
-            point.black = point.black + 1
-        elseif square:IsBlank() then
-            point.blank = point.blank + 1
-        elseif square:Check() then
-            point.correct = point.correct + 1
-        else
-            point.incorrect = point.incorrect + 1
-        end
-        square = square:Next()
-    end
-    return point
 end
 
 -- Add a point to our graph
@@ -32,6 +32,7 @@
 #include "puz/Scrambler.hpp"
 #include "puz/exceptions.hpp"
 #include "puz/Puzzle.hpp"
+#include "puz/Snapshot.hpp"
 
 // Dialogs
 #include "dialogs/LayoutDialog.hpp"
@@ -391,6 +392,7 @@ MyFrame::MyFrame()
       m_autoSaveTimer(this, ID_AUTOSAVE_TIMER),
       m_autoSaveInterval(0),
       m_showCompletionStatus(true),
+      m_hasSnapshot(false),
       m_mgr(),
       m_fileHistory(10, ID_FILE_HISTORY_1)
 {
@@ -590,6 +592,8 @@ MyFrame::LoadPuzzle(const wxString & filename)
             puz::Puzzle::FileHandlerDesc desc;
             desc.data = L;
             desc.handler = luapuz_Load_Puzzle;
+            desc.bufferHandler = NULL;
+            desc.probe = NULL;
 
             bool ret = LoadPuzzle(filename, &desc);
 
@@ -637,6 +641,7 @@ MyFrame::LoadPuzzle(const wxString & filename, const puz::Puzzle::FileHandlerDes
         }
         lua_pop(L, 1); // Pop the import table
     #endif
+        RestoreSnapshot(filename);
     }
     catch (...)
     {
@@ -659,6 +664,8 @@ MyFrame::LoadPuzzle(const wxString & filename, const puz::Puzzle::FileHandlerDes
         SetStatus(wxString::Format(_T("%s   Load time: %ld ms"),
                                    (const wxChar *)filename.c_str(),
                                    sw.Time()));
+        if (m_isModified)
+            EnableSave();
         if (m_autoStartTimer)
             StartTimer();
         CheckPuzzle();
@@ -703,6 +710,7 @@ MyFrame::DoSavePuzzle(const wxString & filename,
     wxStopWatch sw;
 
     m_puz.Save(fn, handler);
+    RemoveSnapshot();
     m_filename = fn;
     m_isModified = false;
 
@@ -762,11 +770,13 @@ MyFrame::ClosePuzzle(bool prompt, bool update)
         int ret = XWordCancelablePrompt(this, "Current Puzzle not saved.  Save before closing?");
         if (ret == wxCANCEL)
             return false;
-        if (ret == wxYES)
-            SavePuzzle(m_filename);
+        // SavePuzzle succeeds without saving if "Save As" is canceled
+        if (ret == wxYES && (! SavePuzzle(m_filename) || m_isModified))
+            return false;
     }
 
     m_autoSaveTimer.Stop();
+    RemoveSnapshot(); // Saved or discarded
     SetStatus(_T("No file loaded"));
     m_puz.Clear();
 
@@ -2501,6 +2511,17 @@ MyFrame::SetShowCompletionStatus(bool show)
 
 // AutoSave
 //---------
+// AutoSave writes a snapshot of the grid and timer next to the puzzle file
+// (see puz/Snapshot.hpp), which is much quicker than saving the puzzle.
+// The snapshot is only for recovering from a crash: the puzzle file is
+// saved as before, and the snapshot is removed when the puzzle is saved or
+// closed.  If XWord exits without closing the puzzle, the snapshot is
+// restored the next time the puzzle is opened.
+static wxString GetSnapshotFilename(const wxString & filename)
+{
+    return filename + _T(".xws");
+}
+
 void
 MyFrame::OnAutoSaveNotify(wxTimerEvent & WXUNUSED(evt))
 {
@@ -2509,7 +2530,10 @@ MyFrame::OnAutoSaveNotify(wxTimerEvent & WXUNUSED(evt))
         && wxFileName::IsFileWritable(m_filename))
     {
         try {
-            DoSavePuzzle(m_filename);
+            m_puz.SetTime(m_time);
+            m_puz.SetTimerRunning(IsTimerRunning());
+            puz::SaveSnapshot(m_puz, wx2file(GetSnapshotFilename(m_filename)));
+            m_hasSnapshot = true;
         } catch (...) {
             wxLogDebug(_T("AutoSave failed"));
             SetStatus(_T("Auto save faield"));
@@ -2518,6 +2542,42 @@ MyFrame::OnAutoSaveNotify(wxTimerEvent & WXUNUSED(evt))
     }
 }
 
+void
+MyFrame::RestoreSnapshot(const wxString & filename)
+{
+    const wxString snapshot = GetSnapshotFilename(filename);
+    if (! wxFileExists(snapshot))
+        return;
+    bool ok = false;
+    try {
+        // Ignore snapshots from before the puzzle was last saved
+        ok = wxFileModificationTime(snapshot) >= wxFileModificationTime(filename)
+            && puz::LoadSnapshot(&m_puz, wx2file(snapshot));
+    } catch (...) {
+        wxLogDebug(_T("Unable to restore AutoSave snapshot"));
+    }
+    if (ok)
+    {
+        m_isModified = true;
+        m_hasSnapshot = true;
+    }
+    else
+    {
+        wxRemoveFile(snapshot);
+    }
+}
+
+void
+MyFrame::RemoveSnapshot()
+{
+    if (! m_hasSnapshot)
+        return;
+    const wxString snapshot = GetSnapshotFilename(m_filename);
+    if (wxFileExists(snapshot))
+        wxRemoveFile(snapshot);
+    m_hasSnapshot = false;
+}
+
 // Preferences
 //------------
 void
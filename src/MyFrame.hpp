@@ -245,6 +245,7 @@ private:
     puz::Puzzle m_puz;
     wxString m_filename;
     bool m_isModified;
+    bool m_hasSnapshot; // AutoSaved changes that the puzzle file doesn't have
 
     // Config
     //-------
@@ -258,6 +259,9 @@ private:
 private:
     // Load / save exception handling.
     void DoSavePuzzle(const wxString & filename, const puz::Puzzle::FileHandlerDesc * handler = NULL);
+    // AutoSave snapshots
+    void RestoreSnapshot(const wxString & filename);
+    void RemoveSnapshot();
     void HandlePuzException();
 
     // Event Handlers
@@ -367,55 +367,26 @@ CorrectStatus GetCorrectStatus(const puz::Grid * grid, bool correct)
 CorrectStatus
 XGridCtrl::IsCorrect() const
 {
+    const puz::SolveStats & grid = m_grid->GetStats();
+    if (grid.blank > 0)
+        return INCOMPLETE_PUZZLE;
     bool strictRebus = HasStyle(STRICT_REBUS);
-    bool correct = true;
-    puz::Square * square;
-    for (square = m_grid->First(); square != NULL; square = square->Next())
-    {
-        if (square->IsBlank())
-            return INCOMPLETE_PUZZLE;
-        else if (! square->Check(puz::NO_CHECK_BLANK, strictRebus))
-            correct = false;
-    }
-    return GetCorrectStatus(m_grid, correct);
+    return GetCorrectStatus(m_grid,
+        (strictRebus ? grid.strictIncorrect : grid.incorrect) == 0);
 }
 
 void
 XGridCtrl::GetStats(GridStats * stats) const
 {
-    stats->blank_correct = 0;
-    stats->blank = 0;
-    stats->black = 0;
-    stats->white = 0;
+    // The grid keeps these counts up to date as squares change
+    const puz::SolveStats & grid = m_grid->GetStats();
+    stats->blank = grid.blank;
+    stats->black = grid.black;
+    stats->white = grid.white;
+    stats->blank_correct = m_grid->HasSolution() ? grid.blankCorrect : 0;
 
     bool strictRebus = HasStyle(STRICT_REBUS);
-    bool correct = true;
-    puz::Square * square;
-    for (square = m_grid->First(); square != NULL; square = square->Next())
-    {
-        if (square->IsBlack())
-        {
-            ++stats->black;
-        }
-        else if (!square->IsMissing())
-        {
-            ++stats->white;
-            if (square->IsBlank())
-            {
-                ++stats->blank;
-                if (m_grid->HasSolution() && square->IsSolutionBlank())
-                    ++stats->blank_correct;
-            }
-            // If the puzzle is correct so far, and without blanks (that do
-            // not also have a blank solution), check this square
-            else if (stats->blank == stats->blank_correct
-                     && correct
-                     && ! square->Check(puz::NO_CHECK_BLANK, strictRebus))
-            {
-                correct = false;
-            }
-        }
-    }
+    bool correct = (strictRebus ? grid.strictIncorrect : grid.incorrect) == 0;
     // Set the correct flag
     // If we have a puzzle with a partially blank solution, don't alert the
     // user if there are incorrect letters since that would give away the
@@ -1144,9 +1115,12 @@ XGridCtrl::CheckGrid(int options)
 {
     wxASSERT(! IsEmpty() && ! m_grid->IsScrambled());
 
+    std::vector<unsigned char> incorrect;
+    m_grid->CheckGrid(&incorrect, (options & CHECK_ALL) != 0,
+                      HasStyle(STRICT_REBUS));
     puz::square_iterator begin(m_grid->First());
     puz::square_iterator end(m_grid->Last()->Next());
-    Check(begin, end, options);
+    Check(begin, end, incorrect, options);
 }
 
 
@@ -1155,7 +1129,10 @@ XGridCtrl::CheckWord(int options)
 {
     wxASSERT(! IsEmpty() && ! m_grid->IsScrambled());
 
-    Check(m_focusedWord->begin(), m_focusedWord->end(), options);
+    std::vector<unsigned char> incorrect;
+    m_grid->CheckWord(&incorrect, m_focusedWord, (options & CHECK_ALL) != 0,
+                      HasStyle(STRICT_REBUS));
+    Check(m_focusedWord->begin(), m_focusedWord->end(), incorrect, options);
 }
 
 
@@ -1165,37 +1142,56 @@ XGridCtrl::CheckLetter(int options)
 {
     wxASSERT(! IsEmpty() && ! m_grid->IsScrambled());
 
+    // This runs on every keystroke with CHECK_WHILE_TYPING, so don't build
+    // a whole-grid map for one square.
     puz::Square * square = GetFocusedSquare();
-    puz::square_iterator begin(square);
-    puz::square_iterator end(square->Next());
-
-    Check(begin, end, options);
+    const bool isCorrect = square->Check((options & CHECK_ALL) != 0,
+                                         HasStyle(STRICT_REBUS));
+    wxClientDC dc(this); DoPrepareDC(dc);
+    if (CheckSquare(square, isCorrect, options, dc)
+        && (options & NO_MESSAGE_BOX) == 0)
+    {
+        XWordMessage(this, MSG_NO_INCORRECT);
+    }
 }
 
 
+// Check squares from begin to end.  incorrect is the map from
+// Grid::CheckGrid or Grid::CheckWord.
 void
 XGridCtrl::Check(puz::square_iterator begin, puz::square_iterator end,
-                 int options)
+                 const std::vector<unsigned char> & incorrect, int options)
 {
     wxASSERT(! IsEmpty() && ! m_grid->IsScrambled());
 
     wxClientDC dc(this); DoPrepareDC(dc);
-    bool incorrect = false;
+    bool hasIncorrect = false;
     for (puz::square_iterator square = begin; square != end; ++square)
-        if (! CheckSquare(&*square, options, dc))
-            incorrect = true;
-    if (! incorrect && (options & NO_MESSAGE_BOX) == 0)
+    {
+        const size_t index = square->GetRow() * m_grid->GetWidth()
+                           + square->GetCol();
+        if (! CheckSquare(&*square, ! incorrect[index], options, dc))
+            hasIncorrect = true;
+    }
+    if (! hasIncorrect && (options & NO_MESSAGE_BOX) == 0)
         XWordMessage(this, MSG_NO_INCORRECT);
 }
 
-// Check an individual square, set flags, refresh the square
+// Set flags on an individual square and refresh it.  isCorrect is the
+// result of Square::Check for the options.
 bool
-XGridCtrl::CheckSquare(puz::Square * square, int options, wxDC & dc)
+XGridCtrl::CheckSquare(puz::Square * square, bool isCorrect, int options,
+                       wxDC & dc)
 {
     if (! square->IsWhite() && ! m_puz->IsDiagramless())
         return true;
+    // Revealing a square also fills in its partners, so an earlier reveal
+    // may have fixed this one.
+    if (! isCorrect && (options & REVEAL_ANSWER) != 0)
+        isCorrect = square->Check((options & CHECK_ALL) != 0,
+                                  HasStyle(STRICT_REBUS));
     square->RemoveFlag(puz::FLAG_CORRECT);
-    if (! square->Check((options & CHECK_ALL) != 0, HasStyle(STRICT_REBUS)))
+    if (! isCorrect)
     {
         if ( (options & REVEAL_ANSWER) != 0)
         {
@@ -1280,13 +1276,19 @@ XGridCtrl::DoCheckSelection(puz::Square * start, puz::Square * end, int options)
 {
     wxASSERT(! IsEmpty() && ! m_grid->IsScrambled());
 
+    std::vector<unsigned char> incorrect;
+    m_grid->CheckGrid(&incorrect, (options & CHECK_ALL) != 0,
+                      HasStyle(STRICT_REBUS));
+    const size_t width = m_grid->GetWidth();
+
     wxClientDC dc(this); DoPrepareDC(dc);
-    bool incorrect = false;
+    bool hasIncorrect = false;
     for (int col = start->GetCol(); col <= end->GetCol(); ++col)
         for (int row = start->GetRow(); row <= end->GetRow(); ++row)
-            if (! CheckSquare(&At(col, row), options, dc))
-                incorrect = true;
-    if (! incorrect && (options & NO_MESSAGE_BOX) == 0)
+            if (! CheckSquare(&At(col, row), ! incorrect[row * width + col],
+                              options, dc))
+                hasIncorrect = true;
+    if (! hasIncorrect && (options & NO_MESSAGE_BOX) == 0)
         XWordMessage(this, MSG_NO_INCORRECT);
 }
 
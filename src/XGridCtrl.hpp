@@ -356,8 +356,10 @@ protected:
 
     // Common CheckXXX function
     void DoCheckSelection(puz::Square * start, puz::Square * end, int options);
-    void Check(puz::square_iterator begin, puz::square_iterator end, int options);
-    bool CheckSquare(puz::Square * square, int options, wxDC & dc);
+    void Check(puz::square_iterator begin, puz::square_iterator end,
+               const std::vector<unsigned char> & incorrect, int options);
+    bool CheckSquare(puz::Square * square, bool isCorrect, int options,
+                     wxDC & dc);
 
     // Drawing functions
     void OnPaint(wxPaintEvent & evt);
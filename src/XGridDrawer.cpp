@@ -510,8 +510,8 @@ XGridDrawer::DrawSquare(wxDC & adc,
         if (! img.IsOk())
         {
             // Load the image and cache it.
-			wxMemoryInputStream stream(square.m_imagedata.c_str(),
-									   square.m_imagedata.length());
+			wxMemoryInputStream stream(square.GetImageData().c_str(),
+									   square.GetImageData().length());
             img = wxImage(stream);
             m_imageMap[&square] = img;
         }
@@ -592,17 +592,17 @@ XGridDrawer::DrawSquare(wxDC & adc,
 
         // Draw corner marks
         wxRect markRect(x+1, y, m_boxSize - 2, m_boxSize - 2);
-        if (! square.m_mark[puz::MARK_TL].empty())
-            dc.DrawLabel(puz2wx(square.m_mark[puz::MARK_TL]), markRect,
+        if (square.HasMark(puz::MARK_TL))
+            dc.DrawLabel(puz2wx(square.GetMark(puz::MARK_TL)), markRect,
                          wxALIGN_TOP | wxALIGN_LEFT);
-        if (! square.m_mark[puz::MARK_TR].empty())
-            dc.DrawLabel(puz2wx(square.m_mark[puz::MARK_TR]), markRect,
+        if (square.HasMark(puz::MARK_TR))
+            dc.DrawLabel(puz2wx(square.GetMark(puz::MARK_TR)), markRect,
                          wxALIGN_TOP | wxALIGN_RIGHT);
-        if (! square.m_mark[puz::MARK_BL].empty())
-            dc.DrawLabel(puz2wx(square.m_mark[puz::MARK_BL]), markRect,
+        if (square.HasMark(puz::MARK_BL))
+            dc.DrawLabel(puz2wx(square.GetMark(puz::MARK_BL)), markRect,
                          wxALIGN_BOTTOM | wxALIGN_LEFT);
-        if (square.m_mark[puz::MARK_BR].empty())
-            dc.DrawLabel(puz2wx(square.m_mark[puz::MARK_BR]), markRect,
+        if (square.HasMark(puz::MARK_BR))
+            dc.DrawLabel(puz2wx(square.GetMark(puz::MARK_BR)), markRect,
                          wxALIGN_BOTTOM | wxALIGN_RIGHT);
 
         // Draw the number
@@ -570,6 +570,8 @@ static int LUACALL wxLua_MyFrame_LoadPuzzle(lua_State *L)
         puz::Puzzle::FileHandlerDesc desc;
         desc.data = L;
         desc.handler = luapuz_Load_Puzzle;
+        desc.bufferHandler = NULL;
+        desc.probe = NULL;
 
         bool returns = self->LoadPuzzle(filename, &desc);
         lua_pushboolean(L, returns);
@@ -674,6 +676,8 @@ static int LUACALL wxLua_MyFrame_SavePuzzle(lua_State *L)
         puz::Puzzle::FileHandlerDesc desc;
         desc.data = L;
         desc.handler = luapuz_Save_Puzzle;
+        desc.bufferHandler = NULL;
+        desc.probe = NULL;
 
         bool returns = self->SavePuzzle(filename, &desc);
         lua_pushboolean(L, returns);